@@ -0,0 +1,153 @@
+/* ///////////////////////////////////////////////////////////////////// */
+/*!
+  \file
+  \brief Convert a grid of Cloudy runs into the binary cooling table.
+
+  Standalone tool (not linked to PLUTO):
+
+      gcc -O2 -o cloudy2tab cloudy2tab.c -lm
+      ./cloudy2tab grid.txt [m_H]
+
+  The ASCII file has one line per model,
+
+      log10(T)  log10(n_H)  [log10(aux)]  Lambda  mu
+
+  with Lambda = (cooling - heating)/n_H^2 (erg cm^3 s^-1), i.e. the
+  "save cooling" and "save heating" output of a Cloudy grid with
+  constant temperature, and mu the mean molecular weight.
+  The lines are ordered with T running fastest and each axis is
+  uniformly spaced (the "grid" command of Cloudy).
+  The temperature axis is resampled onto a uniform log10(T/mu) axis
+  with the same number of nodes, covering the range common to all
+  densities. m_H (default 1.4) is the mean mass per hydrogen nucleus
+  in units of mp.
+  The table is written to cooltable.bin, see radiat.c for the format.
+*/
+/* ///////////////////////////////////////////////////////////////////// */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define MAGIC  "PLCLTAB1"
+
+int main(int argc, char *argv[])
+{
+  int    naxes, ncol, nrow, nmax, n[3], i, j, c, k;
+  char   line[512];
+  double *row, *x, *Lout, *muout, m_H, xlo, xhi, dx, xi, w;
+  double lmin[3], lmax[3];
+  FILE   *f, *fout;
+
+  if (argc < 2){
+    printf ("Usage: %s grid.txt [m_H]\n", argv[0]);
+    exit(1);
+  }
+  m_H = (argc > 2 ? atof(argv[2]) : 1.4);
+
+  f = fopen(argv[1], "r");
+  if (f == NULL){
+    printf ("! File %s does not exist\n", argv[1]);
+    exit(1);
+  }
+
+/* -- read all the lines, 4 or 5 columns -- */
+
+  ncol = 0; nrow = 0; nmax = 1024;
+  row  = (double *) malloc(nmax*5*sizeof(double));
+  while (fgets(line, sizeof(line), f) != NULL){
+    double *r;
+    if (line[0] == '#' || line[0] == '\n') continue;
+    if (nrow == nmax){
+      nmax *= 2;
+      row   = (double *) realloc(row, nmax*5*sizeof(double));
+    }
+    r = row + 5*nrow;
+    i = sscanf(line, "%lf %lf %lf %lf %lf", r, r+1, r+2, r+3, r+4);
+    if (ncol == 0) ncol = i;
+    if (i != ncol || (ncol != 4 && ncol != 5)){
+      printf ("! Wrong number of columns in line %d\n", nrow + 1);
+      exit(1);
+    }
+    if (ncol == 4){    /* -- no 3rd axis -- */
+      r[4] = r[3]; r[3] = r[2]; r[2] = 0.0;
+    }
+    nrow++;
+  }
+  fclose(f);
+  naxes = ncol - 2;
+
+/* -- size of the axes -- */
+
+  for (n[0] = 1; n[0] < nrow && row[5*n[0] + 1] == row[1]
+                             && row[5*n[0] + 2] == row[2]; n[0]++);
+  for (n[1] = 1; n[1]*n[0] < nrow && row[5*n[1]*n[0] + 2] == row[2]; n[1]++);
+  n[2] = nrow/(n[0]*n[1]);
+  if (n[0] < 2 || n[1] < 2 || n[0]*n[1]*n[2] != nrow){
+    printf ("! Lines do not form a grid (%d x %d x %d)\n", n[0], n[1], n[2]);
+    exit(1);
+  }
+  for (k = 1; k < 3; k++){
+    lmin[k] = row[k];
+    lmax[k] = row[5*(nrow - 1) + k];
+  }
+
+/* -- common range of log10(T/mu) -- */
+
+  x = (double *) malloc(nrow*sizeof(double));
+  xlo = -1.e30; xhi = 1.e30;
+  for (c = 0; c < n[1]*n[2]; c++){
+    for (j = 0; j < n[0]; j++){
+      i = c*n[0] + j;
+      x[i] = row[5*i] - log10(row[5*i + 4]);
+      if (j > 0 && x[i] <= x[i - 1]){
+        printf ("! T/mu is not increasing at line %d\n", i + 1);
+        exit(1);
+      }
+    }
+    xlo = (x[c*n[0]] > xlo ? x[c*n[0]] : xlo);
+    xhi = (x[c*n[0] + n[0] - 1] < xhi ? x[c*n[0] + n[0] - 1] : xhi);
+  }
+  if (xhi <= xlo){
+    printf ("! No common range of T/mu\n");
+    exit(1);
+  }
+  lmin[0] = xlo;
+  lmax[0] = xhi;
+
+/* -- resample on the uniform T/mu axis -- */
+
+  Lout  = (double *) malloc(nrow*sizeof(double));
+  muout = (double *) malloc(nrow*sizeof(double));
+  dx    = (xhi - xlo)/(n[0] - 1);
+  for (c = 0; c < n[1]*n[2]; c++){
+    k = c*n[0];
+    for (j = 0; j < n[0]; j++){
+      xi = (j == n[0] - 1 ? xhi : xlo + j*dx);
+      while (k < c*n[0] + n[0] - 2 && x[k + 1] < xi) k++;
+      w = (xi - x[k])/(x[k + 1] - x[k]);
+      Lout [c*n[0] + j] = (1.0 - w)*row[5*k + 3] + w*row[5*(k + 1) + 3];
+      muout[c*n[0] + j] = (1.0 - w)*row[5*k + 4] + w*row[5*(k + 1) + 4];
+    }
+  }
+
+  fout = fopen("cooltable.bin", "wb");
+  if (fout == NULL){
+    printf ("! Cannot open cooltable.bin for writing\n");
+    exit(1);
+  }
+  fwrite (MAGIC, sizeof(char), 8, fout);
+  fwrite (&naxes, sizeof(int), 1, fout);
+  fwrite (n, sizeof(int), 3, fout);
+  fwrite (lmin, sizeof(double), 3, fout);
+  fwrite (lmax, sizeof(double), 3, fout);
+  fwrite (&m_H, sizeof(double), 1, fout);
+  fwrite (Lout, sizeof(double), nrow, fout);
+  fwrite (muout, sizeof(double), nrow, fout);
+  fclose(fout);
+
+  printf ("> cooltable.bin: %d x %d x %d nodes\n", n[0], n[1], n[2]);
+  printf ("  log10(T/mu) = [%f, %f], log10(n_H) = [%f, %f]\n",
+          lmin[0], lmax[0], lmin[1], lmax[1]);
+  return(0);
+}
@@ -0,0 +1,31 @@
+/* ############################################################
+      
+     FILE:     cooling.h
+
+     PURPOSE:  definitions for the multi-dimensional tabulated
+               cooling (COOLING == TAB_GRID), see radiat.c
+
+   ############################################################ */
+
+/* -- name of the binary cooling table (written by cloudy2tab) -- */
+
+#ifndef TAB_GRID_FILE
+ #define TAB_GRID_FILE  "cooltable.bin"
+#endif
+
+/* -- variable giving the 3rd table axis (e.g. a metallicity
+      tracer or the flux), -1 = table with 2 axes only.
+      The table axis is log10 of this variable.             -- */
+
+#ifndef TAB_GRID_AUX
+ #define TAB_GRID_AUX   -1
+#endif
+
+#define TAB_GRID_MAGIC  "PLCLTAB1"
+#define TAB_GRID_MAXAX  3
+
+double GetMaxRate (double *, double *, double);
+double MeanMolecularWeight  (double *);
+void Radiat (double *, double *);
+void RadiatPencil (double **, double *, double *, int, int);
+
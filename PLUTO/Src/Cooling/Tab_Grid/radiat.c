@@ -0,0 +1,226 @@
+/* ///////////////////////////////////////////////////////////////////// */
+/*!
+  \file
+  \brief Multi-dimensional tabulated cooling.
+
+  Net cooling rate and mean molecular weight interpolated from a
+  table on uniformly spaced logarithmic axes, e.g. exported from a
+  grid of Cloudy runs (see cloudy2tab.c).
+  The axes are
+   -# log10(T/mu) = log10(p/rho*KELVIN), the temperature variable
+      known to PLUTO without the mean molecular weight;
+   -# log10(n_H), with n_H = rho/(m_H*mp) and m_H the mean mass per
+      hydrogen nucleus (in units of mp) stored in the table;
+   -# optional: log10(v[TAB_GRID_AUX]), e.g. a metallicity tracer
+      or the flux.
+
+  Since the axes are uniform the node is found by one multiplication
+  and the value is obtained by (bi/tri)linear interpolation.
+  Values outside the table are taken at the boundary.
+  RadiatPencil() evaluates a whole row of cells in a loop without
+  branches (CoolingSource() calls it once per row); Radiat() is the
+  same for a single cell. With gcc the loop is vectorized for
+  -O3 -ffast-math, which enables the vector log10 of glibc.
+
+  The binary file TAB_GRID_FILE (native byte order) contains
+   - char magic[8] = TAB_GRID_MAGIC;
+   - int naxes (2 or 3), int n[3];
+   - double lmin[3], double lmax[3], double m_H;
+   - double Lambda[N], the net cooling rate (cooling - heating)
+     divided by n_H^2 (erg cm^3 s^-1);
+   - double mu[N];
+
+  with N = n[0]*n[1]*n[2] and axis 0 running fastest.
+  Unused axes have n = 1.
+*/
+/* ///////////////////////////////////////////////////////////////////// */
+#include "pluto.h"
+
+static int    tab_kmax[TAB_GRID_MAXAX];  /* last lower node of an axis */
+static int    tab_s[TAB_GRID_MAXAX];     /* stride to the next node (0 for n = 1) */
+static double tab_lmin[TAB_GRID_MAXAX], tab_smax[TAB_GRID_MAXAX];
+static double tab_idl[TAB_GRID_MAXAX];
+static double tab_nH, E_cost;
+static double *L_tab, *mu_tab;
+
+static void ReadCoolTable (void);
+
+/* ********************************************************************* */
+static inline double TabIndex (double lx, int ax, int *k)
+/*
+ * Return the lower node k and the weight of the upper node
+ * for the coordinate lx on the axis ax.
+ *********************************************************************** */
+{
+  double s;
+
+  s  = (lx - tab_lmin[ax])*tab_idl[ax];
+  s  = MAX(s, 0.0);
+  s  = MIN(s, tab_smax[ax]);
+  *k = MIN((int)s, tab_kmax[ax]);
+  return s - (double)(*k);
+}
+
+/* ********************************************************************* */
+static inline double TabInterp (const double *q, double f0, double f1,
+                                double f2)
+/*
+ * Trilinear interpolation in the cell starting at q.
+ *********************************************************************** */
+{
+  int s0 = tab_s[0], s1 = tab_s[1], s2 = tab_s[2];
+  double a, b;
+
+  a =   (1.0 - f1)*((1.0 - f0)*q[0]       + f0*q[s0])
+      +        f1 *((1.0 - f0)*q[s1]      + f0*q[s1 + s0]);
+  b =   (1.0 - f1)*((1.0 - f0)*q[s2]      + f0*q[s2 + s0])
+      +        f1 *((1.0 - f0)*q[s2 + s1] + f0*q[s2 + s1 + s0]);
+  return (1.0 - f2)*a + f2*b;
+}
+
+/* ********************************************************************* */
+void RadiatPencil (double **v, double *rhs, double *mu, int beg, int end)
+/*!
+ * Provide the r.h.s. of the pressure equation and the mean molecular
+ * weight for the cells beg..end of a row.
+ *
+ * \param [in]     v    primitive variables, v[nv][i]; negative
+ *                      pressures are taken as g_smallPressure
+ * \param [out]    rhs  pressure source term, rhs[i]
+ * \param [out]    mu   mean molecular weight, mu[i]
+ * \param [in]     beg  first cell
+ * \param [in]     end  last cell
+ *********************************************************************** */
+{
+  int    i, k0, k1, k2, m;
+  double f0, f1, f2, nH, T, L, mui, pr, scrh;
+  double *rho, *prs, *aux;
+
+  if (L_tab == NULL) ReadCoolTable();
+
+  rho = v[RHO];
+  prs = v[PRS];
+  aux = (TAB_GRID_AUX >= 0 ? v[MAX(TAB_GRID_AUX, 0)] : rho);
+
+  SIMD_LOOP
+  for (i = beg; i <= end; i++){
+    pr   = (prs[i] < 0.0 ? g_smallPressure : prs[i]);
+    scrh = pr/rho[i]*KELVIN;
+    nH   = rho[i]*tab_nH;
+
+    f0 = TabIndex(log10(scrh), 0, &k0);
+    f1 = TabIndex(log10(nH), 1, &k1);
+    f2 = (TAB_GRID_AUX >= 0 ? TabIndex(log10(aux[i]), 2, &k2) : 0.0);
+    k2 = (TAB_GRID_AUX >= 0 ? k2 : 0);
+
+    m   = k0*tab_s[0] + k1*tab_s[1] + k2*tab_s[2];
+    L   = TabInterp(L_tab + m, f0, f1, f2);
+    mui = TabInterp(mu_tab + m, f0, f1, f2);
+    T   = scrh*mui;
+
+    mu[i]  = mui;
+    rhs[i] = (T < g_minCoolingTemp ? 0.0 : -(g_gamma - 1.0)*L*nH*nH*E_cost);
+  }
+}
+
+/* ********************************************************************* */
+void Radiat (double *v, double *rhs)
+/*!
+ * Provide r.h.s. for tabulated cooling (single cell version of
+ * RadiatPencil()).
+ *
+ *********************************************************************** */
+{
+  int    nv;
+  double *vp[NVAR], mu;
+
+  if (v[PRS] < 0.0) v[PRS] = g_smallPressure;
+  if (v[PRS]/v[RHO] != v[PRS]/v[RHO]){
+    print (" ! Nan found in radiat \n");
+    print (" ! rho = %12.6e, pr = %12.6e\n",v[RHO], v[PRS]);
+    QUIT_PLUTO(1);
+  }
+
+  for (nv = 0; nv < NVAR; nv++) vp[nv] = v + nv;
+  RadiatPencil (vp, rhs + PRS, &mu, 0, 0);
+}
+
+/* ********************************************************************* */
+double MeanMolecularWeight (double *v)
+/*!
+ * Mean molecular weight interpolated from the table.
+ *
+ *********************************************************************** */
+{
+  int    nv;
+  double *vp[NVAR], rhs, mu;
+
+  for (nv = 0; nv < NVAR; nv++) vp[nv] = v + nv;
+  RadiatPencil (vp, &rhs, &mu, 0, 0);
+  return mu;
+}
+
+/* ********************************************************************* */
+static void ReadCoolTable (void)
+/*
+ * Read the binary table TAB_GRID_FILE.
+ *
+ *********************************************************************** */
+{
+  int    naxes, n[TAB_GRID_MAXAX], ax, ntot, ok;
+  char   magic[8];
+  double lmin[TAB_GRID_MAXAX], lmax[TAB_GRID_MAXAX], m_H;
+  FILE   *fcool;
+
+  print1 (" > Reading table %s from disk...\n", TAB_GRID_FILE);
+  fcool = fopen(TAB_GRID_FILE, "rb");
+  if (fcool == NULL){
+    print1 ("! %s does not exist\n", TAB_GRID_FILE);
+    QUIT_PLUTO(1);
+  }
+
+  ok =    fread (magic, sizeof(char), 8, fcool) == 8
+       && strncmp(magic, TAB_GRID_MAGIC, 8) == 0
+       && fread (&naxes, sizeof(int), 1, fcool) == 1
+       && fread (n, sizeof(int), TAB_GRID_MAXAX, fcool) == TAB_GRID_MAXAX
+       && fread (lmin, sizeof(double), TAB_GRID_MAXAX, fcool) == TAB_GRID_MAXAX
+       && fread (lmax, sizeof(double), TAB_GRID_MAXAX, fcool) == TAB_GRID_MAXAX
+       && fread (&m_H, sizeof(double), 1, fcool) == 1;
+  if (!ok || naxes < 2 || naxes > TAB_GRID_MAXAX){
+    print1 ("! %s: not a cooling table\n", TAB_GRID_FILE);
+    QUIT_PLUTO(1);
+  }
+  if (naxes == 3 && TAB_GRID_AUX < 0){
+    print1 ("! %s: 3rd axis needs TAB_GRID_AUX\n", TAB_GRID_FILE);
+    QUIT_PLUTO(1);
+  }
+
+  ntot = 1;
+  for (ax = 0; ax < TAB_GRID_MAXAX; ax++){
+    if (ax >= naxes) n[ax] = 1;
+    if (n[ax] < 1 || (n[ax] > 1 && lmax[ax] <= lmin[ax])){
+      print1 ("! %s: invalid axis %d\n", TAB_GRID_FILE, ax);
+      QUIT_PLUTO(1);
+    }
+    tab_lmin[ax] = lmin[ax];
+    tab_smax[ax] = (double)(n[ax] - 1);
+    tab_kmax[ax] = MAX(n[ax] - 2, 0);
+    tab_idl[ax]  = (n[ax] > 1 ? (n[ax] - 1)/(lmax[ax] - lmin[ax]) : 0.0);
+    tab_s[ax]    = (n[ax] > 1 ? ntot : 0);
+    ntot        *= n[ax];
+  }
+
+  L_tab  = ARRAY_1D(ntot, double);
+  mu_tab = ARRAY_1D(ntot, double);
+  if (   fread (L_tab, sizeof(double), ntot, fcool) != ntot
+      || fread (mu_tab, sizeof(double), ntot, fcool) != ntot){
+    print1 ("! %s: table truncated\n", TAB_GRID_FILE);
+    QUIT_PLUTO(1);
+  }
+  fclose(fcool);
+
+  print1 ("   %d x %d x %d nodes, m_H = %f mp\n", n[0], n[1], n[2], m_H);
+
+  tab_nH = g_unitDensity/(m_H*CONST_mp);
+  E_cost = g_unitLength/g_unitDensity/pow(g_unitVelocity, 3.0);
+}
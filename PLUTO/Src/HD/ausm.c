@@ -28,6 +28,7 @@ void AUSMp_Solver (const State_1D *state, int beg, int end,
   real *vL, *vR, *uL, *uR;
   real alpha = 3.0/16.0, beta = 0.125;
   static real  **fl, **fr, **ul, **ur;
+  OMP_PRAGMA(omp threadprivate(fl, fr, ul, ur))
 
   if (fl == NULL){
     fl = ARRAY_2D(NMAX_POINT, NFLX, double);
@@ -29,6 +29,7 @@ void AUSMp_Solver (const State_1D *state, real *cmax, Grid *grid)
   real *vL, *vR, *uL, *uR;
   real alpha = 3.0/16.0, beta = 0.125;
   static real  **fl, **fr, **ul, **ur;
+  OMP_PRAGMA(omp threadprivate(fl, fr, ul, ur))
 
 
   beg = grid[g_dir].lbeg - 1;
@@ -229,6 +229,7 @@ void  PrimEigenvectors (double *q, double cs2, double h, double *lambda,
 #if CHECK_EIGENVECTORS == YES
 {
   static double **A, **ALR;
+  OMP_PRAGMA(omp threadprivate(A, ALR))
   double dA;
 
   if (A == NULL){
@@ -502,6 +503,7 @@ void ConsEigenvectors (double *u, double *v, double a2,
 #if CHECK_EIGENVECTORS == YES
 {
   static double **A, **ALR;
+  OMP_PRAGMA(omp threadprivate(A, ALR))
   double dA, vel2, Bmag2, vB;
 
   if (A == NULL){
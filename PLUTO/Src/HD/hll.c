@@ -1,5 +1,9 @@
 #include"pluto.h"
 
+#if SOA_KERNELS == YES
+ static void HLL_SoA (const State_1D *, int, int, double *);
+#endif
+
 /* ********************************************************************* */
 void HLL_Solver (const State_1D *state, int beg, int end, 
                  double *cmax, Grid *grid)
@@ -34,9 +38,15 @@ void HLL_Solver (const State_1D *state, int beg, int end,
   double   scrh;
   static double *pL, *pR, *SL, *SR, *a2L, *a2R;
   static double **fL, **fR;
+  OMP_PRAGMA(omp threadprivate(pL, pR, SL, SR, a2L, a2R, fL, fR))
   double *uR, *uL;
   double bmax, bmin, *vL, *vR, aL, aR;
 
+  #if SOA_KERNELS == YES
+   HLL_SoA (state, beg, end, cmax);
+   return;
+  #endif
+
 /* -- Allocate memory -- */
 
   if (fL == NULL){
@@ -115,3 +125,99 @@ aR = sqrt(g_gamma*vR[PRS]/vR[RHO]);
 
   } /* end loops on points */
 }
+
+#if SOA_KERNELS == YES
+/* ********************************************************************* */
+void HLL_SoA (const State_1D *state, int beg, int end, double *cmax)
+/*!
+ * Vectorized version of the HLL solver for the ideal EoS, see 
+ * HLLC_SoA(). The flux of every variable is computed in a separate 
+ * loop over the interfaces from the states indexed [nv][i].
+ *
+ *********************************************************************** */
+{
+  int    nv, i;
+  double gmm1, aL, aR, sl, sr, fl, fr, uL, uR, scrh;
+  double *dL, *dR, *vnL, *vnR, *pL, *pR, *qL, *qR;
+  double *v1L, *v1R, *v2L, *v2R, *v3L, *v3R;
+  double *SL, *SR, *eL, *eR, *f, *press, *mach;
+  static double **wsL, **wsR, **fs, **ss;
+  OMP_PRAGMA(omp threadprivate(wsL, wsR, fs, ss))
+
+  if (wsL == NULL){
+    wsL = ALIGNED_ARRAY_2D(NFLX, NMAX_POINT, double);
+    wsR = ALIGNED_ARRAY_2D(NFLX, NMAX_POINT, double);
+    fs  = ALIGNED_ARRAY_2D(NFLX, NMAX_POINT, double);
+    ss  = ALIGNED_ARRAY_2D(5, NMAX_POINT, double);
+  }
+
+  StateToSoA (state->vL, wsL, NFLX, beg, end);
+  StateToSoA (state->vR, wsR, NFLX, beg, end);
+
+  gmm1 = g_gamma - 1.0;
+  dL  = wsL[RHO]; dR  = wsR[RHO];
+  vnL = wsL[VXn]; vnR = wsR[VXn];
+  pL  = wsL[PRS]; pR  = wsR[PRS];
+  SL  = ss[0]; SR = ss[1]; eL = ss[2]; eR = ss[3]; mach = ss[4];
+  press = state->press;
+
+/* ----------------------------------------------------
+     signal speeds (Davis estimate), pressure term and 
+     total energy
+   ---------------------------------------------------- */
+
+  SIMD_LOOP
+  for (i = beg; i <= end; i++){
+    aL = sqrt(g_gamma*pL[i]/dL[i]);
+    aR = sqrt(g_gamma*pR[i]/dR[i]);
+    sl = SL[i] = MIN(vnL[i] - aL, vnR[i] - aR);
+    sr = SR[i] = MAX(vnL[i] + aL, vnR[i] + aR);
+    cmax[i] = MAX(fabs(sl), fabs(sr));
+    mach[i] = (fabs(vnL[i]) + fabs(vnR[i]))/(aL + aR);
+
+    fl = pL[i]; fr = pR[i];
+    scrh = 1.0/(sr - sl);
+    press[i] = sl > 0.0 ? fl : (sr < 0.0 ? fr : (sr*fl - sl*fr)*scrh);
+  }
+  for (i = beg; i <= end; i++) g_maxMach = MAX(mach[i], g_maxMach);
+
+  EXPAND(v1L = wsL[VX1]; v1R = wsR[VX1];  ,
+         v2L = wsL[VX2]; v2R = wsR[VX2];  ,
+         v3L = wsL[VX3]; v3R = wsR[VX3];)
+  SIMD_LOOP
+  for (i = beg; i <= end; i++){
+    fl = EXPAND(v1L[i]*v1L[i], + v2L[i]*v2L[i], + v3L[i]*v3L[i]);
+    fr = EXPAND(v1R[i]*v1R[i], + v2R[i]*v2R[i], + v3R[i]*v3R[i]);
+    eL[i] = 0.5*dL[i]*fl + pL[i]/gmm1;
+    eR[i] = 0.5*dR[i]*fr + pR[i]/gmm1;
+  }
+
+/* ----------------------------------------------------
+     fluxes, one variable at a time
+   ---------------------------------------------------- */
+
+  for (nv = 0; nv < NFLX; nv++){
+    qL = wsL[nv]; qR = wsR[nv]; f = fs[nv];
+    SIMD_LOOP
+    for (i = beg; i <= end; i++){
+      sl = SL[i]; sr = SR[i];
+      if (nv == ENG){
+        uL = eL[i];
+        uR = eR[i];
+        fl = (uL + pL[i])*vnL[i];
+        fr = (uR + pR[i])*vnR[i];
+      }else{
+        uL = (nv == RHO ? dL[i] : dL[i]*qL[i]);
+        uR = (nv == RHO ? dR[i] : dR[i]*qR[i]);
+        fl = uL*vnL[i];
+        fr = uR*vnR[i];
+      }
+      scrh = 1.0/(sr - sl);
+      f[i] = sl > 0.0 ? fl : (sr < 0.0 ? fr : 
+             (sl*sr*(uR - uL) + sr*fl - sl*fr)*scrh);
+    }
+  }
+
+  SoAToState (fs, state->flux, NFLX, beg, end);
+}
+#endif
@@ -65,6 +65,7 @@ void HLL_Speed (double **vL, double **vR, double *a2L, double *a2R,
   double a_av, du, vx;
   static double *sl_min, *sl_max;
   static double *sr_min, *sr_max;
+  OMP_PRAGMA(omp threadprivate(sl_min, sl_max, sr_min, sr_max))
 
   if (sl_min == NULL){
     sl_min = ARRAY_1D(NMAX_POINT, double);
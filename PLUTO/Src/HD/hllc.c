@@ -1,5 +1,9 @@
 #include"pluto.h"
 
+#if SOA_KERNELS == YES
+ static void HLLC_SoA (const State_1D *, int, int, double *);
+#endif
+
 /* **************************************************************************** */
 void HLLC_Solver (const State_1D *state, int beg, int end, 
                   real *cmax, Grid *grid)
@@ -40,6 +44,12 @@ void HLLC_Solver (const State_1D *state, int beg, int end,
   #endif
   static real *pL, *pR, *SL, *SR, *a2L, *a2R;
   static real **fL, **fR;
+  OMP_PRAGMA(omp threadprivate(pL, pR, SL, SR, a2L, a2R, fL, fR))
+
+  #if SOA_KERNELS == YES
+   HLLC_SoA (state, beg, end, cmax);
+   return;
+  #endif
 
 /* -- Allocate memory -- */
 
@@ -182,3 +192,149 @@ void HLLC_Solver (const State_1D *state, int beg, int end,
     }
   } /* end loops on points */
 }
+
+#if SOA_KERNELS == YES
+/* ********************************************************************* */
+void HLLC_SoA (const State_1D *state, int beg, int end, double *cmax)
+/*!
+ * Vectorized version of the HLLC solver for the ideal EoS.
+ * The left and right states are copied into arrays indexed [nv][i].
+ * The signal speeds and the star states on both sides are computed
+ * for all the interfaces before the upwind flux is selected, so that 
+ * none of the loops has jumps. Wave speeds are the Davis estimates 
+ * used by HLL_Speed(). The results are the same as with the scalar 
+ * code unless the compiler contracts operations (FMA).
+ *
+ *********************************************************************** */
+{
+  int    i, lgL, lgS, n1, n2, n3;
+  double gmm1, aL, aR, sl, sr, vs, qL, qR, wL, wR;
+  double dl, dr, vnl, vnr, pl, pr, el, er;
+  double d, vn, vt, vx, p, e, ds, es, S, f, fx;
+  double v1l, v1r, v2l, v2r, v3l, v3r;
+  double *dL, *dR, *vnL, *vnR, *pL, *pR;
+  double *v1L, *v1R, *v2L, *v2R, *v3L, *v3R;
+  double *SL, *SR, *VS, *EL, *ER, *DSL, *DSR, *ESL, *ESR, *mach;
+  double *f1, *f2, *f3, *fd, *fe, *press;
+  static double **wsL, **wsR, **fs, **ss;
+  OMP_PRAGMA(omp threadprivate(wsL, wsR, fs, ss))
+
+  if (wsL == NULL){
+    wsL = ALIGNED_ARRAY_2D(NFLX, NMAX_POINT, double);
+    wsR = ALIGNED_ARRAY_2D(NFLX, NMAX_POINT, double);
+    fs  = ALIGNED_ARRAY_2D(NFLX, NMAX_POINT, double);
+    ss  = ALIGNED_ARRAY_2D(10, NMAX_POINT, double);
+  }
+
+  StateToSoA (state->vL, wsL, NFLX, beg, end);
+  StateToSoA (state->vR, wsR, NFLX, beg, end);
+
+  gmm1 = g_gamma - 1.0;
+  dL  = wsL[RHO]; dR  = wsR[RHO];
+  vnL = wsL[VXn]; vnR = wsR[VXn];
+  pL  = wsL[PRS]; pR  = wsR[PRS];
+  EXPAND(v1L = wsL[VX1]; v1R = wsR[VX1]; f1 = fs[MX1];  ,
+         v2L = wsL[VX2]; v2R = wsR[VX2]; f2 = fs[MX2];  ,
+         v3L = wsL[VX3]; v3R = wsR[VX3]; f3 = fs[MX3];)
+  fd = fs[RHO]; fe = fs[ENG];
+  SL  = ss[0]; SR  = ss[1]; VS  = ss[2];
+  EL  = ss[3]; ER  = ss[4]; DSL = ss[5];
+  DSR = ss[6]; ESL = ss[7]; ESR = ss[8]; mach = ss[9];
+  press = state->press;
+  n1 = (VXn == VX1); n2 = (VXn == VX2); n3 = (VXn == VX3);
+
+/* ----------------------------------------------------
+     total energy
+   ---------------------------------------------------- */
+
+  SIMD_LOOP
+  for (i = beg; i <= end; i++){
+    el = EXPAND(v1L[i]*v1L[i], + v2L[i]*v2L[i], + v3L[i]*v3L[i]);
+    er = EXPAND(v1R[i]*v1R[i], + v2R[i]*v2R[i], + v3R[i]*v3R[i]);
+    EL[i] = 0.5*dL[i]*el + pL[i]/gmm1;
+    ER[i] = 0.5*dR[i]*er + pR[i]/gmm1;
+  }
+
+/* ----------------------------------------------------
+     signal speeds (Davis estimate), contact speed
+     and star states on both sides
+   ---------------------------------------------------- */
+
+  SIMD_LOOP
+  for (i = beg; i <= end; i++){
+    dl = dL[i]; vnl = vnL[i]; pl = pL[i];
+    dr = dR[i]; vnr = vnR[i]; pr = pR[i];
+
+    aL = sqrt(g_gamma*pl/dl);
+    aR = sqrt(g_gamma*pr/dr);
+    sl = MIN(vnl - aL, vnr - aR);
+    sr = MAX(vnl + aL, vnr + aR);
+    SL[i] = sl; SR[i] = sr;
+    cmax[i] = MAX(fabs(sl), fabs(sr));
+    mach[i] = (fabs(vnl) + fabs(vnr))/(aL + aR);
+
+    el = EL[i];
+    er = ER[i];
+    qL = pl + dl*vnl*(vnl - sl);
+    qR = pr + dr*vnr*(vnr - sr);
+    wL = dl*(vnl - sl);
+    wR = dr*(vnr - sr);
+    vs = VS[i] = (qR - qL)/(wR - wL);
+
+    DSL[i] = dl*(sl - vnl)/(sl - vs);
+    DSR[i] = dr*(sr - vnr)/(sr - vs);
+    ESL[i] = (el/dl + (vs - vnl)*(vs + pl/(dl*(sl - vnl))))*DSL[i];
+    ESR[i] = (er/dr + (vs - vnr)*(vs + pr/(dr*(sr - vnr))))*DSR[i];
+  }
+  for (i = beg; i <= end; i++) g_maxMach = MAX(mach[i], g_maxMach);
+
+/* ----------------------------------------------------
+     upwind side (lgL) and star region (lgS); the star 
+     state moves with vs in the normal direction
+   ---------------------------------------------------- */
+
+  SIMD_LOOP
+  for (i = beg; i <= end; i++){
+    sl = SL[i]; sr = SR[i]; vs = VS[i];
+    lgL = (sl > 0.0) | ((sr >= 0.0) & (vs >= 0.0));
+    lgS = (sl <= 0.0) & (sr >= 0.0);
+
+    d  = lgL ? dL[i]  : dR[i];
+    vn = lgL ? vnL[i] : vnR[i];
+    p  = lgL ? pL[i]  : pR[i];
+    e  = lgL ? EL[i]  : ER[i];
+    ds = lgL ? DSL[i] : DSR[i];
+    es = lgL ? ESL[i] : ESR[i];
+    S  = lgL ? sl : sr;
+
+    f  = d*vn;
+    fx = f + S*(ds - d);
+    fd[i] = lgS ? fx : f;
+    f  = (e + p)*vn;
+    fx = f + S*(es - e);
+    fe[i] = lgS ? fx : f;
+    press[i] = p;
+
+    EXPAND(v1l = v1L[i]; v1r = v1R[i];
+           vt  = lgL ? v1l : v1r;
+           vx  = n1 ? vs : vt;
+           f   = d*vt*vn;
+           fx  = f + S*(ds*vx - d*vt);
+           f1[i] = lgS ? fx : f;           ,
+           v2l = v2L[i]; v2r = v2R[i];
+           vt  = lgL ? v2l : v2r;
+           vx  = n2 ? vs : vt;
+           f   = d*vt*vn;
+           fx  = f + S*(ds*vx - d*vt);
+           f2[i] = lgS ? fx : f;           ,
+           v3l = v3L[i]; v3r = v3R[i];
+           vt  = lgL ? v3l : v3r;
+           vx  = n3 ? vs : vt;
+           f   = d*vt*vn;
+           fx  = f + S*(ds*vx - d*vt);
+           f3[i] = lgS ? fx : f;)
+  }
+
+  SoAToState (fs, state->flux, NFLX, beg, end);
+}
+#endif
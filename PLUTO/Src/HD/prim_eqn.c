@@ -99,6 +99,7 @@ void PrimSource (const State_1D *state, int beg, int end,
   double *x1p, *x2p, *x3p;
   double *dx1, *dx2, *dx3;
   static double *gPhi;
+  OMP_PRAGMA(omp threadprivate(gPhi))
   double g[3], scrh;
 
 #if ROTATING_FRAME == YES
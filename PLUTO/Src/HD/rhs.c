@@ -106,6 +106,7 @@ void RightHandSide (const State_1D *state, Time_Step *Dts,
   double **Bg0, **wA, w, wp, vphi, gPhi_c;
   double g[3];
   static double **fA, *gPhi;
+  OMP_PRAGMA(omp threadprivate(fA, gPhi))
 
   #if GEOMETRY != CARTESIAN
    if (fA == NULL) fA = ARRAY_2D(NMAX_POINT, NVAR, double);
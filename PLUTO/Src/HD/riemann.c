@@ -53,6 +53,7 @@ void TwoShock_Solver (const State_1D *state, int beg, int end,
   real   g1_g, scrh1, scrh2, scrh3, scrh4;
   static real  **ws, **us;
   static double **fL, **fR, *pL, *pR, *a2L, *a2R;
+  OMP_PRAGMA(omp threadprivate(ws, us, fL, fR, pL, pR, a2L, a2R))
   double *uL, *uR;
 
   if (ws == NULL){
@@ -34,6 +34,7 @@ void TWO_SHOCK (const State_1D *state, real *cmax, Grid *grid)
   real fR, dfR, SR, STR, csR;
   static real *s, **vs, **us, *cmax_loc;
   static int *shock;
+  OMP_PRAGMA(omp threadprivate(s, vs, us, cmax_loc, shock))
 
   if (vs == NULL){
     vs       = array_2D(NMAX_POINT, NVAR);
@@ -57,6 +57,7 @@ void Roe_Solver (const State_1D *state, int beg, int end,
 #endif
   double *ql, *qr, *uL, *uR;
   static double  **fL, **fR, *pL, *pR, *a2L, *a2R;
+  OMP_PRAGMA(omp threadprivate(fL, fR, pL, pR, a2L, a2R))
 
   double bmin, bmax, scrh1;
   double Us[NFLX];
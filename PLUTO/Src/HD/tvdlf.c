@@ -39,6 +39,7 @@ void LF_Solver (const State_1D *state, int beg, int end,
   int    nv, i;
   static real **fL, **fR, **vRL;
   static real *cRL_min, *cRL_max, *pL, *pR, *a2L, *a2R;
+  OMP_PRAGMA(omp threadprivate(fL, fR, vRL, cRL_min, cRL_max, pL, pR, a2L, a2R))
   double *uR, *uL;
   
   if (fR == NULL){
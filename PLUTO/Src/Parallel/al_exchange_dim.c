@@ -3,7 +3,11 @@
   \file
   \brief Fill the ghost boundaries along selected dimensions
 
-  Fill the ghost boundaries along selected dimensions
+  Fill the ghost boundaries along selected dimensions.
+  AL_Exchange_begin() and AL_Exchange_end() do the same for a single 
+  dimension with non-blocking calls, so that the caller can work on 
+  the zones away from the ghost regions while the messages are in 
+  flight.
 
   \author A. Malagoli (University of Chicago)
   \date Jul 17, 1999
@@ -93,3 +97,73 @@ int AL_Exchange_dim(char *buf, int *dims, int sz_ptr)
 
   return (int) AL_SUCCESS;
 }
+
+/* ********************************************************************* */
+int AL_Exchange_begin(char *buf, int nd, int sz_ptr, MPI_Request *req)
+/*!
+ * Start filling the ghost boundaries along dimension nd.
+ * The receives and sends are posted with MPI_Irecv and MPI_Isend
+ * and must be completed by AL_Exchange_end() with the same
+ * request array. Until then, the ghost zones of buf along nd
+ * may not be accessed and the zones being sent (the first and 
+ * last bg[nd] layers of the local domain, ghost zones of the 
+ * other dimensions included) may not be modified.
+ * Only one dimension can be in flight: the ghost regions of 
+ * the later dimensions contain the corners filled by the 
+ * earlier ones.
+ *
+ * \param [in]  buf     pointer to buffer
+ * \param [in]  nd      the dimension to be exchanged
+ * \param [in]  sz_ptr  integer pointer to the distributed array descriptor
+ * \param [out] req     array of 4 requests 
+ *********************************************************************** */
+{
+  int gp;
+  MPI_Comm comm;
+  SZ *s;
+
+  /* DIAGNOSTICS
+    Check that sz_ptr points to an allocated SZ
+  */
+  if( stack_ptr[sz_ptr] == AL_STACK_FREE){
+    printf("AL_Exchange_begin: wrong SZ pointer\n");
+  }
+
+  s = sz_stack[sz_ptr];
+  comm = s->comm;
+  gp = s->bg[nd];
+
+  /* If gp=0, do nothing */
+  if( gp == 0 ){
+    req[0] = req[1] = req[2] = req[3] = MPI_REQUEST_NULL;
+    return (int) AL_SUCCESS;
+  }
+
+  /* Post the receives first */
+  MPI_Irecv(&buf[s->recvb1[nd]], 1, s->type_rl[nd], s->right[nd],
+            s->tag1[nd], comm, &req[0]);
+  MPI_Irecv(&buf[s->recvb2[nd]], 1, s->type_lr[nd], s->left[nd],
+            s->tag2[nd], comm, &req[1]);
+
+  MPI_Isend(&buf[s->sendb1[nd]], 1, s->type_rl[nd], s->left[nd],
+            s->tag1[nd], comm, &req[2]);
+  MPI_Isend(&buf[s->sendb2[nd]], 1, s->type_lr[nd], s->right[nd],
+            s->tag2[nd], comm, &req[3]);
+
+  return (int) AL_SUCCESS;
+}
+
+/* ********************************************************************* */
+int AL_Exchange_end(MPI_Request *req)
+/*!
+ * Complete the exchange started by AL_Exchange_begin().
+ *
+ * \param [in,out] req  array of 4 requests
+ *********************************************************************** */
+{
+  MPI_Status status[4];
+
+  MPI_Waitall(4, req, status);
+
+  return (int) AL_SUCCESS;
+}
@@ -28,8 +28,15 @@ int AL_Init(int *argc, char ***argv)
 
   errcode = MPI_Initialized(&flag);
 
-  if( !flag ) 
+  if( !flag ){
+#ifdef USE_HDF5
+    /* The HDF5 files may be written by a background thread (hdf5_io.c) */
+    int provided;
+    errcode = MPI_Init_thread(argc, argv, MPI_THREAD_MULTIPLE, &provided);
+#else
     errcode = MPI_Init(argc, argv);
+#endif
+  }
 
   MPI_Comm_rank(MPI_COMM_WORLD, &myrank);
   MPI_Comm_size(MPI_COMM_WORLD, &nproc);
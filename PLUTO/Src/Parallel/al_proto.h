@@ -67,6 +67,8 @@ extern int AL_Type_create_subarray(int, int *, int *, int *, int, MPI_Datatype,
 extern void *AL_Allocate_array(int);
 extern int AL_Exchange( void *, int);
 extern int AL_Exchange_dim(char *, int *, int);
+extern int AL_Exchange_begin(char *, int, int, MPI_Request *);
+extern int AL_Exchange_end(MPI_Request *);
 extern int AL_Exchange_periods (void *vbuf, int *periods, int sz_ptr);
 
 extern int AL_File_open(char *, int);
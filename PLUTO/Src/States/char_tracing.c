@@ -60,6 +60,7 @@ void CharTracingStep(const State_1D *state, int beg, int end, Grid *grid)
   double Spp, Smm;
   double *vc, *vp, *vm, **L, **R, *lambda;
   static double **src;
+  OMP_PRAGMA(omp threadprivate(src))
 
   if (src == NULL){
     src = ARRAY_2D(NMAX_POINT, NVAR, double);
@@ -246,6 +247,7 @@ void CharTracingStep(const State_1D *state, int beg, int end, Grid *grid)
    double betaL[NVAR], betaR[NVAR];
   #endif
   static double **src;
+  OMP_PRAGMA(omp threadprivate(src))
 
 /* --------------------------------------------
     allocate memory and set pointer shortcuts
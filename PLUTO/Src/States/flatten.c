@@ -92,6 +92,7 @@ void Flatten (const State_1D *state, int beg, int end, Grid *grid)
   double scrh, dp, d2p, min_p, vf, fj;
   real **v, **vp, **vm;
   static real *f_t;
+  OMP_PRAGMA(omp threadprivate(f_t))
    
   #if EOS == ISOTHERMAL 
    int PR = DN;
@@ -153,6 +154,7 @@ void Flatten (const State_1D *state, int beg, int end, Grid *grid)
   real   scrh1, scrh2, scrh3;
   real **a, **ap, **am;
   static real  *f_t, *fj, *dp, *d2p, *min_p;
+  OMP_PRAGMA(omp threadprivate(f_t, fj, dp, d2p, min_p))
    
   #if EOS == ISOTHERMAL 
    int PR = DN;
@@ -50,6 +50,7 @@ void HancockStep (const State_1D *state, int beg, int end, Grid *grid)
   double Adv[NVAR], dv[NVAR];
   double *vp, *vm, *vc;
   static double **src, *d_dl;
+  OMP_PRAGMA(omp threadprivate(src, d_dl))
 
 /* -----------------------------------------
          Check scheme compatibility
@@ -147,6 +148,7 @@ void HancockStep (const State_1D *state, int beg, int end, Grid *grid)
   static double **fp, **fm, **uh, **u;
   static double *pp, *pm, *hp, *hm;
   static double *lambda_max, *lambda_min;
+  OMP_PRAGMA(omp threadprivate(fp, fm, uh, u, pp, pm, hp, hm, lambda_max, lambda_min))
 
   #if GEOMETRY != CARTESIAN && GEOMETRY != CYLINDRICAL
    print1 ("! Hancock does not work in this geometry \n");
@@ -25,6 +25,7 @@ void States (const State_1D *state, int beg, int end, Grid *grid)
   double dmm;
   double **v, *vp, *vm, *dvp, *dvm, *dx;
   static double **dv;
+  OMP_PRAGMA(omp threadprivate(dv))
   double **L, **R, *lambda;
   double dwp[NVAR], dwp_lim[NVAR];
   double dwm[NVAR], dwm_lim[NVAR];
@@ -79,6 +79,7 @@ void States (const State_1D *state, int beg, int end, Grid *grid)
    double *dfg, *df2g, *dfL, *dfR;
   #endif
   static double **dvF;
+  OMP_PRAGMA(omp threadprivate(dvF))
 
   #if LIMITER == FOURTH_ORDER_LIM
    FourthOrderLinear(state, beg, end, grid);
@@ -384,6 +385,7 @@ void FourthOrderLinear(const State_1D *state, int beg, int end, Grid *grid)
   int    i, nv;
   static double **s;
   static double **dv, **dvf, **dvc, **dvlim; 
+  OMP_PRAGMA(omp threadprivate(s, dv, dvf, dvc, dvlim))
   double scrh, dvp, dvm, dvl;
   double **v, **vp, **vm;
 
@@ -528,6 +530,7 @@ void States (const State_1D *state, int beg, int end,  Grid *grid)
    double betaL[NVAR], betaR[NVAR];
   #endif
   static double **dvF;
+  OMP_PRAGMA(omp threadprivate(dvF))
 
 /* --------------------------------------------
     allocate memory and set pointer shortcuts
@@ -88,6 +88,7 @@ void States (const State_1D *state, int beg, int end, Grid *grid)
   double *dvp, *dvm, dp, dm, d2, dc;
   static double  **dvF, **dvlim, **vR;
   static double **aa, **bb, **cc, **dd, **ee;
+  OMP_PRAGMA(omp threadprivate(dvF, dvlim, vR, aa, bb, cc, dd, ee))
 
 /* --------------------------------------------------- 
      PPM stencil is +- 2 zones:
@@ -274,6 +275,7 @@ void States (const State_1D *state, int beg, int end, Grid *grid)
   double tau, a0, a1, w0, w1;
   const double one_sixth = 1.0/6.0;
   static double  **dvF;
+  OMP_PRAGMA(omp threadprivate(dvF))
 
 /* --------------------------------------------
        local array memory allocation
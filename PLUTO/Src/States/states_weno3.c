@@ -10,6 +10,8 @@ void States (const State_1D *state, int beg, int end, Grid *grid)
  *
  *   Provide a three-point stencil, third-order 
  *   reconstruction algorithm based on the WENO3.
+ *   With SOA_KERNELS the limiter on primitive variables
+ *   runs on a copy of the pencil indexed [nv][i].
  *
  *
  * LAST MODIFIED
@@ -31,9 +33,20 @@ void States (const State_1D *state, int beg, int end, Grid *grid)
   double dvpR, dvmR;
   static double **Rg, **Lg, **Pg, **Mg; /* -- interpolation coeffs -- */
   static double **dv;
+  #if SOA_KERNELS == YES
+   double dvpi, dvmi, *q, *qp, *qm;
+   static double **vs, **vps, **vms;
+   OMP_PRAGMA(omp threadprivate(vs, vps, vms))
+  #endif
+  OMP_PRAGMA(omp threadprivate(Rg, Lg, Pg, Mg, dv))
 
   if (dv == NULL) {
     dv = ARRAY_2D(NMAX_POINT, NVAR, double);
+    #if SOA_KERNELS == YES
+     vs  = ALIGNED_ARRAY_2D(NVAR, NMAX_POINT, double);
+     vps = ALIGNED_ARRAY_2D(NVAR, NMAX_POINT, double);
+     vms = ALIGNED_ARRAY_2D(NVAR, NMAX_POINT, double);
+    #endif
     Rg = ARRAY_2D(DIMENSIONS, NMAX_POINT, double);
     Lg = ARRAY_2D(DIMENSIONS, NMAX_POINT, double);
     Pg = ARRAY_2D(DIMENSIONS, NMAX_POINT, double);
@@ -50,7 +63,50 @@ void States (const State_1D *state, int beg, int end, Grid *grid)
     compute slopes and left and right interface values 
    ---------------------------------------------------- */
 
-  #if CHAR_LIMITING == NO  /* ----------------------------------------
+  #if CHAR_LIMITING == NO && SOA_KERNELS == YES  /* ------------------
+                                 Limiter on primitive variables, 
+                                 vectorized over the zones
+                              ----------------------------------------  */
+   StateToSoA (v, vs, NVAR, beg - 1, end + 1);
+   for (nv = 0; nv < NVAR; nv++){
+     q = vs[nv]; qp = vps[nv]; qm = vms[nv];
+     SIMD_LOOP
+     for (i = beg; i <= end; i++){
+       dvpi = q[i + 1] - q[i];
+       dvmi = q[i] - q[i - 1];
+
+       dx2 = dx[i]*dx[i];
+       b0  = dvpi*dvpi + dx2;
+       b1  = dvmi*dvmi + dx2;
+
+       tau = dvpi - dvmi;
+       tau = tau*tau;
+
+       S0 = 1.0 + tau/b0;
+       S1 = 1.0 + tau/b1;
+
+       qp[i] = q[i] + (S0*R[i]*dvpi + P[i]*S1*R[i-1]*dvmi)
+                     /(S0 + P[i]*S1);
+       qm[i] = q[i] - (M[i]*S0*L[i]*dvpi + S1*L[i-1]*dvmi)
+                     /(M[i]*S0 + S1);
+     }
+   }
+   SoAToState (vps, state->vp, NVAR, beg, end);
+   SoAToState (vms, state->vm, NVAR, beg, end);
+
+ /* -- differences used by the positivity check below -- */
+
+   for (i = beg-1; i <= end; i++){
+     dv[i][RHO] = v[i+1][RHO] - v[i][RHO];
+     #if EOS != ISOTHERMAL && EOS != BAROTROPIC
+      dv[i][PRS] = v[i+1][PRS] - v[i][PRS];
+     #endif
+     #if ENTROPY_SWITCH == YES
+      dv[i][ENTR] = v[i+1][ENTR] - v[i][ENTR];
+     #endif
+   }
+
+  #elif CHAR_LIMITING == NO  /* ----------------------------------------
                                  Limiter on primitive variables
                               ----------------------------------------  */
    for (i = beg-1; i <= end; i++){
@@ -8,6 +8,12 @@
   Equations are advanced in time by taking contribution only from the 
   direction defined by the global variable ::g_dir.
   A full step requires as many calls as the number of DIMENSIONS.
+  With THREADED_SWEEPS the pencils are shared among the OpenMP 
+  threads, each with its own State_1D and copy of Time_Step.
+  In parallel runs, the pencils which do not touch the ghost zones 
+  of the parallel directions are advanced while these are being 
+  exchanged (see BoundaryBegin()), the others once the exchange 
+  is complete.
 
   \authors A. Mignone (mignone@ph.unito.it)\n
            P. Tzeferacos (petros.tzeferacos@ph.unito.it)\n
@@ -27,6 +33,21 @@
  #define BOUND_DIR (ALL_DIR)
 #endif
 
+/* ------------------------------------------------
+    Direction of the pencils that can be advanced
+    during the exchange of ghost zones: none when 
+    these are needed before the sweep starts.
+   ------------------------------------------------ */
+
+#if (SHOCK_FLATTENING == MULTID) || (PARABOLIC_FLUX & EXPLICIT) \
+    || (UPDATE_VECTOR_POTENTIAL == YES)
+ #define OVERLAP_DIR  (-1)
+#else
+ #define OVERLAP_DIR  g_dir
+#endif
+
+static int AwayFromHalo (const Index *, Grid *);
+
 /* ********************************************************************* */
 int Sweep (const Data *d, Riemann_Solver *Riemann, 
            Time_Step *Dts, Grid *grid)
@@ -42,10 +63,9 @@ int Sweep (const Data *d, Riemann_Solver *Riemann,
  *********************************************************************** */
 {
   int  ii, jj, kk;
-  int  *i, *j, *k;
-  int  in, nv;
+  int  nv, halo, pass;
   Index indx;
-  double dt, dl2, *inv_dl;
+  double dt;
   static Data_Arr UU;
   static State_1D state;
   static double one_third = 1.0/3.0, **dcoeff;
@@ -53,6 +73,7 @@ int Sweep (const Data *d, Riemann_Solver *Riemann,
    static Data_Arr Vres;
   #endif
 static double **u;
+  OMP_PRAGMA(omp threadprivate(state, u))
   
 /* -----------------------------------------------------------------
                Check algorithm compatibilities
@@ -67,7 +88,7 @@ static double **u;
                       Allocate memory
    ----------------------------------------------------------------- */
 
-  if (state.rhs == NULL){
+  if (UU == NULL){
     MakeState (&state);
 u = ARRAY_2D(NMAX_POINT, NVAR, double);
      UU = ARRAY_4D(NX3_TOT, NX2_TOT, NX1_TOT, NVAR, double);
@@ -85,7 +106,21 @@ u = ARRAY_2D(NMAX_POINT, NVAR, double);
   g_intStage = 1;
   dt = g_dt;
 
-  Boundary (d, BOUND_DIR, grid);
+/* -------------------------------------------------
+    Convert primitive to conservative (the ghost 
+    zones of UU are rewritten by the pencils below,
+    so this is done before they are filled)
+   ------------------------------------------------- */
+   
+  KTOT_LOOP(kk) JTOT_LOOP(jj){
+    ITOT_LOOP(ii){
+      for (nv = NVAR; nv--;  ) state.v[ii][nv] = d->Vc[nv][kk][jj][ii];
+    }
+    PrimToCons(state.v, UU[kk][jj], 0, NX1_TOT-1);
+  }
+
+  halo = BoundaryBegin (d, BOUND_DIR, OVERLAP_DIR, grid);
+  if (!halo) BoundaryEnd (d, grid);
   #if SHOCK_FLATTENING == MULTID
    FindShock (d, grid);
   #endif
@@ -97,24 +132,29 @@ u = ARRAY_2D(NMAX_POINT, NVAR, double);
    }}
   #endif
 
-/* -----------------------------------------
-    Convert primitive to conservative 
-   ----------------------------------------- */
-   
-  KTOT_LOOP(kk) JTOT_LOOP(jj){
-    ITOT_LOOP(ii){
-      for (nv = NVAR; nv--;  ) state.v[ii][nv] = d->Vc[nv][kk][jj][ii];
-    }
-    PrimToCons(state.v, UU[kk][jj], 0, NX1_TOT-1);
-  }
-
 /* -------------------------------------------------
               Integration Loop
    ------------------------------------------------- */
 
   SetIndexes (&indx, grid);
+  for (pass = !halo; pass <= 1; pass++){
+  if (pass == 1 && halo) BoundaryEnd (d, grid);
+  OMP_PRAGMA(omp parallel if (THREADED_SWEEPS) firstprivate(indx) \
+                       copyin(g_maxMach, g_maxRiemannIter))
+  {
+  int  *i, *j, *k;
+  int  in, nv, it;
+  double dl2, *inv_dl;
+  Time_Step Dts_t;
+
+  if (state.rhs == NULL){   /* -- first sweep of a thread -- */
+    MakeState (&state);
+    u = ARRAY_2D(NMAX_POINT, NVAR, double);
+  }
   ResetState (d, &state, grid);
-  TRANSVERSE_LOOP(indx,in,i,j,k){  
+  SetThreadTimeStep (Dts, &Dts_t);
+  THREAD_TRANSVERSE_LOOP(indx,in,i,j,k,it){  
+    if (halo && (pass == 0) != AwayFromHalo (&indx, grid)) continue;
 
     inv_dl = GetInverse_dl(grid);
 
@@ -134,7 +174,7 @@ PrimToCons (state.v, u, 0, indx.ntot - 1);
     #endif
 
     States  (&state, indx.beg - 1, indx.end + 1, grid);
-    Riemann (&state, indx.beg - 1, indx.end, Dts->cmax, grid);
+    Riemann (&state, indx.beg - 1, indx.end, Dts_t.cmax, grid);
 
     #if (PARABOLIC_FLUX & EXPLICIT)/* !! will be first order in time 
                                                  for single step algorithm   !! */
@@ -144,25 +184,25 @@ PrimToCons (state.v, u, 0, indx.ntot - 1);
      VectorPotentialUpdate (d, NULL, &state, grid);
     #endif
 
-    RightHandSide (&state, Dts, indx.beg, indx.end, dt, grid);
+    RightHandSide (&state, &Dts_t, indx.beg, indx.end, dt, grid);
 
     for (in = indx.beg; in <= indx.end; in++) {
 #if !GET_MAX_DT
-      Dts->inv_dta = MAX(Dts->inv_dta, Dts->cmax[in]*inv_dl[in]);
+      Dts_t.inv_dta = MAX(Dts_t.inv_dta, Dts_t.cmax[in]*inv_dl[in]);
 #endif
       #if VISCOSITY == EXPLICIT
        dl2 = inv_dl[in]*inv_dl[in];
-       Dts->inv_dtp = MAX(Dts->inv_dtp, dcoeff[in][MX1]*dl2);
+       Dts_t.inv_dtp = MAX(Dts_t.inv_dtp, dcoeff[in][MX1]*dl2);
       #endif
       #if RESISTIVE_MHD == EXPLICIT
        dl2 = inv_dl[in]*inv_dl[in];
-       EXPAND(Dts->inv_dtp = MAX(Dts->inv_dtp, dcoeff[in][BX1]*dl2); ,
-              Dts->inv_dtp = MAX(Dts->inv_dtp, dcoeff[in][BX2]*dl2); ,
-              Dts->inv_dtp = MAX(Dts->inv_dtp, dcoeff[in][BX3]*dl2);)
+       EXPAND(Dts_t.inv_dtp = MAX(Dts_t.inv_dtp, dcoeff[in][BX1]*dl2); ,
+              Dts_t.inv_dtp = MAX(Dts_t.inv_dtp, dcoeff[in][BX2]*dl2); ,
+              Dts_t.inv_dtp = MAX(Dts_t.inv_dtp, dcoeff[in][BX3]*dl2);)
       #endif
       #if THERMAL_CONDUCTION == EXPLICIT
        dl2 = inv_dl[in]*inv_dl[in];
-       Dts->inv_dtp = MAX(Dts->inv_dtp, dcoeff[in][ENG]*dl2);
+       Dts_t.inv_dtp = MAX(Dts_t.inv_dtp, dcoeff[in][ENG]*dl2);
       #endif
       for (nv = NVAR; nv--;  ) {
         u[in][nv] += state.rhs[in][nv];
@@ -175,6 +215,9 @@ PrimToCons (state.v, u, 0, indx.ntot - 1);
       d->Vc[nv][*k][*j][*i] = state.v[in][nv];
     }}
   }
+  ReduceThreadTimeStep (Dts, &Dts_t);
+  }  /* -- end of parallel region -- */
+  }  /* -- end of loop on passes -- */
 
 /* ----------------------------------------------------
                    STEP II  (or CORRECTOR)
@@ -183,7 +226,8 @@ PrimToCons (state.v, u, 0, indx.ntot - 1);
 #if (TIME_STEPPING == RK2) || (TIME_STEPPING == RK3)
 
   g_intStage = 2;
-  Boundary (d, BOUND_DIR, grid);
+  halo = BoundaryBegin (d, BOUND_DIR, OVERLAP_DIR, grid);
+  if (!halo) BoundaryEnd (d, grid);
   #if (PARABOLIC_FLUX & EXPLICIT)
    for (nv = 0; nv < NVAR; nv++){
    TOT_LOOP(kk,jj,ii){
@@ -191,8 +235,23 @@ PrimToCons (state.v, u, 0, indx.ntot - 1);
    }}
   #endif
 
+  for (pass = !halo; pass <= 1; pass++){
+  if (pass == 1 && halo) BoundaryEnd (d, grid);
+  OMP_PRAGMA(omp parallel if (THREADED_SWEEPS) firstprivate(indx) \
+                       copyin(g_maxMach, g_maxRiemannIter))
+  {
+  int  *i, *j, *k;
+  int  in, nv, it;
+  Time_Step Dts_t;
+
+  if (state.rhs == NULL){   /* -- first sweep of a thread -- */
+    MakeState (&state);
+    u = ARRAY_2D(NMAX_POINT, NVAR, double);
+  }
   ResetState (d, &state, grid);
-  TRANSVERSE_LOOP(indx,in,i,j,k){  
+  SetThreadTimeStep (Dts, &Dts_t);
+  THREAD_TRANSVERSE_LOOP(indx,in,i,j,k,it){  
+    if (halo && (pass == 0) != AwayFromHalo (&indx, grid)) continue;
 
     for (in = 0; in < indx.ntot; in++) {
     for (nv = NVAR; nv--;  ) {
@@ -201,7 +260,7 @@ PrimToCons (state.v, u, 0, indx.ntot - 1);
 
     PrimToCons (state.v, u, 0, indx.ntot - 1);
     States  (&state, indx.beg - 1, indx.end + 1, grid);
-    Riemann (&state, indx.beg - 1, indx.end, Dts->cmax, grid);
+    Riemann (&state, indx.beg - 1, indx.end, Dts_t.cmax, grid);
     #if (PARABOLIC_FLUX & EXPLICIT)
      ParabolicFlux(Vres, &state, dcoeff, indx.beg - 1, indx.end, grid);
     #endif
@@ -209,7 +268,7 @@ PrimToCons (state.v, u, 0, indx.ntot - 1);
      VectorPotentialUpdate (d, NULL, &state, grid);
     #endif
 
-    RightHandSide (&state, Dts, indx.beg, indx.end, g_dt, grid);
+    RightHandSide (&state, &Dts_t, indx.beg, indx.end, g_dt, grid);
     for (in = indx.beg; in <= indx.end; in++) {
     for (nv = NVAR; nv--;  ) {
       #if TIME_STEPPING == RK2
@@ -226,6 +285,9 @@ PrimToCons (state.v, u, 0, indx.ntot - 1);
       d->Vc[nv][*k][*j][*i] = state.v[in][nv];
     }}
   }
+  ReduceThreadTimeStep (Dts, &Dts_t);
+  }  /* -- end of parallel region -- */
+  }  /* -- end of loop on passes -- */
 #endif
 
 /* ----------------------------------------------------
@@ -235,7 +297,8 @@ PrimToCons (state.v, u, 0, indx.ntot - 1);
 #if TIME_STEPPING == RK3 
 
   g_intStage = 3;
-  Boundary (d, BOUND_DIR, grid);
+  halo = BoundaryBegin (d, BOUND_DIR, OVERLAP_DIR, grid);
+  if (!halo) BoundaryEnd (d, grid);
 
   #if (PARABOLIC_FLUX & EXPLICIT)
    for (nv = 0; nv < NVAR; nv++){
@@ -244,8 +307,23 @@ PrimToCons (state.v, u, 0, indx.ntot - 1);
    }}
   #endif
 
+  for (pass = !halo; pass <= 1; pass++){
+  if (pass == 1 && halo) BoundaryEnd (d, grid);
+  OMP_PRAGMA(omp parallel if (THREADED_SWEEPS) firstprivate(indx) \
+                       copyin(g_maxMach, g_maxRiemannIter))
+  {
+  int  *i, *j, *k;
+  int  in, nv, it;
+  Time_Step Dts_t;
+
+  if (state.rhs == NULL){   /* -- first sweep of a thread -- */
+    MakeState (&state);
+    u = ARRAY_2D(NMAX_POINT, NVAR, double);
+  }
   ResetState (d, &state, grid);
-  TRANSVERSE_LOOP(indx,in,i,j,k){  
+  SetThreadTimeStep (Dts, &Dts_t);
+  THREAD_TRANSVERSE_LOOP(indx,in,i,j,k,it){  
+    if (halo && (pass == 0) != AwayFromHalo (&indx, grid)) continue;
 
     for (in = 0; in < indx.ntot; in++) {
     for (nv = NVAR; nv--;  ) {
@@ -254,7 +332,7 @@ PrimToCons (state.v, u, 0, indx.ntot - 1);
       
     PrimToCons (state.v, u, 0, indx.ntot - 1);
     States  (&state, indx.beg - 1, indx.end + 1, grid);
-    Riemann (&state, indx.beg - 1, indx.end, Dts->cmax, grid);
+    Riemann (&state, indx.beg - 1, indx.end, Dts_t.cmax, grid);
     #if (PARABOLIC_FLUX & EXPLICIT)
      ParabolicFlux (Vres, &state, dcoeff, indx.beg - 1, indx.end, grid);
     #endif
@@ -262,7 +340,7 @@ PrimToCons (state.v, u, 0, indx.ntot - 1);
      VectorPotentialUpdate (d, NULL, &state, grid);
     #endif
 
-    RightHandSide (&state, Dts, indx.beg, indx.end, g_dt, grid);
+    RightHandSide (&state, &Dts_t, indx.beg, indx.end, g_dt, grid);
 
     for (in = indx.beg; in <= indx.end; in++) {
     for (nv = NVAR; nv--;  ) {
@@ -278,9 +356,36 @@ PrimToCons (state.v, u, 0, indx.ntot - 1);
     }}
 
   }
+  ReduceThreadTimeStep (Dts, &Dts_t);
+  }  /* -- end of parallel region -- */
+  }  /* -- end of loop on passes -- */
   
 #endif
 
   return(0); /* -- step has been achieved, return success -- */
 }
 
+
+/* ********************************************************************* */
+static int AwayFromHalo (const Index *indx, Grid *grid)
+/*!
+ * Return 1 if the current pencil lies at least nghost zones away 
+ * from the sides of the parallel transverse directions, i.e., if it
+ * neither reads the ghost zones being received nor writes the zones
+ * being sent after BoundaryBegin().
+ *
+ * \param [in] indx  pointer to the Index structure of the pencil
+ * \param [in] grid  pointer to an array of Grid structures
+ *********************************************************************** */
+{
+  Grid *G1, *G2;
+
+  G1 = grid + (g_dir == IDIR ? JDIR:IDIR);
+  G2 = grid + (g_dir == KDIR ? JDIR:KDIR);
+
+  if (G1->nproc > 1 && (   indx->t1 < G1->lbeg + G1->nghost
+                        || indx->t1 > G1->lend - G1->nghost)) return 0;
+  if (G2->nproc > 1 && (   indx->t2 < G2->lbeg + G2->nghost
+                        || indx->t2 > G2->lend - G2->nghost)) return 0;
+  return 1;
+}
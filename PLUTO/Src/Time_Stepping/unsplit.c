@@ -7,6 +7,9 @@
   Main driver for RK unsplit integrations (DIMENSIONAL_SPLITTING == NO) 
   and for finite difference methods (RK3).
   Time stepping include Euler, RK2 and RK3.
+  With THREADED_SWEEPS the pencils of every direction are shared 
+  among the OpenMP threads, each with its own State_1D and copy of 
+  Time_Step.
 
   \authors A. Mignone (mignone@ph.unito.it)\n
            P. Tzeferacos (petros.tzeferacos@ph.unito.it)
@@ -30,14 +33,13 @@ int Unsplit (const Data *d, Riemann_Solver *Riemann,
  *********************************************************************** */
 {
   int  ii, jj, kk;
-  int  *i, *j, *k;
-  int  in, nv;
+  int  nv;
   
   static double  one_third = 1.0/3.0;
   static State_1D state;
+  OMP_PRAGMA(omp threadprivate(state))
   static Data_Arr UU, UU_1;
   double dt;
-  double *inv_dl, dl2;
   static double ***C_dt[NVAR], **dcoeff;
   Index indx;
 
@@ -45,7 +47,7 @@ int Unsplit (const Data *d, Riemann_Solver *Riemann,
                    Allocate memory 
    ---------------------------------------------------- */
 
-  if (state.rhs == NULL){
+  if (UU == NULL){
     MakeState (&state);
     UU      = ARRAY_4D(NX3_TOT, NX2_TOT, NX1_TOT, NVAR, double);
     UU_1    = ARRAY_4D(NX3_TOT, NX2_TOT, NX1_TOT, NVAR, double);
@@ -145,8 +147,18 @@ int Unsplit (const Data *d, Riemann_Solver *Riemann,
   for (g_dir = 0; g_dir < DIMENSIONS; g_dir++){
   
     SetIndexes (&indx, grid);  /* -- set normal and transverse indices -- */
+    OMP_PRAGMA(omp parallel if (THREADED_SWEEPS) firstprivate(indx) \
+                         copyin(g_maxMach, g_maxRiemannIter))
+    {
+    int  *i, *j, *k;
+    int  in, nv, it;
+    double *inv_dl, dl2;
+    Time_Step Dts_t;
+
+    if (state.rhs == NULL) MakeState (&state);  /* -- first sweep of a thread -- */
     ResetState (d, &state, grid);
-    TRANSVERSE_LOOP(indx,in,i,j,k){  
+    SetThreadTimeStep (Dts, &Dts_t);
+    THREAD_TRANSVERSE_LOOP(indx,in,i,j,k,it){  
 
       inv_dl = GetInverse_dl(grid);
 
@@ -160,7 +172,7 @@ int Unsplit (const Data *d, Riemann_Solver *Riemann,
       }
       CheckNaN (state.v, 0, indx.ntot-1,0);
       States  (&state, indx.beg - 1, indx.end + 1, grid); 
-      Riemann (&state, indx.beg - 1, indx.end, Dts->cmax, grid);
+      Riemann (&state, indx.beg - 1, indx.end, Dts_t.cmax, grid);
       #ifdef STAGGERED_MHD
        CT_StoreEMF (&state, indx.beg - 1, indx.end, grid);
       #endif
@@ -174,10 +186,10 @@ int Unsplit (const Data *d, Riemann_Solver *Riemann,
        SB_SaveFluxes (&state, grid);
       #endif
 
-      RightHandSide (&state, Dts, indx.beg, indx.end, dt, grid);
+      RightHandSide (&state, &Dts_t, indx.beg, indx.end, dt, grid);
       for (in = indx.beg; in <= indx.end; in++) { 
         #if !GET_MAX_DT
-         C_dt[0][*k][*j][*i] += 0.5*(Dts->cmax[in-1] + Dts->cmax[in])*inv_dl[in];
+         C_dt[0][*k][*j][*i] += 0.5*(Dts_t.cmax[in-1] + Dts_t.cmax[in])*inv_dl[in];
         #endif
         #if VISCOSITY == EXPLICIT
          dl2 = 0.5*inv_dl[in]*inv_dl[in];
@@ -196,6 +208,8 @@ int Unsplit (const Data *d, Riemann_Solver *Riemann,
         for (nv = NVAR; nv--;  )  UU_1[*k][*j][*i][nv] += state.rhs[in][nv];
       }
     }
+    ReduceThreadTimeStep (Dts, &Dts_t);
+    }  /* -- end of parallel region -- */
   }
 
   #ifdef SHEARINGBOX 
@@ -262,8 +276,17 @@ int Unsplit (const Data *d, Riemann_Solver *Riemann,
    for (g_dir = 0; g_dir < DIMENSIONS; g_dir++){
 
      SetIndexes (&indx, grid);    /* -- set normal and transverse indices -- */
+     OMP_PRAGMA(omp parallel if (THREADED_SWEEPS) firstprivate(indx) \
+                          copyin(g_maxMach, g_maxRiemannIter))
+     {
+     int  *i, *j, *k;
+     int  in, nv, it;
+     Time_Step Dts_t;
+
+     if (state.rhs == NULL) MakeState (&state);  /* -- first sweep of a thread -- */
      ResetState (d, &state, grid);
-     TRANSVERSE_LOOP(indx,in,i,j,k){  
+     SetThreadTimeStep (Dts, &Dts_t);
+     THREAD_TRANSVERSE_LOOP(indx,in,i,j,k,it){  
 
        for (in = 0; in < indx.ntot; in++) {
          for (nv = NVAR; nv--;  ) state.v[in][nv] = d->Vc[nv][*k][*j][*i];
@@ -273,7 +296,7 @@ int Unsplit (const Data *d, Riemann_Solver *Riemann,
        }
 
        States  (&state, indx.beg - 1, indx.end + 1, grid);     
-       Riemann (&state, indx.beg - 1, indx.end, Dts->cmax, grid);
+       Riemann (&state, indx.beg - 1, indx.end, Dts_t.cmax, grid);
        #ifdef STAGGERED_MHD
         CT_StoreEMF (&state, indx.beg - 1, indx.end, grid);
        #endif
@@ -288,13 +311,15 @@ int Unsplit (const Data *d, Riemann_Solver *Riemann,
        #ifdef SHEARINGBOX
         SB_SaveFluxes (&state, grid);
        #endif
-       RightHandSide (&state, Dts, indx.beg, indx.end, dt, grid);
+       RightHandSide (&state, &Dts_t, indx.beg, indx.end, dt, grid);
       
        for (in = indx.beg; in <= indx.end; in++) {
        for (nv = NVAR; nv--;  ) {
          UU_1[*k][*j][*i][nv] += state.rhs[in][nv];
        }}
      }
+     ReduceThreadTimeStep (Dts, &Dts_t);
+     }  /* -- end of parallel region -- */
    }
 
    #ifdef SHEARINGBOX
@@ -356,8 +381,17 @@ int Unsplit (const Data *d, Riemann_Solver *Riemann,
    for (g_dir = 0; g_dir < DIMENSIONS; g_dir++){
 
      SetIndexes (&indx, grid);  /* -- set normal and transverse indices -- */
+     OMP_PRAGMA(omp parallel if (THREADED_SWEEPS) firstprivate(indx) \
+                          copyin(g_maxMach, g_maxRiemannIter))
+     {
+     int  *i, *j, *k;
+     int  in, nv, it;
+     Time_Step Dts_t;
+
+     if (state.rhs == NULL) MakeState (&state);  /* -- first sweep of a thread -- */
      ResetState (d, &state, grid);
-     TRANSVERSE_LOOP(indx,in,i,j,k){  
+     SetThreadTimeStep (Dts, &Dts_t);
+     THREAD_TRANSVERSE_LOOP(indx,in,i,j,k,it){  
 
        for (in = 0; in < indx.ntot; in++) {
          for (nv = NVAR; nv--;  ) state.v[in][nv] = d->Vc[nv][*k][*j][*i];
@@ -367,7 +401,7 @@ int Unsplit (const Data *d, Riemann_Solver *Riemann,
        }
 
        States  (&state, indx.beg - 1, indx.end + 1, grid);
-       Riemann (&state, indx.beg - 1, indx.end, Dts->cmax, grid);
+       Riemann (&state, indx.beg - 1, indx.end, Dts_t.cmax, grid);
        #ifdef STAGGERED_MHD
         CT_StoreEMF (&state, indx.beg - 1, indx.end, grid);
        #endif
@@ -382,13 +416,15 @@ int Unsplit (const Data *d, Riemann_Solver *Riemann,
        #ifdef SHEARINGBOX
         SB_SaveFluxes (&state, grid);
        #endif
-       RightHandSide (&state, Dts, indx.beg, indx.end, dt, grid);
+       RightHandSide (&state, &Dts_t, indx.beg, indx.end, dt, grid);
 
        for (in = indx.beg; in <= indx.end; in++) {
        for (nv = NVAR; nv--;  ) {
          UU_1[*k][*j][*i][nv] += state.rhs[in][nv];
        }}
      }
+     ReduceThreadTimeStep (Dts, &Dts_t);
+     }  /* -- end of parallel region -- */
    }
 
    #ifdef SHEARINGBOX
@@ -9,6 +9,9 @@
   used to allocate storage for 1-D, 2-D, 3-D and 4-D arrays 
   of any data type with indices starting at 0.
 
+  The function AlignedArray2D() allocates rows aligned for the 
+  vectorized (SIMD) kernels.
+
   The function ArrayBox() can be used to allocate memory for 
   a double precision array with specified index range.
 
@@ -81,6 +84,7 @@ char *Array1D (int nx, size_t dsize)
   char *v;
   v = (char *) malloc (nx*dsize);
   PlutoError (!v, "Allocation failure in Array1D");
+  OMP_PRAGMA(omp atomic)
   g_usedMem += nx*dsize;
 
   #if NONZERO_INITIALIZE == YES
@@ -118,6 +122,7 @@ char **Array2D (int nx, int ny, size_t dsize)
  
   for (i = 1; i < nx; i++) m[i] = m[(i - 1)] + ny*dsize;
  
+  OMP_PRAGMA(omp atomic)
   g_usedMem += nx*ny*dsize;
 
   #if NONZERO_INITIALIZE == YES
@@ -135,6 +140,46 @@ char **Array2D (int nx, int ny, size_t dsize)
   return m;
 }
 
+/* ********************************************************************* */
+char **AlignedArray2D (int nx, int ny, size_t dsize)
+/*! 
+ * Allocate memory for a 2-D array whose rows start at addresses 
+ * which are multiples of SIMD_ALIGN bytes, as needed by the 
+ * vectorized kernels. Rows are padded to this length.
+ * The array is freed with FreeArray2D().
+ *
+ * \param [in] nx    number of rows
+ * \param [in] ny    number of elements in a row
+ * \param [in] dsize data-type of the array to be allocated
+ * 
+ * \return A pointer of type (char **) to the allocated memory area 
+ *         with index range [0...nx-1][0...ny-1]
+ *          
+ *********************************************************************** */
+{
+  int i;
+  size_t row;
+  char **m;
+  void *p = NULL;
+
+  row = (ny*dsize + SIMD_ALIGN - 1)/SIMD_ALIGN*SIMD_ALIGN;
+
+  m = (char **)malloc ((size_t) nx*sizeof(char *));
+  PlutoError (!m, "Allocation failure in AlignedArray2D (1)");
+  if (posix_memalign (&p, SIMD_ALIGN, nx*row) != 0){
+    PlutoError (1, "Allocation failure in AlignedArray2D (2)");
+    QUIT_PLUTO(1);
+  }
+  m[0] = (char *) p;
+
+  for (i = 1; i < nx; i++) m[i] = m[(i - 1)] + row;
+
+  OMP_PRAGMA(omp atomic)
+  g_usedMem += nx*row;
+
+  return m;
+}
+
 /* ********************************************************************* */
 char ***Array3D (int nx, int ny, int nz, size_t dsize)
 /*! 
@@ -191,6 +236,7 @@ char ***Array3D (int nx, int ny, int nz, size_t dsize)
     }
   }}
   
+  OMP_PRAGMA(omp atomic)
   g_usedMem += nx*ny*nz*dsize;
 
   #if NONZERO_INITIALIZE == YES
@@ -307,6 +353,7 @@ char ****Array4D (int nx, int ny, int nz, int nv, size_t dsize)
     }
   }
       
+  OMP_PRAGMA(omp atomic)
   g_usedMem += nx*ny*nz*nv*dsize;
 
   #if NONZERO_INITIALIZE == YES
@@ -19,6 +19,13 @@
   data values. 
   This step is done here only for parallel computations on static grids.
   
+  Boundary() may also be split into BoundaryBegin() and BoundaryEnd():
+  the first posts the exchange of the ghost zones along the first 
+  parallel dimension and returns while the messages are in flight, 
+  the second completes the exchange and sets the remaining physical 
+  boundaries. In between, Sweep() advances the pencils away from 
+  the ghost regions.
+
   Predefined physical boundary conditions are handled by the 
   following functions:
   
@@ -31,6 +38,16 @@
 */
 /* ///////////////////////////////////////////////////////////////////// */
 #include"pluto.h"
+
+static RBox center[8], x1face[8], x2face[8], x3face[8];
+static int  bnd_sbeg, bnd_send;  /* -- sides left to BoundaryEnd() -- */
+#ifdef PARALLEL
+ static int exch_dim;            /* -- dimension in flight, -1 if none -- */
+ static MPI_Request exch_req[NVAR + 3][4];
+ static void ExchangeBegin (const Data *, int);
+ static void ExchangeEnd   (const Data *);
+#endif
+static void PhysicalBoundary (const Data *, int, int, Grid *);
                            
 /* ********************************************************************* */
 void Boundary (const Data *d, int idim, Grid *grid)
@@ -51,13 +68,40 @@ void Boundary (const Data *d, int idim, Grid *grid)
  * \param [in]  grid   pointer to an array of grid structures.
  ******************************************************************* */
 {
-  int  is, nv;
-  int  side[6] = {X1_BEG, X1_END, X2_BEG, X2_END, X3_BEG, X3_END};
-  int  type[6], sbeg, send, vsign[NVAR];
-  int  par_dim[3] = {0, 0, 0};
+  BoundaryBegin (d, idim, -1, grid);
+  BoundaryEnd   (d, grid);
+}
+
+/* ********************************************************************* */
+int BoundaryBegin (const Data *d, int idim, int pdir, Grid *grid)
+/*!
+ * Start setting boundary conditions: call the user-defined internal
+ * boundary and post the exchange of ghost zones along the first 
+ * parallel dimension. Must be followed by BoundaryEnd().
+ *
+ * When pdir >= 0 and none of the directions up to pdir is split 
+ * among processors, the physical boundaries on these sides are set 
+ * before the exchange is posted (on the neighbors they are set the
+ * same way, so the corners received are unchanged). 
+ * The pencils along pdir which do not touch the first and last 
+ * NGHOST zones of the parallel directions can then be advanced 
+ * before BoundaryEnd() is called.
+ *
+ * \param [in,out] d    pointer to PLUTO Data structure 
+ * \param [in]    idim  the side(s) of the domain, see Boundary()
+ * \param [in]    pdir  the direction of the pencils to be advanced
+ *                      during the exchange, or -1
+ * \param [in]    grid  pointer to an array of grid structures.
+ *
+ * \return 1 if an exchange is in flight and the boundaries along 
+ *         the directions up to pdir have been set, 0 otherwise.
+ ******************************************************************* */
+{
+  int  overlap = 0;
   static int first_call = 1;
-  double ***q;
-  static RBox center[8], x1face[8], x2face[8], x3face[8];
+  #ifdef PARALLEL
+   int is;
+  #endif
 
 /* -----------------------------------------------------
      Set the boundary boxes on the six domain sides
@@ -72,14 +116,6 @@ void Boundary (const Data *d, int idim, Grid *grid)
    SetRBox(center, x1face, x2face, x3face);
   #endif
 
-/* ---------------------------------------------------
-    Check the number of processors in each direction
-   --------------------------------------------------- */
-
-  D_EXPAND(par_dim[0] = grid[IDIR].nproc > 1;  ,
-           par_dim[1] = grid[JDIR].nproc > 1;  ,
-           par_dim[2] = grid[KDIR].nproc > 1;)
-
 /* -------------------------------------------------
     Call userdef internal boundary with side == 0
    -------------------------------------------------  */
@@ -87,24 +123,6 @@ void Boundary (const Data *d, int idim, Grid *grid)
   #if INTERNAL_BOUNDARY == YES
    UserDefBoundary (d, NULL, 0, grid);
   #endif
-  
-/* -------------------------------------
-     Exchange data between processors 
-   ------------------------------------- */
-   
-  #ifdef PARALLEL
-   MPI_Barrier (MPI_COMM_WORLD);
-   for (nv = 0; nv < NVAR; nv++) {
-     AL_Exchange_dim ((char *)d->Vc[nv][0][0], par_dim, SZ);
-   }
-   #ifdef STAGGERED_MHD 
-    D_EXPAND(
-      AL_Exchange_dim ((char *)(d->Vs[BX1s][0][0] - 1), par_dim, SZ_stagx);  ,
-      AL_Exchange_dim ((char *)d->Vs[BX2s][0][-1]     , par_dim, SZ_stagy);  ,
-      AL_Exchange_dim ((char *)d->Vs[BX3s][-1][0]     , par_dim, SZ_stagz);)
-   #endif
-   MPI_Barrier (MPI_COMM_WORLD);
-  #endif
 
 /* ----------------------------------------------------------------
      When idim == ALL_DIR boundaries are imposed on ALL sides:
@@ -114,12 +132,132 @@ void Boundary (const Data *d, int idim, Grid *grid)
    ---------------------------------------------------------------- */ 
 
   if (idim == ALL_DIR) {
-    sbeg = 0;
-    send = 2*DIMENSIONS - 1;
+    bnd_sbeg = 0;
+    bnd_send = 2*DIMENSIONS - 1;
   } else {
-    sbeg = 2*idim;
-    send = 2*idim + 1;
+    bnd_sbeg = 2*idim;
+    bnd_send = 2*idim + 1;
+  }
+
+/* -------------------------------------------------------
+    Post the exchange along the first parallel dimension. 
+    Sides along the directions before it can be set now.
+   ------------------------------------------------------- */
+   
+  #ifdef PARALLEL
+   for (exch_dim = 0; exch_dim < DIMENSIONS; exch_dim++){
+     if (grid[exch_dim].nproc > 1) break;
+   }
+   if (exch_dim == DIMENSIONS) exch_dim = -1;
+
+   if (exch_dim > pdir && pdir >= 0){
+     is = MIN(bnd_send, 2*pdir + 1);
+     PhysicalBoundary (d, bnd_sbeg, is, grid);
+     bnd_sbeg = MAX(bnd_sbeg, is + 1);
+     overlap  = 1;
+   }
+   if (exch_dim >= 0) ExchangeBegin (d, exch_dim);
+  #endif
+
+  return overlap;
+}
+
+/* ********************************************************************* */
+void BoundaryEnd (const Data *d, Grid *grid)
+/*!
+ * Complete the exchange started by BoundaryBegin(), exchange the 
+ * ghost zones along the remaining parallel dimensions (one after 
+ * the other, so that corners are filled) and set the physical 
+ * boundaries not yet assigned.
+ *
+ * \param [in,out] d    pointer to PLUTO Data structure 
+ * \param [in]    grid  pointer to an array of grid structures.
+ ******************************************************************* */
+{
+  #ifdef PARALLEL
+   int nd;
+
+   if (exch_dim >= 0){
+     ExchangeEnd (d);
+     for (nd = exch_dim + 1; nd < DIMENSIONS; nd++){
+       if (grid[nd].nproc == 1) continue;
+       ExchangeBegin (d, nd);
+       ExchangeEnd   (d);
+     }
+     exch_dim = -1;
+   }
+  #endif
+
+  PhysicalBoundary (d, bnd_sbeg, bnd_send, grid);
+
+/* -- entropy boundary values are assigned in EntropySwitch -- */
+
+  #if ENTROPY_SWITCH == YES
+   EntropySwitch (d, grid); 
+  #endif
+}
+
+#ifdef PARALLEL
+/* ********************************************************************* */
+static void ExchangeBegin (const Data *d, int nd)
+/*!
+ * Post the exchange of all variables along dimension nd, so that
+ * the messages travel together rather than one after the other.
+ *********************************************************************** */
+{
+  int nv;
+
+  for (nv = 0; nv < NVAR; nv++) {
+    AL_Exchange_begin ((char *)d->Vc[nv][0][0], nd, SZ, exch_req[nv]);
   }
+  #ifdef STAGGERED_MHD 
+   D_EXPAND(
+     AL_Exchange_begin ((char *)(d->Vs[BX1s][0][0] - 1), nd, SZ_stagx, 
+                        exch_req[NVAR]);      ,
+     AL_Exchange_begin ((char *)d->Vs[BX2s][0][-1], nd, SZ_stagy, 
+                        exch_req[NVAR + 1]);  ,
+     AL_Exchange_begin ((char *)d->Vs[BX3s][-1][0], nd, SZ_stagz, 
+                        exch_req[NVAR + 2]);)
+  #endif
+}
+
+/* ********************************************************************* */
+static void ExchangeEnd (const Data *d)
+/*!
+ * Wait for the exchange posted by ExchangeBegin().
+ *********************************************************************** */
+{
+  int nv;
+
+  for (nv = 0; nv < NVAR; nv++) AL_Exchange_end (exch_req[nv]);
+  #ifdef STAGGERED_MHD 
+   D_EXPAND(AL_Exchange_end (exch_req[NVAR]);      ,
+            AL_Exchange_end (exch_req[NVAR + 1]);  ,
+            AL_Exchange_end (exch_req[NVAR + 2]);)
+  #endif
+}
+#endif
+
+/* ********************************************************************* */
+static void PhysicalBoundary (const Data *d, int sbeg, int send, Grid *grid)
+/*!
+ * Set the physical boundary conditions on the sides sbeg...send
+ * (X1_BEG = 0, X1_END = 1, ...). Sides shared with a neighboring 
+ * processor are skipped.
+ *********************************************************************** */
+{
+  int  is, nv;
+  int  side[6] = {X1_BEG, X1_END, X2_BEG, X2_END, X3_BEG, X3_END};
+  int  type[6], vsign[NVAR];
+  int  par_dim[3] = {0, 0, 0};
+
+/* ---------------------------------------------------
+    Check the number of processors in each direction
+   --------------------------------------------------- */
+
+  D_EXPAND(par_dim[0] = grid[IDIR].nproc > 1;  ,
+           par_dim[1] = grid[JDIR].nproc > 1;  ,
+           par_dim[2] = grid[KDIR].nproc > 1;)
 
 /* --------------------------------------------------------
         Main loop on computational domain sides
@@ -263,12 +401,6 @@ void Boundary (const Data *d, int idim, Grid *grid)
       #endif
     }
   }
-
-/* -- entropy boundary values are assigned in EntropySwitch -- */
-
-  #if ENTROPY_SWITCH == YES
-   EntropySwitch (d, grid); 
-  #endif
 }
 
 /* ********************************************************************* */
@@ -54,6 +54,15 @@ void CoolingSource (const Data *d, double dt, Time_Step *Dts, Grid *GXYZ)
   double mu0, T0, T1, mu1;
   double v0[NVAR], v1[NVAR], k1[NVAR];
   double maxrate;
+  #if COOLING == TAB_GRID
+   static double *rate_row, *mu_row;
+   double *vrow[NVAR];
+
+   if (rate_row == NULL){
+     rate_row = ARRAY_1D(NMAX_POINT, double);
+     mu_row   = ARRAY_1D(NMAX_POINT, double);
+   }
+  #endif
 
   for (nv = 0; nv < NVAR; nv++) k1[nv] = 0.0;  
 
@@ -63,6 +72,17 @@ void CoolingSource (const Data *d, double dt, Time_Step *Dts, Grid *GXYZ)
 
   DOM_LOOP(k,j,i){  /* -- span the computational domain -- */
 
+  /* --------------------------------------------------
+      Tabulated grid: rates of the whole row at once
+     -------------------------------------------------- */
+
+    #if COOLING == TAB_GRID
+     if (i == IBEG){
+       for (nv = 0; nv < NVAR; nv++) vrow[nv] = d->Vc[nv][k][j];
+       RadiatPencil (vrow, rate_row, mu_row, IBEG, IEND);
+     }
+    #endif
+
   /* --------------------------------------------------
       Skip integration if cell has been tagged with 
       FLAG_INTERNAL_BOUNDARY or FLAG_SPLIT_CELL 
@@ -79,7 +99,11 @@ void CoolingSource (const Data *d, double dt, Time_Step *Dts, Grid *GXYZ)
       v0[nv] = v1[nv] = d->Vc[nv][k][j][i];
     }
     
-    mu0 = MeanMolecularWeight(v0);
+    #if COOLING == TAB_GRID
+     mu0 = mu_row[i];
+    #else
+     mu0 = MeanMolecularWeight(v0);
+    #endif
     T0  = v0[PRS]/v0[RHO]*KELVIN*mu0;
 
     if (T0 <= 0.0){
@@ -94,7 +118,11 @@ void CoolingSource (const Data *d, double dt, Time_Step *Dts, Grid *GXYZ)
     the max rate of the reaction network.
    ------------------------------------------- */
 
-    Radiat(v0, k1);
+    #if COOLING == TAB_GRID
+     k1[PRS] = rate_row[i];
+    #else
+     Radiat(v0, k1);
+    #endif
 
     maxrate = GetMaxRate (v0, k1, T0);
     stiff = (dt*maxrate > 1.0 ? 1:0);
@@ -8,9 +8,30 @@
 
   The WriteHDF5() function allows to write data in serial or parallel
   mode in either single or double precision.
+  All cell-centered variables are written, i.e. the primitive
+  variables and the user-defined variables (uservar in pluto.ini).
+  The datasets are chunked (one chunk per processor) and compressed
+  with gzip if HDF5_DEFLATE (1-9) is set in definitions.h.
+  The file carries the attributes "time", "dt", "step" and
+  "cloudy_call" (see SetHDF5CloudyCall()).
+
+  With the mode "single_file_async" in pluto.ini, e.g.
+
+      dbl.h5   -1.0   100   single_file_async
+
+  the data is copied to a buffer and written to disk by a background
+  thread while the integration goes on. WaitHDF5() waits for this
+  write to finish; it is called before the next file is written and
+  must be called before the code exits.
+  In parallel, the background thread needs an MPI library with
+  MPI_THREAD_MULTIPLE support (requested by AL_Init()), otherwise the
+  file is written at once.
 
   The ReadHDF5() function allows to read double precision data 
-  in serial or parrallel mode.
+  in serial or parrallel mode. All cell-centered variables of the
+  writer are read, including the user defined ones; a user defined
+  variable which is not found in the file is left unchanged and
+  QueryHDF5Var() tells which variables have been read.
   
   \note 
   By turning "MPI_POSIX" to "YES", HDF5 uses another parallel IO driver
@@ -25,7 +46,8 @@
   For more info take a look at
   http://www.hdfgroup.org/HDF5/PHDF5/parallelhdf5hints.pdf
 
-  \todo This format does not yet support writing of supplementary variables.
+  \note Compressed datasets can be written in parallel only by
+  HDF5 1.10.2 or later, HDF5_DEFLATE is ignored for older versions.
 
   \authors C. Zanni (zanni@oato.inaf.it)\n
            G. Musicanisi (g.muscianisi@cineca.it)\n
@@ -36,6 +58,7 @@
 #include "pluto.h"
 #define H5_USE_16_API
 #include "hdf5.h"
+#include <pthread.h>
 
 #ifndef PARALLEL
  #define MPI_POSIX YES
@@ -43,6 +66,54 @@
  #define MPI_POSIX NO
 #endif
 
+#ifndef HDF5_DEFLATE
+ #define HDF5_DEFLATE  0   /* -- gzip level of the datasets (0 = none) -- */
+#endif
+
+/* -- parallel compression needs HDF5 1.10.2 -- */
+
+#ifdef PARALLEL
+ #if !defined(H5_VERSION_GE)
+  #define HDF5_DEFLATE_OK  NO
+ #elif H5_VERSION_GE(1,10,2)
+  #define HDF5_DEFLATE_OK  YES
+ #else
+  #define HDF5_DEFLATE_OK  NO
+ #endif
+#else
+ #define HDF5_DEFLATE_OK  YES
+#endif
+
+#define H5_MAX_VARS  64   /* -- max. number of output variables -- */
+
+/* -- a file to be written: the data is copied to buf -- */
+
+typedef struct H5_JOB{
+  Output *output;
+  Grid   *grid;
+  int    nfile;
+  int    nvar;             /* number of variables in buf */
+  int    var[H5_MAX_VARS]; /* their index in output->V   */
+  void   *buf;             /* interior values, buf[n][k][j][i] */
+  double time, dt;
+  long   step;
+  int    cloudy_call;
+} H5_Job;
+
+static H5_Job    h5_job;
+static pthread_t h5_thread;
+static int       h5_busy = 0;         /* background write in progress */
+static int       h5_cloudy_call = 0;
+static int       h5_var_read[H5_MAX_VARS]; /* read by the last ReadHDF5 */
+static float     ****node_coords, ****cell_coords;
+static hsize_t   h5_chunk[DIMENSIONS];
+#ifdef PARALLEL
+ static MPI_Comm h5_comm = MPI_COMM_NULL;
+#endif
+
+static void  H5WriteFile (H5_Job *);
+static void *H5WriteThread (void *);
+
 /* ********************************************************************* */
 void WriteHDF5 (Output *output, Grid *grid)
 /*!
@@ -55,31 +126,17 @@ void WriteHDF5 (Output *output, Grid *grid)
  * \return This function has no return value.
  *********************************************************************** */
 {
-  hid_t dataspace, memspace, dataset;
-  hid_t strspace, stratt, string_type;
-  hid_t file_identifier, group;
-  hid_t file_access = 0;
-#if MPI_POSIX == NO
-  hid_t plist_id_mpiio = 0; /* for collective MPI I/O */
-#endif
-  hid_t err;
-
-  hsize_t dimstr;
-  hsize_t dimens[DIMENSIONS];
-  hsize_t start[DIMENSIONS];
-  hsize_t stride[DIMENSIONS];
-  hsize_t count[DIMENSIONS];
-
   time_t tbeg, tend;
-  static float ****node_coords, ****cell_coords;
-  char filename[128], filenamexmf[128];
-  char *coords = "/cell_coords/X /cell_coords/Y /cell_coords/Z ";
-  char *cname[] = {"X", "Y", "Z"};
-  char xmfext[8];
-  int ierr, rank, nd, nv, ns, nc, ngh, ii, jj, kk;
-  int n1p, n2p, n3p, nprec;
+  static double *buf;
+  double *dbuf;
+  float  *fbuf;
+  int nd, nv, n, ii, jj, kk, i, j, k;
+  int n1p, n2p, n3p, async;
   Grid *wgrid[3];
-  FILE *fxmf;
+
+/* -- the previous file must be complete -- */
+
+  WaitHDF5();
  
 /* ----------------------------------------------------------------
                  compute coordinates just once
@@ -157,6 +214,28 @@ void WriteHDF5 (Output *output, Grid *grid)
       #endif
     }}}
 
+  /* -- one chunk per processor (the largest local domain) -- */
+
+    for (nd = 0; nd < DIMENSIONS; nd++){
+      n = grid[DIMENSIONS - nd - 1].np_int;
+      #ifdef PARALLEL
+       MPI_Allreduce (MPI_IN_PLACE, &n, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+      #endif
+      h5_chunk[nd] = n;
+    }
+
+  /* -- the background thread uses its own communicator -- */
+
+    #ifdef PARALLEL
+     MPI_Comm_dup (MPI_COMM_WORLD, &h5_comm);
+    #endif
+
+    #if HDF5_DEFLATE > 0 && HDF5_DEFLATE_OK == NO
+     print1 ("! WriteHDF5: parallel compression needs HDF5 >= 1.10.2, ");
+     print1 ("HDF5_DEFLATE ignored\n");
+    #endif
+
+    buf = ARRAY_1D(output->nvar*NX3*NX2*NX1, double);
   } 
 
 /* --------------------------------------------------------------
@@ -171,7 +250,154 @@ void WriteHDF5 (Output *output, Grid *grid)
    if (prank == 0)time(&tbeg);
   #endif
 
-  sprintf (filename, "data.%04d.%s", output->nfile, output->ext);
+/* ----------------------------------------------------------------
+    Copy the interior values of the cell-centered variables to the
+    buffer, in double or single precision. Staggered fields are
+    written from output->V directly (H5WriteFile).
+   ---------------------------------------------------------------- */
+
+  h5_job.output      = output;
+  h5_job.grid        = grid;
+  h5_job.nfile       = output->nfile;
+  h5_job.buf         = (void *)buf;
+  h5_job.time        = g_time;
+  h5_job.dt          = g_dt;
+  h5_job.step        = g_stepNumber;
+  h5_job.cloudy_call = h5_cloudy_call;
+  h5_job.nvar        = 0;
+
+  if (output->nvar > H5_MAX_VARS){
+    print1 ("! WriteHDF5: too many output variables (%d > %d)\n",
+            output->nvar, H5_MAX_VARS);
+    QUIT_PLUTO(1);
+  }
+
+  dbuf = buf;
+  fbuf = (float *)buf;
+  for (nv = 0; nv < output->nvar; nv++) {
+    if (!output->dump_var[nv] || output->stag_var[nv] != -1) continue;
+    h5_job.var[h5_job.nvar++] = nv;
+    if (output->type == DBL_H5_OUTPUT){
+      DOM_LOOP(k,j,i) *(dbuf++) = output->V[nv][k][j][i];
+    }else{
+      DOM_LOOP(k,j,i) *(fbuf++) = (float)output->V[nv][k][j][i];
+    }
+  }
+
+/* ----------------------------------------------------------------
+    Write now or hand the file to the background thread
+   ---------------------------------------------------------------- */
+
+  async = strcmp(output->mode, "single_file_async") == 0;
+  #ifdef STAGGERED_MHD
+   async = NO;   /* -- staggered fields are not copied -- */
+  #endif
+  #ifdef PARALLEL
+   if (async){
+     int provided;
+     MPI_Query_thread (&provided);
+     if (provided < MPI_THREAD_MULTIPLE){
+       static int warned = 0;
+       if (!warned) print1 ("! WriteHDF5: MPI_THREAD_MULTIPLE not available, writing at once\n");
+       warned = 1;
+       async  = NO;
+     }
+   }
+  #endif
+
+  if (async){
+    if (pthread_create (&h5_thread, NULL, H5WriteThread, &h5_job) == 0){
+      h5_busy = 1;
+    }else{
+      print1 ("! WriteHDF5: cannot start the thread, writing at once\n");
+      H5WriteFile (&h5_job);
+    }
+  }else{
+    H5WriteFile (&h5_job);
+  }
+
+  #ifdef PARALLEL
+   MPI_Barrier (MPI_COMM_WORLD);
+   if (prank == 0){
+     time(&tend);
+     print1 (" [%5.2f sec%s]",difftime(tend,tbeg), h5_busy ? ", async":"");
+   }
+  #endif
+}
+
+/* ********************************************************************* */
+void WaitHDF5 (void)
+/*!
+ * Wait until the background thread has written the last file.
+ * Nothing is done if no file is being written.
+ *
+ *********************************************************************** */
+{
+  if (!h5_busy) return;
+  pthread_join (h5_thread, NULL);
+  h5_busy = 0;
+}
+
+/* ********************************************************************* */
+void SetHDF5CloudyCall (int n)
+/*!
+ * Set the number of the last Cloudy solution, written as the
+ * attribute "cloudy_call" of the following HDF5 files.
+ *
+ *********************************************************************** */
+{
+  h5_cloudy_call = n;
+}
+
+/* ********************************************************************* */
+static void *H5WriteThread (void *job)
+/*
+ * Start routine of the background thread.
+ *********************************************************************** */
+{
+  H5WriteFile ((H5_Job *)job);
+  return NULL;
+}
+
+/* ********************************************************************* */
+static void H5WriteFile (H5_Job *job)
+/*
+ * Write the file of job: the attributes, the buffered variables,
+ * the coordinates and the XDMF file (processor 0).
+ * In parallel all processors have to call this function.
+ *********************************************************************** */
+{
+  hid_t dataspace, memspace, dataset;
+  hid_t strspace, stratt, string_type;
+  hid_t attspace, att;
+  hid_t file_identifier, group;
+  hid_t file_access = 0, dset_create;
+#if MPI_POSIX == NO
+  hid_t plist_id_mpiio = 0; /* for collective MPI I/O */
+#endif
+  hid_t err, h5type;
+
+  hsize_t dimstr;
+  hsize_t dimens[DIMENSIONS];
+  hsize_t start[DIMENSIONS];
+  hsize_t stride[DIMENSIONS];
+  hsize_t count[DIMENSIONS];
+
+  char filename[128], filenamexmf[128];
+  char *coords = "/cell_coords/X /cell_coords/Y /cell_coords/Z ";
+  char *cname[] = {"X", "Y", "Z"};
+  char xmfext[8];
+  int ierr, rank, nd, nv, n, ns, nc;
+  int nprec;
+  size_t dsize, ncell;
+  Output *output = job->output;
+  Grid   *grid   = job->grid;
+  Grid *wgrid[3];
+  FILE *fxmf;
+
+  for (nd = 0; nd < DIMENSIONS; nd++) wgrid[nd] = grid + DIMENSIONS - nd - 1;
+
+  sprintf (filename, "data.%04d.%s", job->nfile, output->ext);
 
   rank   = DIMENSIONS;
   dimstr = 3;
@@ -179,9 +405,9 @@ void WriteHDF5 (Output *output, Grid *grid)
   #ifdef PARALLEL
    file_access = H5Pcreate(H5P_FILE_ACCESS);
    #if MPI_POSIX == YES
-    H5Pset_fapl_mpiposix(file_access, MPI_COMM_WORLD, 1); 
+    H5Pset_fapl_mpiposix(file_access, h5_comm, 1);
    #else
-    H5Pset_fapl_mpio(file_access,  MPI_COMM_WORLD, MPI_INFO_NULL);
+    H5Pset_fapl_mpio(file_access,  h5_comm, MPI_INFO_NULL);
    #endif
   #else
    file_access = H5P_DEFAULT;
@@ -191,6 +417,28 @@ void WriteHDF5 (Output *output, Grid *grid)
 
   ierr = H5Pclose(file_access); 
 
+  if (file_identifier < 0){
+    print1 ("! WriteHDF5: cannot create %s\n", filename);
+    return;
+  }
+
+/* -- time, time step, step and Cloudy call as file attributes -- */
+
+  attspace = H5Screate(H5S_SCALAR);
+  att = H5Acreate(file_identifier, "time", H5T_NATIVE_DOUBLE, attspace, H5P_DEFAULT);
+  err = H5Awrite(att, H5T_NATIVE_DOUBLE, &job->time);
+  H5Aclose(att);
+  att = H5Acreate(file_identifier, "dt", H5T_NATIVE_DOUBLE, attspace, H5P_DEFAULT);
+  err = H5Awrite(att, H5T_NATIVE_DOUBLE, &job->dt);
+  H5Aclose(att);
+  att = H5Acreate(file_identifier, "step", H5T_NATIVE_LONG, attspace, H5P_DEFAULT);
+  err = H5Awrite(att, H5T_NATIVE_LONG, &job->step);
+  H5Aclose(att);
+  att = H5Acreate(file_identifier, "cloudy_call", H5T_NATIVE_INT, attspace, H5P_DEFAULT);
+  err = H5Awrite(att, H5T_NATIVE_INT, &job->cloudy_call);
+  H5Aclose(att);
+  H5Sclose(attspace);
+
   group = H5Gcreate(file_identifier, "vars", 0); /* Create group "vars" (cell-centered vars) */
 
 /* Define "coords" attribute of group "vars" */
@@ -218,57 +466,52 @@ void WriteHDF5 (Output *output, Grid *grid)
    err = H5Sselect_hyperslab(dataspace, H5S_SELECT_SET, start, stride, count, NULL);
   #endif
 
-  for (nd = 0; nd < DIMENSIONS; nd++) dimens[nd] = wgrid[nd]->np_tot;
+/* -- the buffer holds the interior values only -- */
+
+  for (nd = 0; nd < DIMENSIONS; nd++) dimens[nd] = wgrid[nd]->np_int;
 
   memspace = H5Screate_simple(rank,dimens,NULL);
 
-  for (nd = 0; nd < DIMENSIONS; nd++){
-    start[nd]  = wgrid[nd]->nghost;
-    stride[nd] = 1;
-    count[nd]  = wgrid[nd]->np_int;
-  }
-  err = H5Sselect_hyperslab(memspace,H5S_SELECT_SET, start, stride, count, NULL);
+/* -- chunked (and compressed) datasets -- */
+
+  dset_create = H5Pcreate(H5P_DATASET_CREATE);
+  H5Pset_chunk(dset_create, rank, h5_chunk);
+  #if HDF5_DEFLATE > 0 && HDF5_DEFLATE_OK == YES
+   H5Pset_deflate(dset_create, HDF5_DEFLATE);
+  #endif
 
 /* ------------------------------------
       write cell-centered data
    ------------------------------------ */
 
-  for (nv = 0; nv < NVAR; nv++) {
-    if (!output->dump_var[nv]) continue;
-    if (output->type == DBL_H5_OUTPUT){
-      dataset = H5Dcreate(group, output->var_name[nv], H5T_NATIVE_DOUBLE,
-                          dataspace, H5P_DEFAULT);
-#if MPI_POSIX == NO
-      plist_id_mpiio = H5Pcreate(H5P_DATASET_XFER);
-      H5Pset_dxpl_mpio(plist_id_mpiio,H5FD_MPIO_COLLECTIVE);
-      err = H5Dwrite(dataset, H5T_NATIVE_DOUBLE, memspace, dataspace,
-                     plist_id_mpiio, output->V[nv][0][0]);
-#else
-      err = H5Dwrite(dataset, H5T_NATIVE_DOUBLE, memspace, dataspace,
-                    H5P_DEFAULT, output->V[nv][0][0]);
-#endif
-    }else if (output->type == FLT_H5_OUTPUT){
-      void *Vpt;
-      Vpt = (void *)(Convert_dbl2flt(output->V[nv],0))[0][0];
-
-      dataset = H5Dcreate(group, output->var_name[nv], H5T_NATIVE_FLOAT,
-                          dataspace, H5P_DEFAULT);
+  if (output->type == DBL_H5_OUTPUT){
+    h5type = H5T_NATIVE_DOUBLE;
+    dsize  = sizeof(double);
+  }else{
+    h5type = H5T_NATIVE_FLOAT;
+    dsize  = sizeof(float);
+  }
+  ncell = NX1*NX2*NX3;
 
+  for (n = 0; n < job->nvar; n++) {
+    nv = job->var[n];
+    dataset = H5Dcreate(group, output->var_name[nv], h5type,
+                        dataspace, dset_create);
 #if MPI_POSIX == NO
-      plist_id_mpiio = H5Pcreate(H5P_DATASET_XFER);
-      H5Pset_dxpl_mpio(plist_id_mpiio,H5FD_MPIO_COLLECTIVE);
-      err = H5Dwrite(dataset, H5T_NATIVE_FLOAT, memspace,
-                     dataspace, plist_id_mpiio, Vpt);
+    plist_id_mpiio = H5Pcreate(H5P_DATASET_XFER);
+    H5Pset_dxpl_mpio(plist_id_mpiio,H5FD_MPIO_COLLECTIVE);
+    err = H5Dwrite(dataset, h5type, memspace, dataspace,
+                   plist_id_mpiio, (char *)job->buf + n*ncell*dsize);
 #else
-      err = H5Dwrite(dataset, H5T_NATIVE_FLOAT, memspace,
-                     dataspace, H5P_DEFAULT, Vpt);
+    err = H5Dwrite(dataset, h5type, memspace, dataspace,
+                   H5P_DEFAULT, (char *)job->buf + n*ncell*dsize);
 #endif
-    }
     H5Dclose(dataset);
 #if MPI_POSIX == NO
     H5Pclose(plist_id_mpiio);
 #endif
   }
+  H5Pclose(dset_create);
   H5Sclose(memspace);
   H5Sclose(dataspace);
   H5Gclose(group); /* Close group "vars" */
@@ -472,7 +715,7 @@ void WriteHDF5 (Output *output, Grid *grid)
       nprec = 4;
     }
  
-    sprintf (filenamexmf, "data.%04d.%s", output->nfile, xmfext);
+    sprintf (filenamexmf, "data.%04d.%s", job->nfile, xmfext);
    
     fxmf = fopen(filenamexmf, "w");
     fprintf(fxmf, "<?xml version=\"1.0\" ?>\n");
@@ -480,7 +723,7 @@ void WriteHDF5 (Output *output, Grid *grid)
     fprintf(fxmf, "<Xdmf Version=\"2.0\">\n");
     fprintf(fxmf, " <Domain>\n");
     fprintf(fxmf, "   <Grid Name=\"node_mesh\" GridType=\"Uniform\">\n");
-    fprintf(fxmf, "    <Time Value=\"%12.6e\"/>\n",g_time);
+    fprintf(fxmf, "    <Time Value=\"%12.6e\"/>\n",job->time);
    #if DIMENSIONS == 2
     fprintf(fxmf, "     <Topology TopologyType=\"2DSMesh\" NumberOfElements=\"%d %d\"/>\n", wgrid[0]->np_int_glob+1, wgrid[1]->np_int_glob+1);
     fprintf(fxmf, "     <Geometry GeometryType=\"X_Y\">\n");
@@ -499,8 +742,8 @@ void WriteHDF5 (Output *output, Grid *grid)
     }
    #endif
     fprintf(fxmf, "     </Geometry>\n");
-    for (nv = 0; nv < NVAR; nv++) { /* Write cell-centered variables */
-     if (!output->dump_var[nv]) continue;
+    for (n = 0; n < job->nvar; n++) { /* Write cell-centered variables */
+     nv = job->var[n];
      fprintf(fxmf, "     <Attribute Name=\"%s\" AttributeType=\"Scalar\" Center=\"Cell\">\n",output->var_name[nv]);
     #if DIMENSIONS == 2
      fprintf(fxmf, "       <DataItem Dimensions=\"%d %d\" NumberType=\"Float\" Precision=\"%d\" Format=\"HDF\">\n", wgrid[0]->np_int_glob, wgrid[1]->np_int_glob, nprec);
@@ -528,16 +771,6 @@ void WriteHDF5 (Output *output, Grid *grid)
     fclose(fxmf);
 
    }
-
-/* XDMF file */
-
-  #ifdef PARALLEL
-   MPI_Barrier (MPI_COMM_WORLD);
-   if (prank == 0){
-     time(&tend);
-     print1 (" [%5.2f sec]",difftime(tend,tbeg));
-   }
-  #endif
 }
 
 /* ********************************************************************* */
@@ -575,6 +808,12 @@ void ReadHDF5 (Output *output, Grid *grid)
 
   for (nd = 0; nd < DIMENSIONS; nd++) wgrid[nd] = grid + DIMENSIONS - nd - 1;
 
+  if (output->nvar > H5_MAX_VARS){
+    print1 ("! ReadHDF5: too many output variables (%d > %d)\n",
+            output->nvar, H5_MAX_VARS);
+    QUIT_PLUTO(1);
+  }
+
   print1 ("> restarting from file #%d (dbl.h5)\n",output->nfile);
   sprintf (filename, "data.%04d.dbl.h5", output->nfile);
 
@@ -601,8 +840,20 @@ void ReadHDF5 (Output *output, Grid *grid)
 
   group = H5Gopen(file_identifier, "vars");
 
-  for (nv = 0; nv < NVAR; nv++) {
-    if (!output->dump_var[nv]) continue; 
+  for (nv = 0; nv < output->nvar; nv++) {
+    h5_var_read[nv] = NO;
+    if (!output->dump_var[nv] || output->stag_var[nv] != -1) continue; 
+
+  /* -- user defined variables may be missing in older files -- */
+
+    if (H5Lexists(group, output->var_name[nv], H5P_DEFAULT) <= 0){
+      if (nv < NVAR){
+        print1 ("! ReadHDF5: variable %s not found in %s\n", output->var_name[nv], filename);
+        QUIT_PLUTO(1);
+      }
+      print1 ("! ReadHDF5: variable %s not found, not restarted\n", output->var_name[nv]);
+      continue;
+    }
 
     dataset   = H5Dopen(group, output->var_name[nv]);
     dataspace = H5Dget_space(dataset);
@@ -644,6 +895,7 @@ void ReadHDF5 (Output *output, Grid *grid)
 #endif
     H5Sclose(memspace);
     H5Sclose(dataspace);
+    h5_var_read[nv] = YES;
   }
 
   H5Gclose(group);
@@ -707,3 +959,25 @@ void ReadHDF5 (Output *output, Grid *grid)
 
   H5Fclose(file_identifier);
 }
+
+/* ********************************************************************* */
+int QueryHDF5Var (Output *output, char *var_name)
+/*!
+ * Check whether a cell-centered variable has been read by the
+ * last call to ReadHDF5().
+ *
+ * \param [in] output    the output structure passed to ReadHDF5()
+ * \param [in] var_name  the name of the variable
+ *
+ * 
+eturn YES if the variable was found in the restart file,
+ *         NO otherwise.
+ *********************************************************************** */
+{
+  int nv;
+
+  for (nv = 0; nv < output->nvar; nv++){
+    if (strcmp(output->var_name[nv], var_name) == 0) return h5_var_read[nv];
+  }
+  return NO;
+}
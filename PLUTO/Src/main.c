@@ -408,6 +408,10 @@ int main (int argc, char *argv[])
     #endif
   }
 
+  #ifdef USE_HDF5
+   WaitHDF5 ();   /* -- last file of a background hdf5 write -- */
+  #endif
+
   #ifdef PARALLEL
    MPI_Barrier (MPI_COMM_WORLD);
    print1  ("\n> Total allocated memory  %6.2f Mb (proc #%d)\n",
@@ -763,7 +767,8 @@ void CheckForOutput (Data *d, Input *ini, Grid *grid)
     if (check_dt || check_dn || check_dclock) { 
 
       #ifdef USE_ASYNC_IO
-       if (!strcmp(output->mode,"single_file_async")){
+       if (!strcmp(output->mode,"single_file_async") &&
+           (output->type == DBL_OUTPUT || output->type == FLT_OUTPUT)){
          Async_BegWriteData (d, output, grid);
        }else{
          WriteData(d, output, grid);
@@ -21,6 +21,9 @@
 #include <math.h>
 #include <stdlib.h>
 #include <time.h>
+#ifdef _OPENMP
+ #include <omp.h>
+#endif
 
 /*! Return the maximum between two numbers. */
 #define MAX(a,b)  ( (a) >= (b) ? (a) : (b) ) 
@@ -110,6 +113,7 @@
 #define SNEq         5
 #define TABULATED    6
 #define H2_COOL      7
+#define TAB_GRID     8
 
   /*  ----  SET LABELS FOR PHYSICS MODULE  ----  */
 
@@ -456,12 +460,30 @@ typedef double real;
 #define X3_END_LOOP(k,j,i) KEND_LOOP(k) JTOT_LOOP(j) ITOT_LOOP(i)
 
 #define TRANSVERSE_LOOP(indx, in, i,j,k) \
- if (g_dir == IDIR) {i = &in; j = &indx.t1; k = &indx.t2;} \
- if (g_dir == JDIR) {j = &in; i = &indx.t1; k = &indx.t2;} \
- if (g_dir == KDIR) {k = &in; i = &indx.t1; j = &indx.t2;} \
- g_i = i; g_j = j; g_k = k;\
+ TRANSVERSE_POINTERS(indx, in, i,j,k) \
  for (indx.t2 = indx.t2_beg; indx.t2 <= indx.t2_end; indx.t2++) \
  for (indx.t1 = indx.t1_beg; indx.t1 <= indx.t1_end; indx.t1++)
+
+#define TRANSVERSE_POINTERS(indx, in, i,j,k) \
+ if (g_dir == IDIR)      {i = &in; j = &indx.t1; k = &indx.t2;} \
+ else if (g_dir == JDIR) {j = &in; i = &indx.t1; k = &indx.t2;} \
+ else                    {k = &in; i = &indx.t1; j = &indx.t2;} \
+ g_i = i; g_j = j; g_k = k;
+
+/* ********************************************************************* */
+/*! The THREAD_TRANSVERSE_LOOP() macro is the same as TRANSVERSE_LOOP(),
+    but the pencils are shared among the threads of an enclosing 
+    OpenMP parallel region (see Sweep()). The pencils are counted by
+    \c it, which must be private to the thread like \c indx, \c in and
+    the pointers \c i, \c j, \c k. Without OpenMP all pencils are
+    visited in the order of TRANSVERSE_LOOP().
+   ********************************************************************* */
+#define THREAD_TRANSVERSE_LOOP(indx, in, i,j,k, it) \
+ TRANSVERSE_POINTERS(indx, in, i,j,k) \
+ OMP_PRAGMA(omp for schedule(static)) \
+ for (it = 0; it < (indx.t1_end - indx.t1_beg + 1)*(indx.t2_end - indx.t2_beg + 1); it++) \
+ if (indx.t1 = indx.t1_beg + it%(indx.t1_end - indx.t1_beg + 1), \
+     indx.t2 = indx.t2_beg + it/(indx.t1_end - indx.t1_beg + 1), 1)
 /**@} */
 
 /* ********************************************************************* */
@@ -1018,6 +1040,8 @@ typedef double ****Data_Arr;
  #include "Cooling/Tab/cooling.h"
 #elif COOLING == H2_COOL
  #include "Cooling/H2_COOL/cooling.h"
+#elif COOLING == TAB_GRID
+ #include "Cooling/Tab_Grid/cooling.h"
 #endif
 
 #if THERMAL_CONDUCTION != NO
@@ -1036,6 +1060,69 @@ typedef double ****Data_Arr;
  #include "Fargo/fargo.h"
 #endif
 
+/* ################################################################# 
+
+       Threads: with OpenMP (-fopenmp) the 1D pencils of Sweep()
+       and Unsplit() are shared among the threads of a processor.
+       Every thread has its own State_1D and the routines called
+       for a pencil keep their scratch arrays per thread
+       ("omp threadprivate"). This is done for the HD module and 
+       the reconstruction routines only, other modules and the
+       diffusion, CT, FARGO and shearing-box parts run in one 
+       thread. The number of threads is set with OMP_NUM_THREADS.
+
+   ################################################################# */
+
+#if defined(_OPENMP) && PHYSICS == HD && !(PARABOLIC_FLUX & EXPLICIT) \
+    && UPDATE_VECTOR_POTENTIAL == NO && !defined(FARGO) \
+    && !defined(FINITE_DIFFERENCE) && !defined(SHEARINGBOX)
+ #define THREADED_SWEEPS  YES
+#else
+ #define THREADED_SWEEPS  NO
+#endif
+
+#ifdef _OPENMP
+ #define OMP_PRAGMA(x)  _Pragma(#x)
+#else
+ #define OMP_PRAGMA(x)
+#endif
+
+/* ################################################################# 
+
+       SIMD kernels: with SOA_KERNELS set to YES in definitions.h
+       the HD HLL and HLLC solvers and the WENO3 reconstruction
+       copy the pencil into aligned arrays indexed [nv][i] and
+       run the inner loops over the interfaces, so that several
+       interfaces are done by one vector instruction.
+       The State_1D arrays keep the [i][nv] order used everywhere
+       else. Only the ideal EoS without MULTID shock flattening 
+       has these kernels, otherwise the switch is ignored.
+       The loops are vectorized only with vector instructions 
+       and sqrt without errno, e.g. -O3 -march=native 
+       -fno-math-errno; otherwise the copies make it slower.
+
+   ################################################################# */
+
+#ifndef SOA_KERNELS
+ #define SOA_KERNELS  NO
+#endif
+
+#if SOA_KERNELS == YES && (PHYSICS != HD || EOS != IDEAL \
+                           || SHOCK_FLATTENING == MULTID)
+ #undef  SOA_KERNELS
+ #define SOA_KERNELS  NO
+#endif
+
+#define SIMD_ALIGN  64   /* -- alignment (bytes) of the SoA rows -- */
+
+#ifdef _OPENMP
+ #define SIMD_LOOP  _Pragma("omp simd")
+#elif defined(__GNUC__)
+ #define SIMD_LOOP  _Pragma("GCC ivdep")
+#else
+ #define SIMD_LOOP
+#endif
+
 /* *****************************************************
    *****************************************************
 
@@ -1081,6 +1168,11 @@ extern double g_smallDensity, g_smallPressure;
 
 extern double g_time, g_dt;
 extern double g_maxMach;
+
+/* -- the pencil sweeps may run in threads, see THREADED_SWEEPS -- */
+#ifdef _OPENMP
+ #pragma omp threadprivate(g_i, g_j, g_k, g_maxMach, g_maxRiemannIter)
+#endif
 #if ROTATING_FRAME
  extern double g_OmegaZ;
 #endif
@@ -68,6 +68,7 @@ char *ParGet  (const char *, int );
 int  ParQuery (const char *);
 void PrimToChar (double **, double *, double *); 
 
+void ReduceThreadTimeStep (Time_Step *, Time_Step *);
 void ResetState (const Data *, State_1D *, Grid *);
 void RightHandSide (const State_1D *, Time_Step *, int, int, double, Grid *);
 void RKC (const Data *d, Time_Step *, Grid *);
@@ -77,14 +78,17 @@ void SetDefaultVarNames(Output *);
 int  SetDumpVar (char *, int, int);
 Riemann_Solver *SetSolver (const char *);
 void SetIndexes (Index *indx, Grid *grid);
+void SetThreadTimeStep (Time_Step *, Time_Step *);
 void SetOutput (Data *d, Input *input);
 void SetRBox(RBox *, RBox *, RBox *, RBox *);
 int  Setup (Input *, Cmd_Line *, char *);
 void SetGrid (struct INPUT *INI, Grid *);
 void SetJetDomain   (const Data *, int, int, Grid *);
+void SoAToState (double **, double **, int, int, int);
 void SoundSpeed2 (double **, double *, double *, int, int,  int, Grid *);
 void SplitSource (const Data *, double, Time_Step *, Grid *);
 void Startup (Data *, Grid *);
+void StateToSoA (double **, double **, int, int, int);
 void States (const State_1D *, int, int, Grid *);
 
 void UnsetJetDomain (const Data *, int, Grid *);
@@ -98,6 +102,7 @@ void VISC_FLUX (const State_1D *, int beg, int end, Grid *);
 
 char    *Array1D (int, size_t);
 char   **Array2D (int, int, size_t);
+char   **AlignedArray2D (int, int, size_t);
 char  ***Array3D (int, int, int, size_t);
 char ****Array4D (int, int, int, int, size_t);
 
@@ -122,6 +127,7 @@ void FreeArrayCharMap(unsigned char ***);
 
 #define ARRAY_1D(nx,type)          (type    *)Array1D(nx,sizeof(type))
 #define ARRAY_2D(nx,ny,type)       (type   **)Array2D(nx,ny,sizeof(type))
+#define ALIGNED_ARRAY_2D(nx,ny,type) (type **)AlignedArray2D(nx,ny,sizeof(type))
 #define ARRAY_3D(nx,ny,nz,type)    (type  ***)Array3D(nx,ny,nz,sizeof(type))
 #define ARRAY_4D(nx,ny,nz,nv,type) (type ****)Array4D(nx,ny,nz,nv,sizeof(type))
 
@@ -154,6 +160,8 @@ void Where (int, Grid *);
    --------------------------------------------------------------------- */
 
 void Boundary    (const Data *, int, Grid *);
+int  BoundaryBegin (const Data *, int, int, Grid *);
+void BoundaryEnd   (const Data *, Grid *);
 void FlipSign       (int, int, int *);
 void OutflowBound   (double ***, RBox *, int, Grid *);
 void PeriodicBound  (double ***, RBox *, int);
@@ -172,6 +180,8 @@ int   CloseBinaryFile (FILE *, int);
 FILE *OpenBinaryFile  (char *, int, char *);
 void ReadBinaryArray (void *, size_t, int, FILE *, int, int);
 void ReadHDF5 (Output *output, Grid *grid);
+int  QueryHDF5Var (Output *, char *);
+void SetHDF5CloudyCall (int);
 
 void Restart (Input *, int, int, Grid *);
 void RestartDump (Input *);
@@ -182,6 +192,7 @@ void SwapEndian (void *, const int);
 void WriteData (const Data *, Output *, Grid *);
 void WriteBinaryArray (void *, size_t, int, FILE *, int);
 void WriteHDF5        (Output *output, Grid *grid);
+void WaitHDF5         (void);
 void WriteVTK_Header (FILE *, Grid *);
 void WriteVTK_Vector (FILE *, Data_Arr, char *, Grid *);
 void WriteVTK_Scalar (FILE *, double ***, char *, Grid *);
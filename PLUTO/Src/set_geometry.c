@@ -307,6 +307,7 @@ double *GetInverse_dl (const Grid *grid)
     int    j;
     double r_1;
     static double *inv_dl;
+    OMP_PRAGMA(omp threadprivate(inv_dl))
    
     if (inv_dl == NULL) inv_dl = ARRAY_1D(NX2_TOT, double);
     r_1 = grid[IDIR].r_1[*g_i];
@@ -319,6 +320,7 @@ double *GetInverse_dl (const Grid *grid)
   int    j, k;
   double r_1, s;
   static double *inv_dl2, *inv_dl3;
+  OMP_PRAGMA(omp threadprivate(inv_dl2, inv_dl3))
 
   if (inv_dl2 == NULL) {
     inv_dl2 = ARRAY_1D(NX2_TOT, double);
@@ -187,3 +187,65 @@ void ResetState (const Data *d, State_1D *state, Grid *grid)
 }
 
 
+
+/* ********************************************************************* */
+void SetThreadTimeStep (Time_Step *Dts, Time_Step *Dts_t)
+/*!
+ * Set the copy of the time step structure used by a thread which
+ * sweeps pencils (see THREAD_TRANSVERSE_LOOP()).
+ * Every thread other than the master writes the signal velocities
+ * into its own array. The inverse time steps and the maximum Mach
+ * number are combined by ReduceThreadTimeStep() at the end of the
+ * parallel region. Must be called by all threads of the region.
+ *
+ * \param [in]  Dts    pointer to the Time_Step structure
+ * \param [out] Dts_t  pointer to the copy of this thread
+ *
+ *********************************************************************** */
+{
+  #ifdef _OPENMP
+   static double *cmax;
+   #pragma omp threadprivate(cmax)
+  #endif
+
+  *Dts_t = *Dts;
+  #ifdef _OPENMP
+   if (omp_get_thread_num() != 0){
+     if (cmax == NULL) cmax = ARRAY_1D(NMAX_POINT, double);
+     Dts_t->cmax = cmax;
+   }
+  #endif
+}
+
+/* ********************************************************************* */
+void ReduceThreadTimeStep (Time_Step *Dts, Time_Step *Dts_t)
+/*!
+ * Combine the inverse time steps of all threads into Dts and
+ * the maximum Mach number and Riemann iterations into the
+ * copies of all threads (see SetThreadTimeStep()).
+ * Must be called by all threads of the region.
+ *
+ * \param [in,out] Dts    pointer to the Time_Step structure
+ * \param [in]     Dts_t  pointer to the copy of this thread
+ *
+ *********************************************************************** */
+{
+  static double max_mach;
+  static int    max_iter;
+
+  OMP_PRAGMA(omp single)
+  {
+    max_mach = 0.0;
+    max_iter = 0;
+  }
+  OMP_PRAGMA(omp critical)
+  {
+    Dts->inv_dta = MAX(Dts->inv_dta, Dts_t->inv_dta);
+    Dts->inv_dtp = MAX(Dts->inv_dtp, Dts_t->inv_dtp);
+    max_mach = MAX(max_mach, g_maxMach);
+    max_iter = MAX(max_iter, g_maxRiemannIter);
+  }
+  OMP_PRAGMA(omp barrier)
+  g_maxMach        = max_mach;
+  g_maxRiemannIter = max_iter;
+}
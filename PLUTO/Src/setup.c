@@ -250,17 +250,35 @@ printf ("%f  %d %s\n",input->patch_left_node[idim][ip],input->patch_npoint[idim]
    }  
   #endif
 
- /* -- hdf5 output -- */
+ /* -- hdf5 output, optional mode 'single_file_async' (hdf5_io.c) -- */
 
   if (ParQuery("dbl.h5")){
     output = input->output + (ipos++);
     output->type  = DBL_H5_OUTPUT;
     GetOutputFrequency(output, "dbl.h5");
+
+    sprintf (output->mode,"single_file");
+    if (ParGet("dbl.h5",3) != NULL) sprintf (output->mode,"%s",ParGet("dbl.h5",3));
+    if (   strcmp(output->mode,"single_file")
+        && strcmp(output->mode,"single_file_async")){
+       print1 (" ! Setup: expecting 'single_file' or 'single_file_async' in\n");
+       print1 ("          dbl.h5 output\n");
+       QUIT_PLUTO(1);
+    }
   }
   if (ParQuery("flt.h5")){
     output = input->output + (ipos++);
     output->type  = FLT_H5_OUTPUT;
     GetOutputFrequency(output, "flt.h5");
+
+    sprintf (output->mode,"single_file");
+    if (ParGet("flt.h5",3) != NULL) sprintf (output->mode,"%s",ParGet("flt.h5",3));
+    if (   strcmp(output->mode,"single_file")
+        && strcmp(output->mode,"single_file_async")){
+       print1 (" ! Setup: expecting 'single_file' or 'single_file_async' in\n");
+       print1 ("          flt.h5 output\n");
+       QUIT_PLUTO(1);
+    }
   }
 
  /* -- vtk output -- */
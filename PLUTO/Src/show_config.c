@@ -220,6 +220,7 @@ void ShowUnits ()
    if (COOLING == SNEq)  print1 (" SNEq\n");
    if (COOLING == MINEq) print1 (" MINEq\n");
    if (COOLING == TABULATED) print1 (" TABULATED\n");
+   if (COOLING == TAB_GRID)  print1 (" TAB_GRID\n");
   #endif
 
   print1 ("> Normalization Units:\n\n");
@@ -394,6 +394,42 @@ void MakeState (State_1D *state)
   state->vt      = ARRAY_2D(NMAX_POINT, NVAR, double);
 }
 
+/* ********************************************************************* */
+void StateToSoA (double **q, double **qs, int nvar, int beg, int end)
+/*!
+ * Copy the first nvar variables of a 1D array indexed [i][nv], as 
+ * those of the State_1D structure, into an array indexed [nv][i], 
+ * on which the vectorized kernels work.
+ *
+ * \param [in]  q     array indexed [i][nv]
+ * \param [out] qs    array indexed [nv][i]
+ * \param [in]  nvar  number of variables
+ * \param [in]  beg   starting index of computation
+ * \param [in]  end   final index of computation
+ *
+ *********************************************************************** */
+{
+  int i, nv;
+
+  for (i = beg; i <= end; i++){
+    for (nv = 0; nv < nvar; nv++) qs[nv][i] = q[i][nv];
+  }
+}
+
+/* ********************************************************************* */
+void SoAToState (double **qs, double **q, int nvar, int beg, int end)
+/*!
+ * The inverse of StateToSoA().
+ *
+ *********************************************************************** */
+{
+  int i, nv;
+
+  for (i = beg; i <= end; i++){
+    for (nv = 0; nv < nvar; nv++) q[i][nv] = qs[nv][i];
+  }
+}
+
 /* ********************************************************************* */
 int IsLittleEndian (void) 
 /*!
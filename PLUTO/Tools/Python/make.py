@@ -124,7 +124,7 @@ def problem(work_dir, pluto_path, pluto_dir, additional_files,
     default.append('NO')
 
   entries.append('COOLING')
-  options.append(['NO','POWER_LAW','TABULATED','SNEq','MINEq']) # ,'H2_COOL'])
+  options.append(['NO','POWER_LAW','TABULATED','TAB_GRID','SNEq','MINEq']) # ,'H2_COOL'])
   default.append('NO')
 
 #  entries.append('INCLUDE_PARTICLES')
@@ -800,6 +800,10 @@ def problem(work_dir, pluto_path, pluto_dir, additional_files,
     pluto_path.append('Cooling/Tab/')
     additional_files.append('cooling_source.o')
     additional_files.append('cooling_ode_solver.o')
+  elif (default[n] == 'TAB_GRID'):
+    pluto_path.append('Cooling/Tab_Grid/')
+    additional_files.append('cooling_source.o')
+    additional_files.append('cooling_ode_solver.o')
   elif (default[n] == 'SNEq'):
     pluto_path.append('Cooling/SNEq/')
     additional_files.append('cooling_source.o')
@@ -37,7 +37,7 @@ options.append(['NO','EXPLICIT'])
 default.append('NO')
 
 entries.append('INCLUDE_COOLING')
-options.append(['NO','POWER_LAW','TABULATED','SNEq','MINEq']) # ,'H2_COOL'])
+options.append(['NO','POWER_LAW','TABULATED','TAB_GRID','SNEq','MINEq']) # ,'H2_COOL'])
 default.append('NO')
 
 entries.append('INCLUDE_PARTICLES')
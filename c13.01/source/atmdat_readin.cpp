@@ -225,6 +225,8 @@ void atmdat_readin(void)
 
 	struc.heatstr = ((double*)MALLOC( (size_t)(struc.nzlim)*sizeof(double )));
 
+	struc.dCmHdTstr = ((double*)MALLOC( (size_t)(struc.nzlim)*sizeof(double )));
+
 	struc.testr = ((realnum*)MALLOC( (size_t)(struc.nzlim)*sizeof(realnum )));
 
 	struc.volstr = ((realnum*)MALLOC( (size_t)(struc.nzlim)*sizeof(realnum )));
@@ -347,6 +349,7 @@ void atmdat_readin(void)
 		struc.o3str[i] = 0.;
 		struc.heatstr[i] = 0.;
 		struc.coolstr[i] = 0.;
+		struc.dCmHdTstr[i] = 0.;
 		struc.pressure[i] = 0.;
 		struc.pres_radiation_lines_curr[i] = 0.;
 		struc.GasPressure[i] = 0.;
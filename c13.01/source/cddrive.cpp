@@ -37,6 +37,11 @@
 /*cdClosePunchFiles closes all the save files that have been used */
 /*cdB21cm - returns B as measured by 21 cm */
 /*cdPrtWL print line wavelengths in Angstroms in the standard format */
+/*cdSetDensityTable, cdSetTemperatureTable, cdSetWindTable pass tabulated structures */
+/*cdZoneResults get all depth structures needed by TPCI in one call */
+/*cdIsoPop_depth get the depth structure of one level of an iso sequence */
+/*cdSetIncidentSED pass the shape of the incident continuum once for all models */
+/*cdCoolHeatDeriv_depth get the depth structures of temperature and d(cooling-heating)/dT */
 
 /* CHANGES: (M. Salz 21.05.2013)
  *  - define routine cdEDEN_depth( double )
@@ -47,7 +52,12 @@
  *    cdWindVel_depth 
  *    cdCooling_depth
  *    cdHeating_depth 
- *    cdRadAcce_depth*/
+ *    cdRadAcce_depth
+ *  - cdSetDensityTable, cdSetTemperatureTable, cdSetWindTable
+ *  - cdZoneResults
+ *  - cdIsoPop_depth
+ *  - cdSetIncidentSED
+ *  - cdCoolHeatDeriv_depth */
 
 #include "cddefines.h"
 #include "trace.h"
@@ -79,6 +89,8 @@
 #include "cddrive.h"
 #include "iso.h"
 #include "save.h"
+#include "parser.h"
+#include "data_image.h"
 
 /*************************************************************************
  *
@@ -140,6 +152,9 @@ int cdDrive()
 		lgBAD = cloudy();
 	}
 
+	/* write the data image if COMPILE ATOMIC DATA was entered */
+	DataImageWrite();
+
 	/* reset flag saying that cdInit has not been called */
 	lgcdInitCalled = false;
 
@@ -540,6 +555,86 @@ void cdEDEN_depth( double cdEDEN[] )
 }
 
 
+/*************************************************************************
+ *
+ * cdZoneResults get the depth structure of all quantities of 
+ * cdDepth_depth, cdDenPart_depth, cdDenMass_depth, cdCooling_depth,
+ * cdHeating_depth, cdRadAcce_depth and cdEDEN_depth in one pass
+ *
+ ************************************************************************/
+long int cdZoneResults( double Depth[], double DenPart[], double DenMass[],
+	double Cooling[], double Heating[], double RadAccel[], double EDEN[],
+	long int nzmax )
+{
+	long int nz;
+
+	DEBUG_ENTRY( "cdZoneResults()" );
+
+	/* only the number of zones if the arrays are too short */
+	if( nzone > nzmax )
+		return nzone;
+
+	for( nz = 0; nz<nzone; ++nz )
+	{
+		Depth[nz] = struc.depth[nz];
+		DenPart[nz] = struc.DenParticles[nz];
+		DenMass[nz] = struc.DenMass[nz];
+		Cooling[nz] = struc.coolstr[nz];
+		Heating[nz] = struc.heatstr[nz];
+		RadAccel[nz] = struc.AccelTotalOutward[nz];
+		EDEN[nz] = struc.ednstr[nz];
+	}
+	return nzone;
+}
+
+
+/*************************************************************************
+ *
+ * cdCoolHeatDeriv_depth get the temperature and the derivative of 
+ * cooling - heating wrt temperature for all zones of the previous iteration
+ *
+ ************************************************************************/
+void cdCoolHeatDeriv_depth( double Temp[], double dCmHdT[] )
+{
+	long int nz;
+
+	DEBUG_ENTRY( "cdCoolHeatDeriv_depth()" );
+
+	for( nz = 0; nz<nzone; ++nz )
+	{
+		Temp[nz] = struc.testr[nz];
+		dCmHdT[nz] = struc.dCmHdTstr[nz];
+	}
+	return;
+}
+
+
+/*************************************************************************
+ *
+ * cdIsoPop_depth get the population (cm-3) of one level of the
+ * iso sequence ipISO of element nelem for all zones, 
+ * returns 1 if the element is off or the level does not exist
+ *
+ ************************************************************************/
+int cdIsoPop_depth( long ipISO, long nelem, long level, double cdPop[] )
+{
+	long int nz;
+
+	DEBUG_ENTRY( "cdIsoPop_depth()" );
+
+	if( ipISO < ipH_LIKE || ipISO >= NISO || nelem < ipISO || nelem >= LIMELM ||
+		!dense.lgElmtOn[nelem] || level < 0 || 
+		level >= iso_sp[ipISO][nelem].numLevels_max )
+		return 1;
+
+	for( nz = 0; nz<nzone; ++nz )
+	{
+		cdPop[nz] = struc.StatesElem[nelem][nelem-ipISO][level][nz];
+	}
+	return 0;
+}
+
+
 /*************************************************************************
  *
  * cdNoExec call this routine to tell code not to actually execute
@@ -650,6 +745,28 @@ double cdExecTime()
 	}
 }
 
+/* cdMaxRSS returns the peak resident set size of the process in MB,
+ * this includes the memory used before cdInit was called */
+double cdMaxRSS()
+{
+	DEBUG_ENTRY( "cdMaxRSS()" );
+
+#if defined(_MSC_VER) || defined(__HP_aCC)
+	return 0.;
+#else
+	struct rusage rusage;
+	if( getrusage(RUSAGE_SELF,&rusage) != 0 )
+		return 0.;
+#	ifdef __APPLE__
+	/* ru_maxrss is in bytes on Mac OS X... */
+	return (double)rusage.ru_maxrss/1048576.;
+#	else
+	/* ... and in kB on Linux */
+	return (double)rusage.ru_maxrss/1024.;
+#	endif
+#endif
+}
+
 /*************************************************************************
  *
  * cdPrintCommands prints all input commands into file
@@ -2041,8 +2158,9 @@ int cdRead(
 	if( strncmp(chCARD,"NO VARY",7) == 0 )
 		optimize.lgNoVary = true;
 
-	/* now check whether line is "grid" command */
-	if( strncmp(chCARD,"GRID",4) == 0 )
+	/* now check whether line is "grid" command, grid continue does
+	 * not go with a vary command */
+	if( strncmp(chCARD,"GRID",4) == 0 && !nMatch("CONT",chCARD) )
 	{
 		grid.lgGrid = true;
 		++grid.nGridCommands;
@@ -2097,6 +2215,74 @@ int cdRead(
 	return NKRD - input.nSave;
 }
 
+/*************************************************************************
+ *
+ * cdSetDensityTable, cdSetTemperatureTable, cdSetWindTable - enter 
+ * tabulated structures directly, the table command is entered with the
+ * EXTERNAL keyword and ParseTabulated takes the stored values
+ *
+ ************************************************************************/
+
+/* store the table and enter the command that uses it */
+STATIC int cdSetTable( int nTab, const char *chCommand, const double depth[], 
+	const double val[], long n, bool lgLinear )
+{
+	char chLine[INPUT_LINE_LENGTH];
+
+	DEBUG_ENTRY( "cdSetTable()" );
+
+	if( n < 1 )
+	{
+		fprintf( ioQQQ, " No pairs entered - can\'t interpolate.\n Sorry.\n" );
+		cdEXIT(EXIT_FAILURE);
+	}
+
+	TabulatedSetExternal( nTab, depth, val, n );
+
+	sprintf( chLine, "%s %s external", chCommand, lgLinear ? "linear" : "" );
+	return cdRead( chLine );
+}
+
+int cdSetDensityTable( const double depth[], const double val[], long n, bool lgLinear )
+{
+	DEBUG_ENTRY( "cdSetDensityTable()" );
+
+	return cdSetTable( TAB_DLAW, "dlaw table depth", depth, val, n, lgLinear );
+}
+
+int cdSetTemperatureTable( const double depth[], const double val[], long n, bool lgLinear )
+{
+	DEBUG_ENTRY( "cdSetTemperatureTable()" );
+
+	return cdSetTable( TAB_TLAW, "tlaw table depth", depth, val, n, lgLinear );
+}
+
+int cdSetWindTable( const double depth[], const double val[], long n, bool lgLinear,
+	const char *chOptions )
+{
+	char chCommand[INPUT_LINE_LENGTH];
+
+	DEBUG_ENTRY( "cdSetWindTable()" );
+
+	/* chOptions holds the other keywords of the wind command */
+	sprintf( chCommand, "wind %.*s table depth", INPUT_LINE_LENGTH-40, chOptions );
+	return cdSetTable( TAB_WIND, chCommand, depth, val, n, lgLinear );
+}
+
+void cdSetIncidentSED( const double nu[], const double flux[], long n )
+{
+	DEBUG_ENTRY( "cdSetIncidentSED()" );
+
+	if( n < 2 )
+	{
+		fprintf( ioQQQ, " There must be at least 2 pairs to interpolate.\n Sorry.\n" );
+		cdEXIT(EXIT_FAILURE);
+	}
+
+	InterpSetExternal( nu, flux, n );
+	return;
+}
+
 /* wrapper to close all save files */
 void cdClosePunchFiles()
 {
@@ -10,7 +10,17 @@
  *    cdWindVel_depth
  *    cdCooling_depth
  *    cdHeating_depth 
- *    cdRadAcce_depth*/
+ *    cdRadAcce_depth
+ *  - cdSetDensityTable, cdSetTemperatureTable, cdSetWindTable
+ *    pass tabulated structures without text input
+ *  - cdZoneResults returns all structures TPCI needs
+ *    in one call
+ *  - cdIsoPop_depth level populations for the transit
+ *    spectra of TPCI
+ *  - cdSetIncidentSED pass the incident continuum once,
+ *    used with interpolate external
+ *  - cdCoolHeatDeriv_depth temperature derivative of
+ *    cooling - heating for the implicit update of TPCI */
 
 #ifndef CDDRIVE_H_
 #define CDDRIVE_H_
@@ -110,6 +120,51 @@ double cdB21cm();
 */
 int cdRead( const char* );
 
+/**
+ * cdSetDensityTable 
+ * Enter the hydrogen density as a function of depth, replaces the
+ * "dlaw table depth" command and the lines of the table.  The values are
+ * used as they are and do not pass the text parser.  Must be called 
+ * after cdInit.  Returns the number of commands that can still be entered,
+ * as cdRead does.
+ * \param depth[]  depth into the cloud [cm], or log of depth if !lgLinear
+ * \param val[]    hydrogen density [cm-3], or log of it if !lgLinear
+ * \param n        number of pairs
+ * \param lgLinear interpolate on linear values
+ */
+int cdSetDensityTable( const double depth[], const double val[], long n, bool lgLinear );
+
+/**
+ * cdSetTemperatureTable 
+ * Enter the temperature as a function of depth, replaces the
+ * "tlaw table depth" command and the lines of the table.  Arguments and
+ * return value as for cdSetDensityTable, val[] is the temperature [K]. */
+int cdSetTemperatureTable( const double depth[], const double val[], long n, bool lgLinear );
+
+/**
+ * cdSetWindTable 
+ * Enter the wind velocity as a function of depth, replaces the
+ * "wind table depth" command and the lines of the table.  Arguments and
+ * return value as for cdSetDensityTable, val[] is the velocity [cm/s].
+ * \param chOptions further keywords of the wind command, e.g. "advection" 
+ */
+int cdSetWindTable( const double depth[], const double val[], long n, bool lgLinear,
+	const char *chOptions = "" );
+
+/**
+ * cdSetIncidentSED 
+ * Enter the shape of the incident continuum once, it is kept for all 
+ * following models.  Every model that uses it must contain the command
+ * "interpolate external" instead of the interpolate and continue lines,
+ * the pairs do not pass the text parser.  The normalization is set with
+ * the usual luminosity or intensity commands.
+ * \param nu[]    energies in the units of the interpolate command, 
+ *                Ryd, log Ryd, or log Hz
+ * \param flux[]  log of the flux per unit frequency
+ * \param n       number of pairs
+ */
+void cdSetIncidentSED( const double nu[], const double flux[], long n );
+
 /** 
  * cdPrtWL print line wavelengths in Angstroms in the standard format - 
  * a wrapper for prt_wl which must be kept parallel with sprt_wl
@@ -360,6 +415,16 @@ double cdHeating_last();
 */
 void cdHeating_depth( double Heat_struc[] );
 
+/**
+ * cdCoolHeatDeriv_depth
+ * returns the temperature and the derivative of cooling - heating 
+ * wrt temperature (erg cm^-3 s^-1 K^-1) at this temperature for all 
+ * zones of the previous model
+ * \param Temp[]
+ * \param dCmHdT[]
+*/
+void cdCoolHeatDeriv_depth( double Temp[], double dCmHdT[] );
+
 /**cdDenPart_depth return particle density struc. of previous model */
 void cdDenPart_depth( double DenPart[] );
 
@@ -384,6 +449,31 @@ double cdEDEN_last();
 */
 void cdEDEN_depth( double cdEDEN[] );
 
+/**
+ * cdZoneResults 
+ * returns the depth, particle density, mass density, cooling, heating,
+ * radiative acceleration and electron density structures of the
+ * previous model in one call. Nothing is copied if the model has more
+ * than nzmax zones, then the caller must enlarge the arrays and call again.
+ * \return number of zones
+*/
+long int cdZoneResults( double Depth[], double DenPart[], double DenMass[],
+	double Cooling[], double Heating[], double RadAccel[], double EDEN[],
+	long int nzmax );
+
+/**
+ * cdIsoPop_depth 
+ * returns the population (cm-3) of one level of an iso sequence 
+ * for all zones of the previous model, e.g. ipISO = ipHE_LIKE,
+ * nelem = ipHELIUM, level = ipHe2s3S for the metastable He triplet
+ * \param ipISO  iso sequence
+ * \param nelem  element on C scale
+ * \param level  level of the iso sequence
+ * \param cdPop[] array of nzone populations
+ * \return 0 if ok, 1 if the element is off or the level does not exist
+*/
+int cdIsoPop_depth( long ipISO, long nelem, long level, double cdPop[] );
+
  /** cdPressure_last
  * This returns the pressure and its constituents for the last computed zone. 
  \param  *TotalPressure total pressure, all forms
@@ -466,6 +556,10 @@ void cdSetExecTime();
  * since cdInit called cdSetExecTime.*/
 double cdExecTime();
 
+/** cdMaxRSS returns the peak resident set size of the process (MB),
+ * 0 if this is not known on this platform */
+double cdMaxRSS();
+
 /**
  \verbatim
  * cdGetLineList will read in a list of emission line labels and wavelengths
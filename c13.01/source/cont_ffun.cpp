@@ -215,40 +215,46 @@ double ffun1(double xnu)
 		 * make sure that requested energy is within bounds of array */
 		if( xnu >= rfield.tNu[rfield.ipSpec][0].Ryd()*1.000001 )
 		{
-			/* loop starts at second array element, [1], since want to 
-			 * find next continuum energy greater than desired point */
-			i = 1;
-			/* up to NCELL tabulated points may be read in.  Very fine
-			 * continuum mesh such as that output by stellar atmospheres 
-			 * can have very large number of points */
-			while( i< NCELL-1 && rfield.tNu[rfield.ipSpec][i].Ryd()>0. )
+			/* find the next continuum energy greater than desired point,
+			 * or the end of the table where tNu is zero.  Up to NCELL 
+			 * tabulated points may be read in.  Very fine continuum mesh 
+			 * such as that output by stellar atmospheres can have very 
+			 * large number of points, so this is done by bisection */
+			long ilo = 0, ihi = NCELL-1;
+			while( ihi-ilo > 1 )
 			{
-				if( xnu < rfield.tNu[rfield.ipSpec][i].Ryd() )
-				{
-					/* the energy xnu is between points rfield.tNuRyd[rfield.ipSpec][i-1]
-					 * and rfield.tNuRyd[rfield.ipSpec][i] - do linear 
-					 * interpolation in log log space */
-					y = rfield.tFluxLog[rfield.ipSpec][i-1] + 
-					  rfield.tslop[rfield.ipSpec][i-1]*
-					  log10(xnu/rfield.tNu[rfield.ipSpec][i-1].Ryd());
-
-					/* return value is photon density, div by energy */
-					ffun1_v = pow(10.,y);
-
-					/* this checks that overshoots did not occur - interpolated
-					 * value must be between lowest and highest point */
-#					ifndef NDEBUG
-					double ys1 = MIN2( rfield.tFluxLog[rfield.ipSpec][i-1],rfield.tFluxLog[rfield.ipSpec][i]);
-					double ys2 = MAX2( rfield.tFluxLog[rfield.ipSpec][i-1],rfield.tFluxLog[rfield.ipSpec][i]);
-					ys1 = pow( 10. , ys1 );
-					ys2 = pow( 10. , ys2 );
-					ASSERT( ffun1_v >= ys1/(1.+100.*FLT_EPSILON) );
-					ASSERT( ffun1_v <= ys2*(1.+100.*FLT_EPSILON) );
-#					endif
-					/* return value is photon density, div by energy */
-					return( ffun1_v/xnu );
-				}
-				++i;
+				long imid = (ilo+ihi)/2;
+				if( rfield.tNu[rfield.ipSpec][imid].Ryd() > 0. && 
+					xnu >= rfield.tNu[rfield.ipSpec][imid].Ryd() )
+					ilo = imid;
+				else
+					ihi = imid;
+			}
+			i = ihi;
+			if( i < NCELL-1 && rfield.tNu[rfield.ipSpec][i].Ryd() > 0. )
+			{
+				/* the energy xnu is between points rfield.tNuRyd[rfield.ipSpec][i-1]
+				 * and rfield.tNuRyd[rfield.ipSpec][i] - do linear 
+				 * interpolation in log log space */
+				y = rfield.tFluxLog[rfield.ipSpec][i-1] + 
+				  rfield.tslop[rfield.ipSpec][i-1]*
+				  log10(xnu/rfield.tNu[rfield.ipSpec][i-1].Ryd());
+
+				/* return value is photon density, div by energy */
+				ffun1_v = pow(10.,y);
+
+				/* this checks that overshoots did not occur - interpolated
+				 * value must be between lowest and highest point */
+#				ifndef NDEBUG
+				double ys1 = MIN2( rfield.tFluxLog[rfield.ipSpec][i-1],rfield.tFluxLog[rfield.ipSpec][i]);
+				double ys2 = MAX2( rfield.tFluxLog[rfield.ipSpec][i-1],rfield.tFluxLog[rfield.ipSpec][i]);
+				ys1 = pow( 10. , ys1 );
+				ys2 = pow( 10. , ys2 );
+				ASSERT( ffun1_v >= ys1/(1.+100.*FLT_EPSILON) );
+				ASSERT( ffun1_v <= ys2*(1.+100.*FLT_EPSILON) );
+#				endif
+				/* return value is photon density, div by energy */
+				return( ffun1_v/xnu );
 			}
 			/* energy above highest in table */
 			ffun1_v = 0.;
@@ -21,6 +21,7 @@
 #include "conv.h"
 #include "hmi.h"
 #include "dynamics.h"
+#include "state.h"
 
 /* derivative of net cooling wrt temperature to check on sign oscillations */
 static double dCoolNetDTOld = 0;
@@ -305,9 +306,11 @@ bool ConvInitSolution()
 	/********************************************************************
 	 *
 	 * this is second or higher iteration, reestablish original temperature
+	 * the same is done on the first iteration if the structure of a previous
+	 * model was recovered with the state get warm command
 	 *
 	 *********************************************************************/
-	if( iteration != 1 )
+	if( iteration != 1 || (state.lgWarmStart && struc.testr[0] > 0.) )
 	{
 		/* this is second or higher iteration on multi-iteration model */
 		if( trace.lgTrace || trace.nTrConvg )
@@ -710,6 +713,7 @@ bool ConvInitSolution()
 		struc.DenParticles[0] = dense.pden;
 		struc.heatstr[0] = thermal.htot;
 		struc.coolstr[0] = thermal.ctot;
+		struc.dCmHdTstr[0] = thermal.dCooldT - thermal.dHeatdT;
 		struc.volstr[0] = (realnum)radius.dVeffAper;
 		struc.drad_x_fillfac[0] = (realnum)radius.drad_x_fillfac;
 		struc.histr[0] = dense.xIonDense[ipHYDROGEN][0];
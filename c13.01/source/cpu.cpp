@@ -42,6 +42,7 @@ extern "C" void fpsetmask(unsigned long);
 #include "cpu.h"
 #include "path.h"
 #include "trace.h"
+#include "data_image.h"
 
 STATIC NORETURN void AbortErrorMessage( const char* fname, vector<string>& PathList, access_scheme scheme );
 
@@ -623,13 +624,23 @@ FILE* open_data( const char* fname, const char* mode, access_scheme scheme )
 	vector<string> PathList;
 	cpu.i().getPathList( fname, PathList, scheme );
 
+	/* read-only data files may come from the precompiled data image, 
+	 * and are remembered for COMPILE ATOMIC DATA */
+	bool lgImage = ( scheme == AS_DATA_ONLY || scheme == AS_DATA_ONLY_TRY || scheme == AS_DATA_OPTIONAL ) &&
+		mode[0] == 'r' && strchr( mode, '+' ) == NULL;
+
 	FILE* handle = NULL;
 	vector<string>::const_iterator ptr;
 	for( ptr=PathList.begin(); ptr != PathList.end() && handle == NULL; ++ptr )
 	{
-		handle = fopen( ptr->c_str(), mode );
+		if( lgImage )
+			handle = DataImageOpen( *ptr, mode );
+		if( handle == NULL )
+			handle = fopen( ptr->c_str(), mode );
 		if( trace.lgTrace && scheme != AS_SILENT_TRY )
 			fprintf( ioQQQ, " open_data trying %s mode %s handle %p\n", ptr->c_str(), mode, handle );
+		if( handle != NULL && lgImage )
+			DataImageRecord( *ptr );
 	}
 
 	if( handle == NULL && lgAbort )
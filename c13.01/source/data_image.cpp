@@ -0,0 +1,299 @@
+/* This file is part of Cloudy and is copyright (C)1978-2013 by Gary J. Ferland and
+ * others.  For conditions of distribution and use see copyright notice in license.txt */
+/*DataImageOpen open a data file from the precompiled data image */
+/*DataImageRecord remember a data file that was read, for COMPILE ATOMIC DATA */
+/*DataImageCompile say that the data image should be written */
+/*DataImageWrite write all data files read so far into the data image */
+
+#include "cdstd.h"
+#if defined(__unix) || defined(__APPLE__)
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#define HAVE_DATA_IMAGE
+#endif
+
+/* the redefinition of float in cddefines.h can cause problems in system headers
+ * hence these includes MUST come after the system header includes above */
+#include "cddefines.h"
+#include "data_image.h"
+#include "version.h"
+#include "trace.h"
+
+namespace
+{
+	/* increase when the layout below changes */
+	const char DataImageMagic[8] = "CLDYDI1";
+
+	struct t_image_head
+	{
+		char magic[8];
+		/* 0x12345678 in the byte order of the machine that wrote the image */
+		int32 endian;
+		int32 nfile;
+		char version[64];
+		/* checksum of the directory that follows the header */
+		uint64 sum;
+	};
+
+	struct t_image_entry
+	{
+		char path[FILENAME_PATH_LENGTH_2];
+		/* offset from the start of the image, size and modification
+		 * time of the original file, checksum of the contents */
+		int64 offset;
+		int64 size;
+		int64 mtime;
+		uint64 sum;
+	};
+
+	/* has the image been looked for, is COMPILE ATOMIC DATA active */
+	bool lgImageTried = false;
+	bool lgImageCompile = false;
+
+	/* the mapped image, its directory, whether each entry matches the
+	 * original file (checked once by DataImageLoad), and whether the
+	 * checksum of each entry was already verified */
+	char *Image = NULL;
+	size_t ImageSize = 0;
+	const t_image_entry *ImageDir = NULL;
+	long ImageNfile = 0;
+	vector<bool> lgImageValid;
+	vector<bool> lgImageChecked;
+
+	/* data files read in this run */
+	vector<string> ImageFiles;
+
+	/* FNV-1a hash, good enough to detect a corrupted file */
+	uint64 DataImageSum( const char *buf, size_t n )
+	{
+		uint64 sum = 14695981039346656037UL;
+		for( size_t i=0; i < n; ++i )
+		{
+			sum ^= (unsigned char)buf[i];
+			sum *= 1099511628211UL;
+		}
+		return sum;
+	}
+
+#	ifdef HAVE_DATA_IMAGE
+	void DataImageUnmap()
+	{
+		munmap( Image, ImageSize );
+		Image = NULL;
+		ImageDir = NULL;
+		ImageNfile = 0;
+	}
+
+	/* map the image and check the header */
+	void DataImageLoad()
+	{
+		DEBUG_ENTRY( "DataImageLoad()" );
+
+		lgImageTried = true;
+
+		FILE *io = open_data( DATA_IMAGE_FILE, "rb", AS_DATA_LOCAL_TRY );
+		if( io == NULL )
+			return;
+
+		struct stat st;
+		if( fstat( fileno(io), &st ) == 0 && size_t(st.st_size) > sizeof(t_image_head) )
+		{
+			ImageSize = st.st_size;
+			void *map = mmap( NULL, ImageSize, PROT_READ, MAP_SHARED, fileno(io), 0 );
+			if( map != MAP_FAILED )
+				Image = (char*)map;
+		}
+		fclose( io );
+		if( Image == NULL )
+			return;
+
+		const t_image_head *head = (const t_image_head*)Image;
+		size_t dirsize = head->nfile*sizeof(t_image_entry);
+		if( memcmp( head->magic, DataImageMagic, sizeof(DataImageMagic) ) != 0 ||
+			 head->endian != 0x12345678 || head->nfile < 0 ||
+			 sizeof(t_image_head)+dirsize > ImageSize ||
+			 strncmp( head->version, t_version::Inst().chVersion, sizeof(head->version)-1 ) != 0 ||
+			 DataImageSum( Image+sizeof(t_image_head), dirsize ) != head->sum )
+		{
+			if( trace.lgTrace )
+				fprintf( ioQQQ, " DataImageLoad: %s is from another version or damaged, ignored\n",
+							DATA_IMAGE_FILE );
+			DataImageUnmap();
+			return;
+		}
+
+		ImageDir = (const t_image_entry*)(Image+sizeof(t_image_head));
+		ImageNfile = head->nfile;
+		lgImageChecked.assign( ImageNfile, false );
+
+		/* entries whose original file was changed after the image was
+		 * written are not used, this is checked once here rather than
+		 * on every open */
+		long nvalid = 0;
+		lgImageValid.assign( ImageNfile, false );
+		for( long i=0; i < ImageNfile; ++i )
+		{
+			const t_image_entry &e = ImageDir[i];
+			if( e.size == 0 || e.offset < 0 || size_t(e.offset+e.size) > ImageSize ||
+				 memchr( e.path, '\0', sizeof(e.path) ) == NULL )
+				continue;
+			if( stat( e.path, &st ) != 0 || st.st_size != e.size ||
+				 int64(st.st_mtime) != e.mtime )
+				continue;
+			lgImageValid[i] = true;
+			++nvalid;
+		}
+
+		if( trace.lgTrace )
+			fprintf( ioQQQ, " DataImageLoad: mapped %s with %ld files, %ld up to date\n",
+						DATA_IMAGE_FILE, ImageNfile, nvalid );
+	}
+#	endif
+}
+
+FILE *DataImageOpen( const string& path, const char* mode )
+{
+	DEBUG_ENTRY( "DataImageOpen()" );
+
+#	ifdef HAVE_DATA_IMAGE
+	if( !lgImageTried )
+		DataImageLoad();
+
+	if( ImageNfile == 0 )
+		return NULL;
+
+	ASSERT( mode[0] == 'r' && strchr( mode, '+' ) == NULL );
+
+	for( long i=0; i < ImageNfile; ++i )
+	{
+		const t_image_entry &e = ImageDir[i];
+		if( strncmp( e.path, path.c_str(), sizeof(e.path) ) != 0 )
+			continue;
+
+		/* the original file was changed after the image was written */
+		if( !lgImageValid[i] )
+			return NULL;
+
+		if( !lgImageChecked[i] )
+		{
+			if( DataImageSum( Image+e.offset, e.size ) != e.sum )
+			{
+				fprintf( ioQQQ, " PROBLEM the entry for %s in %s is damaged, reading the file instead.\n",
+							path.c_str(), DATA_IMAGE_FILE );
+				return NULL;
+			}
+			lgImageChecked[i] = true;
+		}
+
+		/* the stream is read-only, so the buffer is never written */
+		return fmemopen( Image+e.offset, e.size, mode );
+	}
+#	else
+	(void)path;
+	(void)mode;
+#	endif
+	return NULL;
+}
+
+void DataImageRecord( const string& path )
+{
+	DEBUG_ENTRY( "DataImageRecord()" );
+
+	if( find( ImageFiles.begin(), ImageFiles.end(), path ) == ImageFiles.end() )
+		ImageFiles.push_back( path );
+}
+
+void DataImageCompile()
+{
+	lgImageCompile = true;
+}
+
+void DataImageWrite()
+{
+	DEBUG_ENTRY( "DataImageWrite()" );
+
+	if( !lgImageCompile || !cpu.i().lgMaster() )
+		return;
+	lgImageCompile = false;
+
+#	ifdef HAVE_DATA_IMAGE
+	vector<t_image_entry> dir;
+	vector<string> contents;
+	int64 offset = sizeof(t_image_head) + ImageFiles.size()*sizeof(t_image_entry);
+	for( size_t i=0; i < ImageFiles.size(); ++i )
+	{
+		const string &path = ImageFiles[i];
+		if( path.size() >= FILENAME_PATH_LENGTH_2 )
+			continue;
+
+		FILE *io = open_data( path.c_str(), "rb", AS_LOCAL_ONLY_TRY );
+		if( io == NULL )
+			continue;
+		struct stat st;
+		if( fstat( fileno(io), &st ) != 0 )
+		{
+			fclose( io );
+			continue;
+		}
+		string buf( st.st_size, '\0' );
+		size_t nread = ( st.st_size > 0 ) ? fread( &buf[0], 1, st.st_size, io ) : 0;
+		fclose( io );
+		if( nread != size_t(st.st_size) )
+			continue;
+
+		t_image_entry e;
+		memset( &e, 0, sizeof(e) );
+		strncpy( e.path, path.c_str(), sizeof(e.path) );
+		e.offset = offset;
+		e.size = st.st_size;
+		e.mtime = st.st_mtime;
+		e.sum = DataImageSum( buf.data(), buf.size() );
+		dir.push_back( e );
+		contents.push_back( buf );
+		/* keep the entries 8-byte aligned */
+		offset += ( e.size + 7 ) & ~int64(7);
+	}
+
+	t_image_head head;
+	memset( &head, 0, sizeof(head) );
+	memcpy( head.magic, DataImageMagic, sizeof(head.magic) );
+	head.endian = 0x12345678;
+	head.nfile = (int32)dir.size();
+	strncpy( head.version, t_version::Inst().chVersion, sizeof(head.version)-1 );
+
+	/* entries that were skipped change the offsets */
+	int64 shift = (int64)(ImageFiles.size()-dir.size())*sizeof(t_image_entry);
+	for( size_t i=0; i < dir.size(); ++i )
+		dir[i].offset -= shift;
+	head.sum = DataImageSum( (const char*)get_ptr(dir), dir.size()*sizeof(t_image_entry) );
+
+	/* a new file is moved over the old one, which may be mapped */
+	string tmpname = string(DATA_IMAGE_FILE) + ".tmp";
+	FILE *io = open_data( tmpname.c_str(), "wb", AS_LOCAL_ONLY );
+	bool lgOK = ( fwrite( &head, sizeof(head), 1, io ) == 1 );
+	if( dir.size() > 0 )
+		lgOK = lgOK && ( fwrite( get_ptr(dir), sizeof(t_image_entry), dir.size(), io ) == dir.size() );
+	const char pad[8] = { 0 };
+	for( size_t i=0; i < dir.size() && lgOK; ++i )
+	{
+		lgOK = ( fwrite( contents[i].data(), 1, contents[i].size(), io ) == contents[i].size() );
+		size_t npad = size_t( ( ( dir[i].size + 7 ) & ~int64(7) ) - dir[i].size );
+		if( npad > 0 )
+			lgOK = lgOK && ( fwrite( pad, 1, npad, io ) == npad );
+	}
+	lgOK = ( fclose( io ) == 0 ) && lgOK;
+	lgOK = lgOK && ( rename( tmpname.c_str(), DATA_IMAGE_FILE ) == 0 );
+
+	if( !lgOK )
+	{
+		fprintf( ioQQQ, " PROBLEM DISASTER writing %s failed.\n", DATA_IMAGE_FILE );
+		cdEXIT(EXIT_FAILURE);
+	}
+	fprintf( ioQQQ, "\n Created %s with %ld data files, %.1f MB.\n"
+		 " Move it into the data directory, or keep it in the directory where Cloudy is run.\n",
+		 DATA_IMAGE_FILE, (long)dir.size(), double(offset-shift)/1.e6 );
+#	else
+	fprintf( ioQQQ, " The data image is not supported on this system.\n" );
+#	endif
+}
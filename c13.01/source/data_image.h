@@ -0,0 +1,39 @@
+/* This file is part of Cloudy and is copyright (C)1978-2013 by Gary J. Ferland and
+ * others.  For conditions of distribution and use see copyright notice in license.txt */
+
+#ifndef DATA_IMAGE_H_
+#define DATA_IMAGE_H_
+
+/**\file data_image.h
+ * precompiled image of the data files.  The COMPILE ATOMIC DATA command
+ * writes all data files which were read during the calculation into one
+ * binary file, cloudy_data.img.  Later runs map this file read-only into
+ * memory and read the data files from there, so that all MPI ranks on a
+ * node share the same pages.  Every entry is checked against the size and
+ * modification time of the original file when the image is mapped and
+ * has a checksum, the image is only used with the version of the code
+ * which wrote it.  Only files opened as FILE* by open_data are read from
+ * the image, files read through the fstream version of open_data are
+ * always read from disk */
+
+/** name of the image, searched in the data path and then in the
+ * current directory */
+#define DATA_IMAGE_FILE "cloudy_data.img"
+
+/** open a data file from the image, returns NULL if the file is not in
+ * the image or is out of date, the caller then opens the file itself
+ * \param path full path of the data file
+ * \param mode must be a read-only mode
+ */
+FILE *DataImageOpen( const string& path, const char* mode );
+
+/** remember a data file that was read, it is included in the image */
+void DataImageRecord( const string& path );
+
+/** COMPILE ATOMIC DATA was given, write the image at the end */
+void DataImageCompile();
+
+/** write the image if it was requested, called at the end of cdDrive */
+void DataImageWrite();
+
+#endif /* DATA_IMAGE_H_ */
@@ -10,6 +10,7 @@
 /* DynaZero zero some dynamics variables, called from zero.c */
 /* DynaCreateArrays allocate some space needed to save the dynamics structure variables, 
  * called from DynaCreateArrays */
+/* DynaStateGetPut get or save the structure of the previous iteration, called from state_get_put */
 /* DynaPrtZone - called to print zone results */
 /* DynaSave save info related to advection */
 /* DynaSave, save output for dynamics solutions */
@@ -50,6 +51,7 @@
 #include "cosmology.h"
 #include "taulines.h"
 #include "parser.h"
+#include "state.h"
 t_dynamics dynamics;
 static int ipUpstream=-1,iphUpstream=-1,ipyUpstream=-1;
 
@@ -1620,6 +1622,76 @@ void DynaCreateArrays( void )
 	return;
 }
 
+/* ============================================================================== */
+/* DynaStateGetPut get or save the structure of the previous iteration, 
+ * called from state_get_put when advection is turned on */
+void DynaStateGetPut( bool lgGetState )
+{
+	long int i,
+		nelem,
+		ipISO;
+
+	DEBUG_ENTRY( "DynaStateGetPut()" );
+
+	/* the number of zones, the depth and the advection length 
+	 * of the previous iteration */
+	state_do( &nOld_zone , sizeof(nOld_zone) );
+	if( nOld_zone < 0 || nOld_zone >= struc.nzlim )
+	{
+		fprintf( ioQQQ, " DynaStateGetPut: the state file has %li zones, but the limit is %li.\n",
+			nOld_zone , struc.nzlim );
+		cdEXIT(EXIT_FAILURE);
+	}
+	state_do( &dynamics.oldFullDepth , sizeof(dynamics.oldFullDepth) );
+	state_do( &Dyn_dr , sizeof(Dyn_dr) );
+
+	size_t nsize = (size_t)nOld_zone*sizeof(realnum);
+	state_do( Old_histr , nsize );
+	state_do( Old_xLyman_depth , nsize );
+	state_do( Old_depth , nsize );
+	state_do( Old_hiistr , nsize );
+	state_do( Old_pressure , nsize );
+	state_do( Old_density , nsize );
+	state_do( Old_DenMass , nsize );
+	state_do( Old_ednstr , nsize );
+	state_do( Old_EnthalpyDensity , nsize );
+
+	for( i=0; i<nOld_zone; ++i )
+	{
+		state_do( Old_molecules[i] , (size_t)mole_global.num_calc*sizeof(realnum) );
+		state_do( Old_gas_phase[i] , (size_t)LIMELM*sizeof(realnum) );
+		for( nelem=ipHYDROGEN; nelem<LIMELM; ++nelem )
+		{
+			state_do( Old_xIonDense[i][nelem] , (size_t)(nelem+2)*sizeof(realnum) );
+		}
+		for( ipISO=ipH_LIKE; ipISO<NISO; ++ipISO )
+		{
+			for( nelem=ipISO; nelem<LIMELM; ++nelem)
+			{
+				if( dense.lgElmtOn[nelem] )
+				{
+					state_do( Old_StatesElem[i][nelem][nelem-ipISO] ,
+						(size_t)iso_sp[ipISO][nelem].numLevels_max*sizeof(realnum) );
+				}
+			}
+		}
+	}
+
+	if( lgGetState && state.lgWarmStart && !dynamics.lgTimeDependentStatic )
+	{
+		/* the upstream structure and the advection length are known,
+		 * so the advective terms are included from the first iteration
+		 * on and no relaxation iterations are needed */
+		dynamics.n_initial_relax = -1;
+		if( dynamics.lgTracePrint )
+		{
+			fprintf(ioQQQ," DynaStateGetPut, warm start with %li zones, dr=%.2e \n",
+				nOld_zone , Dyn_dr );
+		}
+	}
+	return;
+}
+
 /*advection_set_default - called to set default conditions
  * when time and wind commands are parsed,
  * lgWind is true if dynamics, false if time dependent */
@@ -2028,7 +2100,7 @@ void ParseDynaWind( Parser &p)
 		wind.lgTabulated = true;
 
 		/* parse the tabulated values  */
-		ParseTabulated( p, &wind.lgTabDepth, &wind.lgTabLinear, wind.tabrad, wind.tabval, &wind.nvals );
+		ParseTabulated( p, TAB_WIND, &wind.lgTabDepth, &wind.lgTabLinear, wind.tabrad, wind.tabval, &wind.nvals );
 
 		/* set initial velocity and static + ballistic = false */
 		wind.windv0 = wind.tabval[0];
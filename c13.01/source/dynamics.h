@@ -25,6 +25,11 @@ void DynaZero( void );
 /**DynaCreateArrays allocate some space needed to save the dynamics structure variables, called from atmdat_readin */
 void DynaCreateArrays( void );
 
+/**DynaStateGetPut get or save the structure of the previous iteration, called from state_get_put 
+\param lgGetState true if state is read, false if it is saved
+*/
+void DynaStateGetPut( bool lgGetState );
+
 /** ParseDynaWind parse the wind command, called from ParseCommands 
 \param *chCard
 */
@@ -41,6 +41,12 @@ struct t_grid
 		lgGridDone,
 		lgStrictRepeat;
 
+	/** set true with grid continue, skip the models done in an earlier run */
+	bool lgGridCont;
+
+	/** models of the grid that were done in an earlier run */
+	vector<int> ModelsDone;
+
 	/** number of grid commands entered */
 	long int nGridCommands;
 
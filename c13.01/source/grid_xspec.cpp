@@ -229,9 +229,47 @@ void GridGatherInCloudy()
 				cdSPEC2( i, grid.numEnergies, grid.ipLoEnergy, grid.ipHiEnergy,
 					 &grid.Spectra[i][optimize.nOptimiz][0]);
 		}
+
+		/* keep the spectra on disk until the grid is done, so that
+		 * they are available after a grid continue */
+		if( grid.Spectra.size() > 0 )
+		{
+			string fnam = GridPointPrefix(optimize.nOptimiz) + save.chRedirectPrefix + ".spc";
+			FILE *io = open_data( fnam.c_str(), "wb", AS_LOCAL_ONLY );
+			for( i=0; i < NUM_OUTPUT_TYPES; i++ )
+			{
+				if( grid.lgOutputTypeOn[i] )
+					fwrite( &grid.Spectra[i][optimize.nOptimiz][0], sizeof(realnum),
+						(size_t)grid.numEnergies, io );
+			}
+			fclose( io );
+		}
 	}
 	else if( optimize.nOptimiz == grid.totNumModels )
 	{
+		/* the master reads the spectra of the models done in an earlier run */
+		if( cpu.i().lgMaster() && grid.Spectra.size() > 0 )
+		{
+			for( unsigned k=0; k < grid.ModelsDone.size(); ++k )
+			{
+				long j = grid.ModelsDone[k];
+				string fnam = GridPointPrefix(j) + save.chRedirectPrefix + ".spc";
+				FILE *io = open_data( fnam.c_str(), "rb", AS_LOCAL_ONLY_TRY );
+				bool lgOK = ( io != NULL );
+				for( i=0; i < NUM_OUTPUT_TYPES && lgOK; i++ )
+				{
+					if( grid.lgOutputTypeOn[i] )
+						lgOK = ( fread( &grid.Spectra[i][j][0], sizeof(realnum),
+								(size_t)grid.numEnergies, io ) == (size_t)grid.numEnergies );
+				}
+				if( io != NULL )
+					fclose( io );
+				if( !lgOK )
+					fprintf( ioQQQ, " PROBLEM GridGatherInCloudy: could not read the spectra "
+						 "of grid model %ld from %s.\n", j, fnam.c_str() );
+			}
+		}
+
 		if( cpu.i().lgMPI() )
 		{
 			multi_arr<realnum,3> Spectra_Copy = grid.Spectra;
@@ -215,6 +215,7 @@ void InitCoreload( void )
 	 * default save is different for these */
 	grid.lgGridDone = false;
 	grid.lgStrictRepeat = false;
+	grid.lgGridCont = false;
 
 	/* these are energy range... if not changed with command, 0. says just use energy limits of mesh */
 	grid.LoEnergy_keV = 0.;
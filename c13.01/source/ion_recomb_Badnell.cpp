@@ -20,6 +20,7 @@
 #include "ionbal.h"
 #include "dense.h"
 #include "taulines.h"
+#include "rate_cache.h"
 
 static const int MAX_FIT_PAR_DR = 9;
 static double ***DRFitParPart1; 
@@ -41,6 +42,12 @@ static double RecNoise[LIMELM],
 static char chDRDataSource[LIMELM][LIMELM][10];
 static char chRRDataSource[LIMELM][LIMELM][10];
 
+/* the RR and DR rate coefficients for the last few (te,eden) pairs, 
+ * in each entry the DR, RR Badnell, RR Verner, RR used rates and the
+ * lgDR_BadWeb_exist flags of all ions, then the mean DR rates */
+static t_rate_cache RecomCache( "recombination" );
+static const long NRECOMCACHE = 5*(LIMELM*(LIMELM+1))/2 + LIMELM;
+
 /* these enable certain debugging print statements */
 /* #define PRINT_DR */
 /* #define PRINT_RR */
@@ -1191,20 +1198,33 @@ void Badnell_rec_init( void )
 /*ion_recom_calculate calculate radiative and dielectronic recombination rate coefficients */
 void ion_recom_calculate( void )
 {
-	static double TeUsed = -1 , EdenUsed = -1.;
-
 	DEBUG_ENTRY( "ion_recom_calculate()" );
 
-	/* do not reevaluate if change in temperature is small */
-	if( fp_equal(phycon.te,TeUsed) && fp_equal( dense.eden , EdenUsed ))
+	/* do not reevaluate if this temperature and electron density
+	 * were done recently */
+	bool lgHit;
+	double *cache = RecomCache.find( phycon.te, dense.eden, NRECOMCACHE, lgHit );
+	if( lgHit )
+	{
+		for( long nelem=ipHYDROGEN; nelem < LIMELM; ++nelem )
+		{
+			for( long ion=0; ion < nelem+1; ++ion )
+			{
+				ionbal.DR_Badnell_rate_coef[nelem][ion] = *cache++;
+				ionbal.RR_Badnell_rate_coef[nelem][ion] = *cache++;
+				ionbal.RR_Verner_rate_coef[nelem][ion] = *cache++;
+				ionbal.RR_rate_coef_used[nelem][ion] = *cache++;
+				lgDR_BadWeb_exist[nelem][ion] = ( *cache++ > 0. );
+			}
+		}
+		for( long nelem=0; nelem < LIMELM; ++nelem )
+			DR_Badnell_rate_coef_mean_ion[nelem] = *cache++;
 		return;
+	}
 
 	// collisional suppression factors
 	//CollisSuppres();
 
-	TeUsed = phycon.te;
-	EdenUsed = dense.eden;
-
 	for( long nelem=ipHYDROGEN; nelem < LIMELM; ++nelem )
 	{
 
@@ -1385,6 +1405,20 @@ void ion_recom_calculate( void )
 		}
 	}
 
+	for( long nelem=ipHYDROGEN; nelem < LIMELM; ++nelem )
+	{
+		for( long ion=0; ion < nelem+1; ++ion )
+		{
+			*cache++ = ionbal.DR_Badnell_rate_coef[nelem][ion];
+			*cache++ = ionbal.RR_Badnell_rate_coef[nelem][ion];
+			*cache++ = ionbal.RR_Verner_rate_coef[nelem][ion];
+			*cache++ = ionbal.RR_rate_coef_used[nelem][ion];
+			*cache++ = lgDR_BadWeb_exist[nelem][ion] ? 1. : 0.;
+		}
+	}
+	for( long nelem=0; nelem < LIMELM; ++nelem )
+		*cache++ = DR_Badnell_rate_coef_mean_ion[nelem];
+
 	/* this set true with PRINT RECOMBINATION recombination commands */
 	if( ionbal.lgRecom_Badnell_print )
 	{
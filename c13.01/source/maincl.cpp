@@ -60,9 +60,11 @@ int main( int argc, char *argv[] )
 		// from now on each rank will run its own model
 		cpu.i().set_MPISingleRankMode( true );
 
-		load_balance lb( grid.totNumModels );
+		load_balance lb( grid.totNumModels, save.chRedirectPrefix, grid.lgGridCont );
+		grid.ModelsDone = lb.jobs_done_before();
+		exit_status = max( lb.status_done_before(), exit_status );
 
-		// Each MPI rank will get jobs assigned by lb and execute them.
+		// Each MPI rank will claim jobs from lb and execute them.
 		// If there are no jobs left, lb.next_job() will return -1.
 		while( ( optimize.nOptimiz = lb.next_job() ) >= 0 )
 		{
@@ -75,6 +77,7 @@ int main( int argc, char *argv[] )
 			mpi_argv[argc+1] = jobName.c_str();
 
 			exit_type retval = cdMain( argc+2, mpi_argv );
+			lb.job_done( optimize.nOptimiz, retval );
 
 			exit_status = max( retval, exit_status );
 			delete[] mpi_argv;
@@ -131,7 +134,8 @@ exit_type cdMain( int argc, const char* argv[] )
 
 	bool lgAbort_exit,
 	  lgEarly_exit=true,
-	  lgFileIO;
+	  lgFileIO,
+	  lgPrintMemory=false;
 	/* number of lines we can still read in */
 	int nread=0;
 
@@ -203,6 +207,9 @@ exit_type cdMain( int argc, const char* argv[] )
 					case 'a':
 						cpu.i().setAssertAbort( true );
 						break;
+					case 'm':
+						lgPrintMemory = true;
+						break;
 					case 'g':
 					case 'p':
 					case 'r':
@@ -266,6 +273,8 @@ exit_type cdMain( int argc, const char* argv[] )
 						fprintf( ioQQQ, "    This switch is used in debugging. It causes the\n" );
 						fprintf( ioQQQ, "    code to crash rather than exit gracefully after\n" );
 						fprintf( ioQQQ, "    a failed assert. This flag is deprecated.\n" );
+						fprintf( ioQQQ, "-m\n" );
+						fprintf( ioQQQ, "    Print the peak memory use after the final message.\n" );
 						fprintf( ioQQQ, "-h\n" );
 						fprintf( ioQQQ, "    Print this message.\n" );
 						cdEXIT(exit);
@@ -474,7 +483,12 @@ exit_type cdMain( int argc, const char* argv[] )
 		}
 
 		if( called.lgTalk )
+		{
 			fprintf( ioQQQ, "%s\n", finalMsg.str().c_str() );
+			/* peak memory use with the -m flag, read by the benchmark script tsuite/bench/run_bench.pl */
+			if( lgPrintMemory )
+				fprintf( ioQQQ, " Peak memory(MB) %.1f\n", cdMaxRSS() );
+		}
 
 		lgEarly_exit = false;
 
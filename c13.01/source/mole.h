@@ -303,6 +303,11 @@ public:
 	 * By default, this is false - changed with set chemistry command */
 	bool lgNeutrals;
 
+	/** solve the linear system of the Newton step with the sparse LU 
+	 * solver, which reuses its symbolic factorization for all zones,
+	 * set with set chemistry solver sparse command, default is false */
+	bool lgSparseSolve;
+
 	 /** do we include capture of molecules onto grain surfaces?  default is true,
 	  * turned off with NO GRAIN MOLECULES command */
 	bool lgGrain_mole_deplete;
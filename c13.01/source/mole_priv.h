@@ -61,6 +61,9 @@ class mole_reaction {
 	int source;
 	long index;
 	virtual double rk() const = 0;
+	/** true if rk() only depends on the temperature, these rates
+	 * are kept in the rate cache by mole_update_rks */
+	virtual bool lgTempOnly() const {return false;}
 	virtual mole_reaction* Create() const = 0;
 	virtual const char *name() = 0;
 	virtual ~mole_reaction() {};
@@ -23,6 +23,7 @@
 #include "taulines.h"
 #include "trace.h"
 #include "deuterium.h"
+#include "rate_cache.h"
 
 /*
  * HOWTO:- add a reaction to the new CO network, as at 2006 December 18.
@@ -220,6 +221,7 @@ namespace {
 		virtual T* Create() const {return new T;}
 		
 		virtual const char* name() {return "hmrate_exo";}
+		virtual bool lgTempOnly() const {return true;}
 		
 		double rk() const
 			{
@@ -243,6 +245,7 @@ namespace {
 	public:
 		virtual T* Create() const {return new T;}
 		virtual const char* name() {return "hmrate";}
+		virtual bool lgTempOnly() const {return true;}
 		double rk() const
 			{
 				return hmrate(this);
@@ -255,6 +258,7 @@ namespace {
 	public:
 		virtual T* Create() const {return new T;}
 		virtual const char* name() {return "constrate";}
+		virtual bool lgTempOnly() const {return true;}
 		double rk() const
 			{
 				return 1.;
@@ -2837,23 +2841,43 @@ namespace
 	}
 }
 
-void mole_update_rks(void)
+namespace
 {
-	enum { DEBUG_MOLE = false };
+	/* reactions whose rates only depend on the temperature, split into the
+	 * Arrhenius type (hmrate) and the rest, and all other reactions */
+	vector<mole_reaction*> rks_hmrate, rks_temp, rks_other;
+	valarray<double> rks_a, rks_te;
+	t_rate_cache rks_cache( "chemistry" );
 
-	DEBUG_ENTRY("mole_update_rks()");
+	void mole_rks_classify(void)
+	{
+		DEBUG_ENTRY("mole_rks_classify()");
 
-	mole_h2_grain_form();
-	
-	mole_h_reactions();
-	
-	for (mole_reaction_i p
-			  =mole_priv::reactab.begin(); p != mole_priv::reactab.end(); ++p) 
+		rks_hmrate.clear();
+		rks_temp.clear();
+		rks_other.clear();
+		for (mole_reaction_i p
+				  =mole_priv::reactab.begin(); p != mole_priv::reactab.end(); ++p) 
+		{
+			mole_reaction *rate = &(*p->second);
+			if( !rate->lgTempOnly() )
+				rks_other.push_back( rate );
+			else if( strcmp( rate->name(), "hmrate" ) == 0 )
+				rks_hmrate.push_back( rate );
+			else
+				rks_temp.push_back( rate );
+		}
+		rks_a.resize( rks_hmrate.size() );
+		rks_te.resize( rks_hmrate.size() );
+	}
+
+	inline void mole_set_rk(const mole_reaction &rate, double rk)
 	{
-		mole_reaction &rate = *p->second;
+		enum { DEBUG_MOLE = false };
+
 		long index = rate.index;
 		realnum oldrk = (realnum)mole.reaction_rks[index];
-		realnum newrk = rate.a*rate.rk();
+		realnum newrk = (realnum)rk;
 		mole.reaction_rks[index] = newrk;
 		if (DEBUG_MOLE)
 		{
@@ -2861,7 +2885,54 @@ void mole_update_rks(void)
 				fprintf(ioQQQ,"%s: %15.8g => %15.8g\n",
 						  rate.label.c_str(),oldrk,newrk);
 		}
-	}	
+	}
+}
+
+void mole_update_rks(void)
+{
+	DEBUG_ENTRY("mole_update_rks()");
+
+	mole_h2_grain_form();
+	
+	mole_h_reactions();
+
+	if( rks_hmrate.size()+rks_temp.size()+rks_other.size() != 
+		 mole_priv::reactab.size() )
+		mole_rks_classify();
+
+	/* the temperature dependent rates are only evaluated when the
+	 * temperature was not used recently - the non-equilibrium offset
+	 * of noneq_offset also depends on the turbulent velocity, which
+	 * is the second key of the cache */
+	size_t nhm = rks_hmrate.size();
+	bool lgHit;
+	double turb = mole_global.lgNonEquilChem ? DoppVel.TurbVel : 0.;
+	double *rks = rks_cache.find( phycon.te, turb, nhm+rks_temp.size(), lgHit );
+	if( !lgHit )
+	{
+		for( size_t i=0; i < nhm; ++i )
+		{
+			const mole_reaction *rate = rks_hmrate[i];
+			rks_a[i] = rate->a;
+			rks_te[i] = phycon.te+noneq_offset(rate);
+			if( rate->c < 0. )
+				ASSERT( -rate->c/rks_te[i] < 10. );
+		}
+		/* same as hmrate, a*pow(te/300.,b)*exp(-c/te), in one loop over
+		 * all reactions without function calls */
+		for( size_t i=0; i < nhm; ++i )
+			rks[i] = rks_a[i]*exp( rks_hmrate[i]->b*log(rks_te[i]/300.) - 
+										  rks_hmrate[i]->c/rks_te[i] );
+		for( size_t i=0; i < rks_temp.size(); ++i )
+			rks[nhm+i] = rks_temp[i]->a*rks_temp[i]->rk();
+	}
+
+	for( size_t i=0; i < nhm; ++i )
+		mole_set_rk( *rks_hmrate[i], rks[i] );
+	for( size_t i=0; i < rks_temp.size(); ++i )
+		mole_set_rk( *rks_temp[i], rks[nhm+i] );
+	for( size_t i=0; i < rks_other.size(); ++i )
+		mole_set_rk( *rks_other[i], rks_other[i]->a*rks_other[i]->rk() );
 }
 void mole_rk_bigchange(void)
 {
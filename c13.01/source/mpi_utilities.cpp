@@ -5,6 +5,10 @@
 #include "save.h"
 #include "dynamics.h"
 #include "grid.h"
+#if defined(__unix) || defined(__APPLE__)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 #ifndef MPI_ENABLED
 
@@ -49,6 +53,187 @@ void load_balance::init(int nJobs)
 		MPI::COMM_WORLD.Bcast( &p_jobs[0], nJobs, MPI::type(p_jobs[0]), 0 );
 }
 
+#if defined(__unix) || defined(__APPLE__)
+// take (lgLock = true) or release an exclusive lock on the complete file
+STATIC bool lock_file( int fd, bool lgLock )
+{
+	struct flock fl;
+	fl.l_type = lgLock ? F_WRLCK : F_UNLCK;
+	fl.l_whence = SEEK_SET;
+	fl.l_start = 0;
+	fl.l_len = 0;
+	return ( fcntl( fd, lgLock ? F_SETLKW : F_SETLK, &fl ) == 0 );
+}
+#endif
+
+// NB NB this routine cannot throw any exceptions as it is executed outside
+// the try{} block -- this includes mechanisms like ASSERT and cdEXIT!
+void load_balance::init(int nJobs, const string& chPrefix, bool lgContinue)
+{
+	if( nJobs <= 0 )
+		return;
+
+	bool lgMPI = cpu.i().lgMPI();
+
+	p_chState = chPrefix + ".grid_state";
+	p_chNext = chPrefix + ".grid_next";
+
+	// the master rank reads the models that were done in an earlier run and
+	// sets up a random sequence for the remaining jobs, see init() above
+	int buf[2] = { 0, 0 };
+	if( cpu.i().lgMaster() )
+	{
+		vector<bool> lgDone( nJobs, false );
+		if( lgContinue )
+		{
+			FILE *io = fopen( p_chState.c_str(), "r" );
+			if( io != NULL )
+			{
+				int nModels = 0, job, status;
+				if( fscanf( io, "# grid state: %d models", &nModels ) == 1 && nModels == nJobs )
+				{
+					while( fscanf( io, "%d %d", &job, &status ) == 2 )
+					{
+						if( job >= 0 && job < nJobs && !lgDone[job] )
+						{
+							lgDone[job] = true;
+							p_done.push_back( job );
+							p_status = max( p_status, exit_type(status) );
+						}
+					}
+				}
+				else
+				{
+					fprintf( ioQQQ, " PROBLEM load_balance: %s does not belong to this grid,"
+						 " the grid will be started from scratch.\n", p_chState.c_str() );
+				}
+				fclose( io );
+			}
+			fprintf( ioQQQ, " grid continue: %ld of %d models were done in an earlier run.\n",
+				 (long)p_done.size(), nJobs );
+		}
+
+		for( int i=0; i < nJobs; ++i )
+			if( !lgDone[i] )
+				p_jobs.push_back( i );
+
+		if( lgMPI )
+		{
+			srand( unsigned( time(NULL) ) );
+			random_shuffle( p_jobs.begin(), p_jobs.end() );
+		}
+
+		// start a new state file, unless models from an earlier run are kept
+		if( p_done.empty() )
+		{
+			FILE *io = fopen( p_chState.c_str(), "w" );
+			if( io != NULL )
+			{
+				fprintf( io, "# grid state: %d models\n", nJobs );
+				fclose( io );
+			}
+			else
+			{
+				fprintf( ioQQQ, " PROBLEM load_balance: cannot create %s,"
+					 " the grid cannot be continued.\n", p_chState.c_str() );
+				p_chState.clear();
+			}
+		}
+
+#		if defined(__unix) || defined(__APPLE__)
+		// the shared counter holds the position of the next job in p_jobs
+		if( lgMPI )
+		{
+			int fd = open( p_chNext.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644 );
+			if( fd >= 0 )
+			{
+				int n = 0;
+				p_lgDynamic = ( write( fd, &n, sizeof(n) ) == sizeof(n) );
+				close( fd );
+			}
+		}
+#		endif
+
+		buf[0] = int( p_jobs.size() );
+		buf[1] = int( p_lgDynamic );
+	}
+
+	// now broadcast the job sequence to the other ranks...
+	if( lgMPI )
+	{
+		MPI::COMM_WORLD.Bcast( buf, 2, MPI::type(buf[0]), 0 );
+		p_jobs.resize( buf[0] );
+		p_lgDynamic = ( buf[1] != 0 );
+		if( buf[0] > 0 )
+			MPI::COMM_WORLD.Bcast( &p_jobs[0], buf[0], MPI::type(p_jobs[0]), 0 );
+		p_ptr = MPI::COMM_WORLD.Get_rank();
+		// only the master knows whether the state file could be created
+		int lgState = int( !p_chState.empty() );
+		MPI::COMM_WORLD.Bcast( &lgState, 1, MPI::type(lgState), 0 );
+		if( lgState == 0 )
+			p_chState.clear();
+	}
+	else
+		p_ptr = 0;
+}
+
+// claim the next job from the shared counter, returns -1 if there are no jobs left
+int load_balance::p_claim()
+{
+	int res = -1;
+#	if defined(__unix) || defined(__APPLE__)
+	int fd = open( p_chNext.c_str(), O_RDWR );
+	if( fd >= 0 && lock_file( fd, true ) )
+	{
+		int n;
+		if( pread( fd, &n, sizeof(n), 0 ) == sizeof(n) && n >= 0 && n < int(p_jobs.size()) )
+		{
+			res = p_jobs[n++];
+			if( pwrite( fd, &n, sizeof(n), 0 ) != sizeof(n) )
+				res = -1;
+		}
+		lock_file( fd, false );
+	}
+	else
+	{
+		fprintf( ioQQQ, " PROBLEM load_balance: cannot claim a job from %s,"
+			 " this rank stops.\n", p_chNext.c_str() );
+	}
+	if( fd >= 0 )
+		close( fd );
+#	endif
+	return res;
+}
+
+void load_balance::job_done(int job, exit_type status)
+{
+	if( p_chState.empty() )
+		return;
+
+	char line[64];
+	sprintf( line, "%d %d\n", job, int(status) );
+#	if defined(__unix) || defined(__APPLE__)
+	int fd = open( p_chState.c_str(), O_WRONLY | O_APPEND );
+	bool lgOK = ( fd >= 0 && lock_file( fd, true ) );
+	if( lgOK )
+	{
+		size_t len = strlen( line );
+		lgOK = ( write( fd, line, len ) == ssize_t(len) && fsync( fd ) == 0 );
+		lock_file( fd, false );
+	}
+	if( fd >= 0 )
+		close( fd );
+#	else
+	FILE *io = fopen( p_chState.c_str(), "a" );
+	bool lgOK = ( io != NULL && fputs( line, io ) >= 0 );
+	if( io != NULL )
+		fclose( io );
+#	endif
+	if( !lgOK )
+		fprintf( ioQQQ, " PROBLEM load_balance: cannot record model %d in %s.\n",
+			 job, p_chState.c_str() );
+}
+
 STATIC void check_grid_file( const string& fnam, int j, int ipPun );
 
 /** process_output: concatenate output files produced in MPI grid run */
@@ -73,6 +258,8 @@ void process_output()
 			string out_name = Base + ".out";
 			append_file( main_output_handle, out_name.c_str() );
 			remove( out_name.c_str() );
+			string spc_name = Base + ".spc";
+			remove( spc_name.c_str() );
 		}
 		fclose( main_output_handle );
 
@@ -147,6 +334,12 @@ void process_output()
 				++ipPun;
 			}
 		}
+
+		// the grid is complete, it no longer needs to be continued
+		string state_name = save.chRedirectPrefix + ".grid_state";
+		remove( state_name.c_str() );
+		string next_name = save.chRedirectPrefix + ".grid_next";
+		remove( next_name.c_str() );
 	}
 	catch( ... )
 	{
@@ -94,17 +94,39 @@ namespace MPI
 
 #endif /* MPI_ENABLED */
 
+/** load_balance: hand out the models of a grid run to the ranks
+ *
+ * The ranks claim the next model from a shared counter file (prefix.grid_next)
+ * as soon as they finished the previous one, so that slow models do not leave
+ * other ranks idle. On systems without POSIX file locks the jobs are handed out
+ * in a fixed order instead.
+ *
+ * Each finished model is recorded in the state file prefix.grid_state. If the
+ * grid is started with the "grid continue" command, the models recorded there
+ * are not computed again. The state is removed by process_output() once the
+ * output of the complete grid has been assembled. */
 class load_balance
 {
 	vector<int> p_jobs;
 	unsigned int p_ptr;
+	bool p_lgDynamic;
+	string p_chState;
+	string p_chNext;
+	/** models done in an earlier run, only known to the master rank */
+	vector<int> p_done;
+	/** worst exit status of the models done in an earlier run */
+	exit_type p_status;
+	int p_claim();
 	void p_clear0()
 	{
 		p_jobs.clear();
+		p_done.clear();
 	}
 	void p_clear1()
 	{
 		p_ptr = 0;
+		p_lgDynamic = false;
+		p_status = ES_SUCCESS;
 	}
 public:
 	load_balance()
@@ -116,6 +138,11 @@ public:
 		p_clear1();
 		init( nJobs );
 	}
+	load_balance( int nJobs, const string& chPrefix, bool lgContinue )
+	{
+		p_clear1();
+		init( nJobs, chPrefix, lgContinue );
+	}
 	~load_balance()
 	{
 		p_clear0();
@@ -126,9 +153,12 @@ public:
 		p_clear1();
 	}
 	void init( int nJobs );
+	void init( int nJobs, const string& chPrefix, bool lgContinue );
 	int next_job()
 	{
-		if( p_ptr < p_jobs.size() )
+		if( p_lgDynamic )
+			return p_claim();
+		else if( p_ptr < p_jobs.size() )
 		{
 			int res = p_jobs[p_ptr];
 			if( cpu.i().lgMPI() )
@@ -140,6 +170,16 @@ public:
 		else
 			return -1;
 	}
+	/** record in the state file that model job has finished */
+	void job_done( int job, exit_type status );
+	const vector<int>& jobs_done_before() const
+	{
+		return p_done;
+	}
+	exit_type status_done_before() const
+	{
+		return p_status;
+	}
 	void finalize()
 	{
 		// wait for all jobs to finish
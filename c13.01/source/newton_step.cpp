@@ -158,7 +158,10 @@ bool newton_step(GroupMap &MoleMap, const valarray<double> &b0vec, valarray<doub
 				ervals0[i] = ervals1[i];
 				b1vec[i] = ervals1[i];
 			}
-			merror = solve_system(amat,b1vec,n,mole_system_error);
+			if( mole_global.lgSparseSolve )
+				merror = solve_system_sparse(amat,b1vec,n,mole_system_error);
+			else
+				merror = solve_system(amat,b1vec,n,mole_system_error);
 			
 			if (merror != 0) {
 			  *eqerror = *error = 1e30f;
@@ -464,3 +467,237 @@ int32 solve_system(const valarray<double> &a, valarray<double> &b,
 
 	return merror;
 }
+
+namespace {
+
+/* LU factorization P*A = L*U of a sparse matrix with a fixed pivot
+ * sequence.  The pivot rows are found once with a dense factorization
+ * with partial pivoting, then the fill of L+U is found symbolically
+ * and stored row by row.  Following matrices with the same (or a 
+ * smaller) pattern are factored numerically on this structure only.
+ * The matrices are in column-major order as for getrf_wrapper */
+class t_sparse_lu
+{
+	long n;
+	/* row of A which is row i of P*A */
+	vector<long> perm;
+	/* pattern of A, union of all analysed matrices */
+	vector<bool> lgNonZero;
+	/* rows of L+U: columns col[rowbeg[i]..rowbeg[i+1]-1] in increasing
+	 * order, the diagonal is at diag[i] */
+	vector<long> rowbeg, col, diag;
+	vector<double> val;
+	valarray<double> work;
+	bool lgValid;
+public:
+	t_sparse_lu() : n(0), lgValid(false) {}
+	bool lgMatch(const valarray<double> &a, long nn) const;
+	bool analyse(const valarray<double> &a, long nn);
+	bool factor(const valarray<double> &a);
+	void solve(valarray<double> &b);
+};
+
+/* are all nonzero elements of a in the analysed pattern? */
+bool t_sparse_lu::lgMatch(const valarray<double> &a, long nn) const
+{
+	if( !lgValid || nn != n )
+		return false;
+	for( long k=0; k < n*n; ++k )
+	{
+		if( a[k] != 0. && !lgNonZero[k] )
+			return false;
+	}
+	return true;
+}
+
+/* pivot sequence and symbolic factorization */
+bool t_sparse_lu::analyse(const valarray<double> &a, long nn)
+{
+	DEBUG_ENTRY( "t_sparse_lu::analyse()" );
+
+	if( nn != n )
+	{
+		n = nn;
+		lgNonZero.assign(n*n, false);
+		work.resize(n);
+	}
+	lgValid = false;
+
+	for( long k=0; k < n*n; ++k )
+	{
+		if( a[k] != 0. )
+			lgNonZero[k] = true;
+	}
+	for( long i=0; i < n; ++i )
+		lgNonZero[i+i*n] = true;
+
+	/* pivot rows of the dense factorization */
+	valarray<double> lufac(a);
+	valarray<int32> ipiv(n);
+	int32 merror = 0;
+	getrf_wrapper(n,n,get_ptr(lufac),n,get_ptr(ipiv),&merror);
+	if( merror != 0 )
+		return false;
+
+	perm.resize(n);
+	for( long i=0; i < n; ++i )
+		perm[i] = i;
+	for( long i=0; i < n; ++i )
+		swap( perm[i], perm[ipiv[i]-1] );
+
+	/* fill: row i of L+U gets the U part of every row k < i 
+	 * which has an element in column k */
+	vector<char> mark(n);
+	rowbeg.assign(1, 0);
+	col.clear();
+	diag.resize(n);
+	for( long i=0; i < n; ++i )
+	{
+		for( long j=0; j < n; ++j )
+			mark[j] = lgNonZero[perm[i]+j*n];
+		/* the pivot is in the structure even if it is zero in A */
+		mark[i] = 1;
+		for( long k=0; k < i; ++k )
+		{
+			if( !mark[k] )
+				continue;
+			for( long p=diag[k]+1; p < rowbeg[k+1]; ++p )
+				mark[col[p]] = 1;
+		}
+		for( long j=0; j < n; ++j )
+		{
+			if( !mark[j] )
+				continue;
+			if( j == i )
+				diag[i] = (long)col.size();
+			col.push_back(j);
+		}
+		rowbeg.push_back( (long)col.size() );
+	}
+	val.resize(col.size());
+
+	lgValid = true;
+	return true;
+}
+
+/* numerical factorization on the analysed structure, false if a 
+ * pivot became too small for the fixed pivot sequence */
+bool t_sparse_lu::factor(const valarray<double> &a)
+{
+	DEBUG_ENTRY( "t_sparse_lu::factor()" );
+
+	for( long i=0; i < n; ++i )
+	{
+		double rowmax = 0.;
+		for( long p=rowbeg[i]; p < rowbeg[i+1]; ++p )
+		{
+			work[col[p]] = a[perm[i]+col[p]*n];
+			rowmax = MAX2( rowmax, fabs(work[col[p]]) );
+		}
+		for( long p=rowbeg[i]; p < diag[i]; ++p )
+		{
+			long k = col[p];
+			if( work[k] == 0. )
+				continue;
+			double l = work[k]/val[diag[k]];
+			work[k] = l;
+			for( long q=diag[k]+1; q < rowbeg[k+1]; ++q )
+				work[col[q]] -= l*val[q];
+		}
+		for( long p=rowbeg[i]; p < rowbeg[i+1]; ++p )
+			val[p] = work[col[p]];
+
+		if( fabs(val[diag[i]]) <= 1e3*DBL_EPSILON*rowmax || val[diag[i]] == 0. )
+			return false;
+	}
+	return true;
+}
+
+/* solve L*U*x = P*b, b is overwritten with x */
+void t_sparse_lu::solve(valarray<double> &b)
+{
+	for( long i=0; i < n; ++i )
+		work[i] = b[perm[i]];
+	for( long i=0; i < n; ++i )
+	{
+		for( long p=rowbeg[i]; p < diag[i]; ++p )
+			work[i] -= val[p]*work[col[p]];
+	}
+	for( long i=n-1; i >= 0; --i )
+	{
+		for( long p=diag[i]+1; p < rowbeg[i+1]; ++p )
+			work[i] -= val[p]*work[col[p]];
+		work[i] /= val[diag[i]];
+	}
+	for( long i=0; i < n; ++i )
+		b[i] = work[i];
+}
+
+t_sparse_lu mole_lu;
+
+}
+
+int32 solve_system_sparse(const valarray<double> &a, valarray<double> &b, 
+									 long int n, error_print_t error_print)
+{
+	const int nrefine=3;
+	valarray<double> x(n), err(n), scale(n);
+
+	ASSERT(a.size() == size_t(n*n));
+	ASSERT(b.size() == size_t(n));
+
+	DEBUG_ENTRY("solve_system_sparse()");
+
+	/* a new element in the pattern or a bad pivot needs a new 
+	 * pivot sequence, the dense solver reports singular matrices */
+	bool lgNew = !mole_lu.lgMatch(a,n) || !mole_lu.factor(a);
+	for( int pass=0; pass < 2; ++pass )
+	{
+		if( lgNew && (!mole_lu.analyse(a,n) || !mole_lu.factor(a)) )
+			break;
+
+		x = b;
+		mole_lu.solve(x);
+		for( int k=0; k <= nrefine; ++k )
+		{
+			for( long i=0; i < n; ++i )
+			{
+				err[i] = b[i];
+				scale[i] = fabs(b[i]);
+			}
+			for( long j=0; j < n; ++j )
+			{
+				if( x[j] == 0. )
+					continue;
+				for( long i=0; i < n; ++i )
+				{
+					err[i] -= a[i+j*n]*x[j];
+					scale[i] += fabs(a[i+j*n]*x[j]);
+				}
+			}
+			if( k == nrefine )
+				break;
+			mole_lu.solve(err);
+			x += err;
+		}
+
+		/* the old pivot sequence may not be stable for this matrix,
+		 * accept the solution only for a small backward error */
+		double berr = 0.;
+		for( long i=0; i < n; ++i )
+		{
+			if( scale[i] > 0. )
+				berr = MAX2( berr, fabs(err[i])/scale[i] );
+		}
+		if( berr < 1e-10 )
+		{
+			b = x;
+			return 0;
+		}
+		if( lgNew )
+			break;
+		lgNew = true;
+	}
+
+	return solve_system(a,b,n,error_print);
+}
@@ -27,4 +27,10 @@ typedef void (*error_print_t)(long, long,
 int32 solve_system(const valarray<double> &a, valarray<double> &b, 
 									 long int n, error_print_t error_print);
 
+/** solve_system_sparse same as solve_system, but with a sparse LU 
+ * factorization, whose pivot sequence and fill pattern are kept
+ * for the following calls while the pattern of a does not grow */
+int32 solve_system_sparse(const valarray<double> &a, valarray<double> &b, 
+									 long int n, error_print_t error_print);
+
 #endif /* NEWTON_STEP_H_ */
@@ -14,6 +14,7 @@
 #include "parse.h"
 #include "input.h"
 #include "parser.h"
+#include "data_image.h"
 
 void ParseCompile(Parser &p)
 {
@@ -495,9 +496,16 @@ void ParseCompile(Parser &p)
 
 		cdEXIT( lgProblems ? ES_FAILURE : ES_SUCCESS );
 	}
+	else if( p.nMatch("ATOM") && p.nMatch("DATA") )
+	{
+		/* COMPILE ATOMIC DATA - unlike the other compile commands the
+		 * calculation is done, all data files it reads are then written
+		 * into the data image, which is used by later runs */
+		DataImageCompile();
+	}
 	else
 	{
-		fprintf( ioQQQ, " One of the keywords, GRAINS, RECO COEF, GAUNT, or STARS, must appear.\n" );
+		fprintf( ioQQQ, " One of the keywords, GRAINS, RECO COEF, GAUNT, STARS, or ATOMIC DATA, must appear.\n" );
 		fprintf( ioQQQ, " Sorry.\n" );
 		cdEXIT(EXIT_FAILURE);
 	}
@@ -35,7 +35,7 @@ void ParseDLaw(Parser &p)
 	{
 		/* when called, read in densities from input stream */
 		strcpy( dense.chDenseLaw, "DLW2" );
-		ParseTabulated( p, &dense.lgTabDepth, &dense.lgTabLinear, dense.tabrad, dense.tabval, &dense.nvals );
+		ParseTabulated( p, TAB_DLAW, &dense.lgTabDepth, &dense.lgTabLinear, dense.tabrad, dense.tabval, &dense.nvals );
 	}
 	else if( p.nMatch("WIND") )
 	{
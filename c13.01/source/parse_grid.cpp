@@ -13,6 +13,14 @@ void ParseGrid(
 {
 	DEBUG_ENTRY( "ParseGrid()" );
 
+	if( p.nMatch("CONT") )
+	{
+		/* continue a grid that was interrupted, the models that were
+		 * finished are taken from the state file, see load_balance */
+		grid.lgGridCont = true;
+		return;
+	}
+
 	/* RP fake optimizer to run a grid of calculations, also accepts
 	 * keyword XSPEC */
 	strcpy( optimize.chOptRtn, "XSPE" );
@@ -8,6 +8,18 @@
 #include "input.h"
 #include "parser.h"
 
+/* continuum passed with InterpSetExternal, kept for all following models */
+static vector<double> ExtNu, ExtFlux;
+
+void InterpSetExternal( const double nu[], const double flux[], long int n )
+{
+	DEBUG_ENTRY( "InterpSetExternal()" );
+
+	ExtNu.assign( nu, nu+n );
+	ExtFlux.assign( flux, flux+n );
+	return;
+}
+
 void ParseInterp(Parser &p)
 {
 	DEBUG_ENTRY( "ParseInterp()" );
@@ -46,6 +58,26 @@ void ParseInterp(Parser &p)
 
 	/* this flag says we hit end of command stream */
 	p.m_lgEOF = false;
+
+	/* interpolate external - the pairs were passed with InterpSetExternal 
+	 * and do not pass the text parser, there are no continue lines */
+	if( p.nMatch("EXTE") )
+	{
+		if( ExtNu.size() < 2 || ExtNu.size() >= (size_t)NCELL )
+		{
+			fprintf( ioQQQ, " The continuum passed with cdSetIncidentSED must have at least 2"
+				" and less than %i pairs.\nSorry.\n", NCELL );
+			cdEXIT(EXIT_FAILURE);
+		}
+		npairs = (long)ExtNu.size();
+		for( long i=0; i < npairs; i++ )
+		{
+			rfield.tNu[rfield.nShape][i].set( ExtNu[i] );
+			rfield.tFluxLog[rfield.nShape][i] = (realnum)ExtFlux[i];
+		}
+		p.m_lgEOF = true;
+	}
+
 	while( !lgDONE && !p.m_lgEOF )
 	{
 		/* keep scanning numbers until we hit eol for current line image */
@@ -349,6 +349,27 @@ void ParseSet(Parser &p)
 			}
 		}
 
+		/* linear solver of the Newton step, set chemistry solver sparse/dense,
+		 * the sparse solver reuses the symbolic factorization of the 
+		 * chemistry Jacobian across zones */
+		else if (p.nMatch("SOLV"))
+		{
+			if (p.nMatch("SPAR"))
+			{
+				mole_global.lgSparseSolve = true;
+			}
+			else if (p.nMatch("DENS"))
+			{
+				mole_global.lgSparseSolve = false;
+			}
+			else
+			{
+				fprintf(ioQQQ,
+						" SET CHEMISTRY SOLVER needs the keyword SPARSE or DENSE.\n");
+				cdEXIT(EXIT_FAILURE);
+			}
+		}
+
 		else
 		{
 			/* should not have happened ... */
@@ -35,6 +35,16 @@ void ParseState(Parser &p)
 #		endif
 		state.lgGet_state = true;
 		strcpy( state.chGetFilename , chFilename );
+		/* look for keyword WARM - start the first iteration from the
+		 * recovered structure rather than from a new temperature search */
+		if( p.nMatch("WARM") )
+		{
+			state.lgWarmStart = true;
+		}
+		else
+		{
+			state.lgWarmStart = false;
+		}
 	}
 	else if( p.nMatch(" PUT") )
 	{
@@ -53,6 +63,13 @@ void ParseState(Parser &p)
 		{
 			state.lgPutAll = false;
 		}
+		/* look for keyword TAG - up to STATE_NTAG numbers which are
+		 * written in front of the state to identify the model */
+		if( p.GetParam(" TAG", &state.tag[0]) )
+		{
+			for( long i=1; i < STATE_NTAG; ++i )
+				state.tag[i] = p.FFmtRead();
+		}
 	}
 
 	else
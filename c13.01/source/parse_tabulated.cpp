@@ -4,18 +4,37 @@
       tabulated density, temperature and velocity
     - introduced the linear keyword for linear interpolation
     - added sanity checks to prevent calculations if invalid
-      tables ranges are provided by the user */
+      tables ranges are provided by the user
+    - EXTERNAL keyword takes the values that were passed with
+      cdSetDensityTable, cdSetTemperatureTable or cdSetWindTable
+      instead of reading them from the input stream */
 
 #include "cddefines.h"
 #include "radius.h"
 #include "parser.h"
 #include "dense.h"
 
-void ParseTabulated(Parser &p, bool* lgDepth, bool* lgLinear, realnum* tbrad, realnum* tbval,long int* numvals )
+/* tables passed with TabulatedSetExternal, used once by ParseTabulated */
+static vector<double> ExtRad[TAB_NTYPES], ExtVal[TAB_NTYPES];
+
+void TabulatedSetExternal( int nTab, const double depth[], const double val[], long int n )
+{
+	DEBUG_ENTRY( "TabulatedSetExternal()" );
+
+	ASSERT( nTab >= 0 && nTab < TAB_NTYPES );
+
+	ExtRad[nTab].assign( depth, depth+n );
+	ExtVal[nTab].assign( val, val+n );
+	return;
+}
+
+void ParseTabulated(Parser &p, int nTab, bool* lgDepth, bool* lgLinear, realnum* tbrad, realnum* tbval,long int* numvals )
 {
 	bool lgEnd;
 
 	DEBUG_ENTRY( "ParseTabulated()" );
+
+	ASSERT( nTab >= 0 && nTab < TAB_NTYPES );
 	
 	if( p.nMatch("DEPT") )
 	{
@@ -36,13 +55,64 @@ void ParseTabulated(Parser &p, bool* lgDepth, bool* lgLinear, realnum* tbrad, re
 		*lgLinear = false;
 	}
 
-	p.getline();
-	tbrad[0] = (realnum)p.FFmtRead();
-	tbval[0] = (realnum)p.FFmtRead();
-	if( p.lgEOL() )
+	if( p.nMatch("EXTE") )
 	{
-		fprintf( ioQQQ, " No pairs entered - can\'t interpolate.\n Sorry.\n" );
-		cdEXIT(EXIT_FAILURE);
+		/* the table was passed directly through the driver interface */
+		if( ExtRad[nTab].empty() )
+		{
+			fprintf( ioQQQ, " No pairs entered - can\'t interpolate.\n Sorry.\n" );
+			cdEXIT(EXIT_FAILURE);
+		}
+		if( ExtRad[nTab].size() >= (size_t)LIMTABDLAW )
+		{
+			fprintf( ioQQQ, " Too many pairs entered, the limit is %i.\n Sorry.\n", LIMTABDLAW-1 );
+			cdEXIT(EXIT_FAILURE);
+		}
+		*numvals = (long)ExtRad[nTab].size();
+		for( long i=0; i < *numvals; i++ )
+		{
+			tbrad[i] = (realnum)ExtRad[nTab][i];
+			tbval[i] = (realnum)ExtVal[nTab][i];
+		}
+		/* a table is only used for one model */
+		ExtRad[nTab].clear();
+		ExtVal[nTab].clear();
+	}
+	else
+	{
+		p.getline();
+		tbrad[0] = (realnum)p.FFmtRead();
+		tbval[0] = (realnum)p.FFmtRead();
+		if( p.lgEOL() )
+		{
+			fprintf( ioQQQ, " No pairs entered - can\'t interpolate.\n Sorry.\n" );
+			cdEXIT(EXIT_FAILURE);
+		}
+
+		*numvals = 2;
+		lgEnd = false;
+
+		/* read pairs of numbers until we find line starting with END */
+		/* >>chng 04 jan 27, loop to LIMTABDLAW from LIMTABD, as per
+		 * var definitions, caught by Will Henney */
+		while( !lgEnd && *numvals < LIMTABDLAW )
+		{
+			p.getline();
+			lgEnd = p.m_lgEOF;
+			if( !lgEnd )
+			{
+				if( p.strcmp("END") == 0 )
+					lgEnd = true;
+			}
+
+			if( !lgEnd )
+			{
+				tbrad[*numvals-1] = (realnum)p.FFmtRead();
+				tbval[*numvals-1] = (realnum)p.FFmtRead();
+				*numvals += 1;
+			}
+		}
+		*numvals -= 1;
 	}
 
 	/* sanity check for first point in dlaw table */
@@ -98,31 +168,6 @@ void ParseTabulated(Parser &p, bool* lgDepth, bool* lgLinear, realnum* tbrad, re
 		}
 	}
 
-	*numvals = 2;
-	lgEnd = false;
-
-	/* read pairs of numbers until we find line starting with END */
-	/* >>chng 04 jan 27, loop to LIMTABDLAW from LIMTABD, as per
-	 * var definitions, caught by Will Henney */
-	while( !lgEnd && *numvals < LIMTABDLAW )
-	{
-		p.getline();
-		lgEnd = p.m_lgEOF;
-		if( !lgEnd )
-		{
-			if( p.strcmp("END") == 0 )
-				lgEnd = true;
-		}
-
-		if( !lgEnd )
-		{
-			tbrad[*numvals-1] = (realnum)p.FFmtRead();
-			tbval[*numvals-1] = (realnum)p.FFmtRead();
-			*numvals += 1;
-		}
-	}
-	*numvals -= 1;
-
 	for( long i=1; i < *numvals; i++ )
 	{
 		/* the radius values are assumed to be strictly increasing */
@@ -52,7 +52,7 @@ void ParseTLaw( Parser &p )
 		thermal.lgTabulated = true;
 
 		/* parse the tabulated values  */
-		ParseTabulated( p, &thermal.lgTabDepth, &thermal.lgTabLinear, thermal.tabrad, thermal.tabval, &thermal.nvals );
+		ParseTabulated( p, TAB_TLAW, &thermal.lgTabDepth, &thermal.lgTabLinear, thermal.tabrad, thermal.tabval, &thermal.nvals );
 
 		TempChange(thermal.tabval[0] , false);
 	}
@@ -4,7 +4,9 @@
 /* CHANGES: (M. Salz 17.05.2013)
  *  - introduce the function
  *    ParseTabulated() to parse tabulated values of
- *    temperature, density or velocity vs depth/radius */
+ *    temperature, density or velocity vs depth/radius
+ *  - TabulatedSetExternal() for tables passed through the
+ *    driver interface */
 
 #ifndef PARSER_H_
 #define PARSER_H_
@@ -367,15 +369,29 @@ void ParseConstant(Parser &p);
 */
 void ParseDLaw(Parser &p );
 
+/** tables of density, temperature and velocity that can be passed with 
+ * cdSetDensityTable, cdSetTemperatureTable and cdSetWindTable */
+enum { TAB_DLAW, TAB_TLAW, TAB_WIND, TAB_NTYPES };
+
+/**TabulatedSetExternal store a table that is used by ParseTabulated 
+ * when the EXTERNAL keyword appears on the table command
+\param nTab      one of TAB_DLAW, TAB_TLAW, TAB_WIND
+\param depth[]   radius or depth
+\param val[]     the tabulated values
+\param n         number of pairs
+*/
+void TabulatedSetExternal( int nTab, const double depth[], const double val[], long int n );
+
 /**ParseTabulated parses tabulated values of density, temperature or velocity
 \param *chCard
+\param nTab  one of TAB_DLAW, TAB_TLAW, TAB_WIND
 \param *lgDepth
 \param *lgLinear
 \param *tbrad
 \param *tbval
 \param *numvals
 */
-void ParseTabulated(Parser &p, bool* lgDepth, bool* lgLinear, realnum* tbrad, realnum* tbval,long int* numvals );
+void ParseTabulated(Parser &p, int nTab, bool* lgDepth, bool* lgLinear, realnum* tbrad, realnum* tbval,long int* numvals );
 
 /**ParseTLaw parse parameters on the tlaw command to set some temperature vs depth 
 \param *chCard
@@ -424,6 +440,14 @@ void ParseInit(Parser &p);
 */
 void ParseInterp(Parser &p);
 
+/**InterpSetExternal store a continuum that is used by ParseInterp when the
+ * EXTERNAL keyword appears on the interpolate command, kept for all models
+\param nu[]    energies, in the same units as on the interpolate command
+\param flux[]  log of the flux per unit frequency
+\param n       number of pairs
+*/
+void InterpSetExternal( const double nu[], const double flux[], long int n );
+
 /**ParseIonParI parse the ionization parameter command (IONI variant)
 \param *nqh
 \param *chCard
@@ -41,6 +41,7 @@
 #include "mean.h"
 #include "wind.h"
 #include "prt.h"
+#include "rate_cache.h"
 
 // helper routine to center a line in the output
 void PrintCenterLine(FILE* io,              // file pointer
@@ -1685,6 +1686,11 @@ void PrtFinal(void)
 	  iso_sp[ipH_LIKE][ipHELIUM].numLevels_local , 
 	  alfox );
 
+	/* hit rates of the rate coefficient caches, not printed with 
+	 * the no times command since these may differ between runs */
+	if( prt.lgPrintTime )
+		RateCachePrint( ioQQQ );
+
 	/* now give an indication of the convergence error budget */
 	fprintf( ioQQQ, 
 		" ConvrgError(%%)  <eden>%7.3f  MaxEden%7.3f  <H-C>%7.2f  Max(H-C)%8.2f  <Press>%8.3f  MaxPrs er%7.3f\n", 
@@ -59,6 +59,7 @@ void radius_increment(void)
 
 	struc.heatstr[nzone_minus_1] = thermal.htot;
 	struc.coolstr[nzone_minus_1] = thermal.ctot;
+	struc.dCmHdTstr[nzone_minus_1] = thermal.dCooldT - thermal.dHeatdT;
 	struc.testr[nzone_minus_1] = (realnum)phycon.te;
 
 	/* number of particles per unit vol */
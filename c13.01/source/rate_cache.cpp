@@ -0,0 +1,92 @@
+/* This file is part of Cloudy and is copyright (C)1978-2013 by Gary J. Ferland and
+ * others.  For conditions of distribution and use see copyright notice in license.txt */
+/*RateCacheZero invalidate all rate caches at the start of a calculation */
+/*RateCachePrint print the hit rates of all rate caches */
+#include "cddefines.h"
+#include "rate_cache.h"
+
+namespace
+{
+	/* all caches, as a function so that caches which are static objects
+	 * in other files can register themselves during initialization */
+	vector<t_rate_cache*> &RateCacheList()
+	{
+		static vector<t_rate_cache*> list;
+		return list;
+	}
+}
+
+t_rate_cache::t_rate_cache(const char *label) : chLabel(label), nval(0)
+{
+	zero();
+	RateCacheList().push_back(this);
+}
+
+t_rate_cache::~t_rate_cache()
+{
+	vector<t_rate_cache*> &list = RateCacheList();
+	list.erase( remove( list.begin(), list.end(), this ), list.end() );
+}
+
+double *t_rate_cache::find( double te, double eden, size_t n, bool &lgHit )
+{
+	DEBUG_ENTRY( "t_rate_cache::find()" );
+
+	if( n != nval )
+	{
+		nval = n;
+		val.resize( NSLOT*nval );
+		nUsed = 0;
+		iNext = 0;
+	}
+
+	for( int i=0; i < nUsed; ++i )
+	{
+		if( fp_equal( te, teKey[i] ) && fp_equal( eden, edenKey[i] ) )
+		{
+			++nHit;
+			lgHit = true;
+			return get_ptr(val) + i*nval;
+		}
+	}
+
+	/* not found, the caller fills the oldest entry */
+	++nMiss;
+	lgHit = false;
+	int i = iNext;
+	iNext = (iNext+1)%NSLOT;
+	if( nUsed < NSLOT )
+		++nUsed;
+	teKey[i] = te;
+	edenKey[i] = eden;
+	return get_ptr(val) + i*nval;
+}
+
+void t_rate_cache::zero()
+{
+	nUsed = 0;
+	iNext = 0;
+	nHit = 0;
+	nMiss = 0;
+}
+
+void t_rate_cache::print( FILE *io ) const
+{
+	long ntot = nHit + nMiss;
+	fprintf( io, " rate cache %-12s lookups:%9ld  hits:%9ld (%5.1f%%)\n",
+		chLabel, ntot, nHit, ntot > 0 ? 100.*nHit/ntot : 0. );
+}
+
+void RateCacheZero()
+{
+	vector<t_rate_cache*> &list = RateCacheList();
+	for( size_t i=0; i < list.size(); ++i )
+		list[i]->zero();
+}
+
+void RateCachePrint( FILE *io )
+{
+	vector<t_rate_cache*> &list = RateCacheList();
+	for( size_t i=0; i < list.size(); ++i )
+		list[i]->print( io );
+}
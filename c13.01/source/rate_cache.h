@@ -0,0 +1,63 @@
+/* This file is part of Cloudy and is copyright (C)1978-2013 by Gary J. Ferland and
+ * others.  For conditions of distribution and use see copyright notice in license.txt */
+
+#ifndef RATE_CACHE_H_
+#define RATE_CACHE_H_
+
+/**\file rate_cache.h
+ * cache of rate coefficients that only depend on the temperature and the
+ * electron density.  The temperature solver moves between a few values
+ * within a zone (the current temperature and the one used for the
+ * numerical derivative), so a few entries are kept and the oldest is
+ * replaced */
+class t_rate_cache
+{
+	/** number of cached (te,eden) pairs */
+	enum { NSLOT = 4 };
+
+	/** name used in the report */
+	const char *chLabel;
+
+	/** number of rates in each entry */
+	size_t nval;
+
+	/** number of valid entries, and the one which is replaced next */
+	int nUsed, iNext;
+
+	double teKey[NSLOT], edenKey[NSLOT];
+	vector<double> val;
+
+	t_rate_cache(const t_rate_cache&);
+	t_rate_cache& operator=(const t_rate_cache&);
+public:
+	/** number of lookups which found or did not find the entry */
+	long nHit, nMiss;
+
+	explicit t_rate_cache(const char *label);
+	~t_rate_cache();
+
+	/** find the rates for te and eden, lgHit is false if they are not
+	 * in the cache, then the returned entry must be filled by the caller
+	 * \param te temperature
+	 * \param eden electron density, or any other second input the rates
+	 * depend on (e.g. the turbulent velocity), 0 for rates which only depend on te
+	 * \param n number of rates in the entry
+	 * \param lgHit set true if the rates were found
+	 */
+	double *find( double te, double eden, size_t n, bool &lgHit );
+
+	/** invalidate all entries, and reset the counters */
+	void zero();
+
+	/** print the hit rate */
+	void print( FILE *io ) const;
+};
+
+/** invalidate all rate caches, called at the start of every calculation
+ * since the rates also depend on the parameters of the model */
+void RateCacheZero();
+
+/** print the hit rates of all rate caches */
+void RateCachePrint( FILE *io );
+
+#endif /* RATE_CACHE_H_ */
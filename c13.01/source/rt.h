@@ -95,6 +95,14 @@ void RT_line_one_tau_reset(
 /**RT_tau_reset update total optical depth scale, called after iteration is complete */
 void RT_tau_reset(void);
 
+/**RT_tau_reset_geo update the geometric continuum optical depths for the next iteration,
+ * the arrays have the layout of opac.TauAbsGeo
+ \param TauAbsGeo
+ \param TauScatGeo
+ \param TauTotalGeo
+ */
+void RT_tau_reset_geo( realnum **TauAbsGeo, realnum **TauScatGeo, realnum **TauTotalGeo );
+
 /**RT_tau_inc increment optical depths once per zone, called after radius_increment */
 void RT_tau_inc(void);
 
@@ -252,6 +252,37 @@ void RT_tau_reset(void)
 	/* large FeII atom */
 	FeII_RT_tau_reset();
 
+	/* geometric continuum optical depths of the next iteration */
+	RT_tau_reset_geo( opac.TauAbsGeo, opac.TauScatGeo, opac.TauTotalGeo );
+
+	/* same for open and closed geometries */
+	for( i=0; i < rfield.nupper; i++ )
+	{
+		/* total optical depth across computed shell */
+		opac.TauAbsTotal[i] = opac.TauAbsFace[i];
+		/* e2( tau across shell), optical depth from ill face to shielded face of cloud 
+		 * not that opac.TauAbsFace is reset to small number just after this */
+		opac.E2TauAbsTotal[i] = (realnum)e2( opac.TauAbsTotal[i] );
+		/* TauAbsFace and TauScatFace are abs and sct optical depth to ill face */
+		opac.TauScatFace[i] = opac.taumin;
+		opac.TauAbsFace[i] = opac.taumin;
+	}
+
+	/* this is optical depth at x-ray point defining effective optical depth */
+	rt.tauxry = opac.TauAbsGeo[0][rt.ipxry-1];
+	return;
+}
+
+/* ====================================================================== */
+/*RT_tau_reset_geo update the geometric continuum optical depths for the next
+ * iteration from the optical depths to the illuminated face, also called by
+ * state_get_put on copies of the opac arrays */
+void RT_tau_reset_geo( realnum **TauAbsGeo, realnum **TauScatGeo, realnum **TauTotalGeo )
+{
+	long int i;
+
+	DEBUG_ENTRY( "RT_tau_reset_geo()" );
+
 	if( opac.lgCaseB )
 	{
 		for( i=0; i < rfield.nupper; i++ )
@@ -259,9 +290,9 @@ void RT_tau_reset(void)
 			/* DEPABS and SCT are abs and sct optical depth for depth only
 			 * we will not change total optical depths, just reset inner to half
 			 * TauAbsGeo(i,2) = 2.*TauAbsFace(i) */
-			opac.TauAbsGeo[0][i] = opac.TauAbsGeo[1][i]/2.f;
+			TauAbsGeo[0][i] = TauAbsGeo[1][i]/2.f;
 			/* TauScatGeo(i,2) = 2.*TauScatFace(i) */
-			opac.TauScatGeo[0][i] = opac.TauScatGeo[1][i]/2.f;
+			TauScatGeo[0][i] = TauScatGeo[1][i]/2.f;
 		}
 	}
 	else if( geometry.lgSphere )
@@ -271,12 +302,12 @@ void RT_tau_reset(void)
 		{
 			/* [1] is total optical depth from previous iteration,
 			 * [0] is optical depth at current position */
-			opac.TauAbsGeo[1][i] = 2.f*opac.TauAbsFace[i];
-			opac.TauAbsGeo[0][i] = opac.TauAbsFace[i];
-			opac.TauScatGeo[1][i] = 2.f*opac.TauScatFace[i];
-			opac.TauScatGeo[0][i] = opac.TauScatFace[i];
-			opac.TauTotalGeo[1][i] = opac.TauScatGeo[1][i] + opac.TauAbsGeo[1][i];
-			opac.TauTotalGeo[0][i] = opac.TauScatGeo[0][i] + opac.TauAbsGeo[0][i];
+			TauAbsGeo[1][i] = 2.f*opac.TauAbsFace[i];
+			TauAbsGeo[0][i] = opac.TauAbsFace[i];
+			TauScatGeo[1][i] = 2.f*opac.TauScatFace[i];
+			TauScatGeo[0][i] = opac.TauScatFace[i];
+			TauTotalGeo[1][i] = TauScatGeo[1][i] + TauAbsGeo[1][i];
+			TauTotalGeo[0][i] = TauScatGeo[0][i] + TauAbsGeo[0][i];
 		}
 	}
 	else
@@ -284,29 +315,13 @@ void RT_tau_reset(void)
 		/* open geometry */
 		for( i=0; i < rfield.nupper; i++ )
 		{
-			opac.TauTotalGeo[1][i] = opac.TauTotalGeo[0][i];
-			opac.TauTotalGeo[0][i] = opac.taumin;
-			opac.TauAbsGeo[1][i] = opac.TauAbsGeo[0][i];
-			opac.TauAbsGeo[0][i] = opac.taumin;
-			opac.TauScatGeo[1][i] = opac.TauScatGeo[0][i];
-			opac.TauScatGeo[0][i] = opac.taumin;
+			TauTotalGeo[1][i] = TauTotalGeo[0][i];
+			TauTotalGeo[0][i] = opac.taumin;
+			TauAbsGeo[1][i] = TauAbsGeo[0][i];
+			TauAbsGeo[0][i] = opac.taumin;
+			TauScatGeo[1][i] = TauScatGeo[0][i];
+			TauScatGeo[0][i] = opac.taumin;
 		}
 	}
-
-	/* same for open and closed geometries */
-	for( i=0; i < rfield.nupper; i++ )
-	{
-		/* total optical depth across computed shell */
-		opac.TauAbsTotal[i] = opac.TauAbsFace[i];
-		/* e2( tau across shell), optical depth from ill face to shielded face of cloud 
-		 * not that opac.TauAbsFace is reset to small number just after this */
-		opac.E2TauAbsTotal[i] = (realnum)e2( opac.TauAbsTotal[i] );
-		/* TauAbsFace and TauScatFace are abs and sct optical depth to ill face */
-		opac.TauScatFace[i] = opac.taumin;
-		opac.TauAbsFace[i] = opac.taumin;
-	}
-
-	/* this is optical depth at x-ray point defining effective optical depth */
-	rt.tauxry = opac.TauAbsGeo[0][rt.ipxry-1];
 	return;
 }
@@ -14,6 +14,8 @@
 #include "dense.h"
 #include "opacity.h"
 #include "atomfeii.h"
+#include "dynamics.h"
+#include "rt.h"
 #include "state.h"
 
 t_state state;
@@ -22,7 +24,7 @@ static FILE *ioSTATE;
 
 /*state_do - worker to actually get or put the structure -
  * called by state_get_put below */
-STATIC void state_do( void *pnt , size_t sizeof_pnt )
+void state_do( void *pnt , size_t sizeof_pnt )
 {
 	size_t n;
 	double sanity = 1.,
@@ -72,6 +74,26 @@ STATIC void state_do( void *pnt , size_t sizeof_pnt )
 	return;
 }
 
+/*state_get_tag read the tag of a state file without getting the state */
+bool state_get_tag( const char chFile[] , double tag[STATE_NTAG] )
+{
+	double chk_sanity;
+
+	DEBUG_ENTRY( "state_get_tag()" );
+
+	FILE *ioTAG = open_data( chFile, "rb", AS_LOCAL_ONLY_TRY );
+	if( ioTAG == NULL )
+		return false;
+
+	/* same layout as the first block written by state_do */
+	bool lgOK = ( fread( tag , sizeof(double) , STATE_NTAG , ioTAG ) == (size_t)STATE_NTAG &&
+		fread( &chk_sanity , sizeof(double) , 1 , ioTAG ) == 1 &&
+		fp_equal( chk_sanity, 1. ) );
+
+	fclose( ioTAG );
+	return lgOK;
+}
+
 /*state_get_put get or save state - called by cloudy - job is either "get" or "put" */
 void state_get_put( const char chJob[] )
 {
@@ -109,6 +131,13 @@ void state_get_put( const char chJob[] )
 	else
 		TotalInsanity();
 
+	/* the tag comes first, so that state_get_tag can read it,
+	 * the tag of a recovered state is not used here */
+	double tag[STATE_NTAG];
+	for( i=0; i < STATE_NTAG; ++i )
+		tag[i] = state.tag[i];
+	state_do( tag , sizeof(tag) );
+
 	if( state.lgState_print )
 		fprintf(ioQQQ," Print state quantities, start iso seq \n");
 
@@ -238,38 +267,70 @@ void state_get_put( const char chJob[] )
 			}
 		}
 	}
+	/* put saves the continuum optical depths which the next iteration
+	 * of this model would start with (RT_tau_reset follows the put),
+	 * so that a recovered state is not one iteration behind */
+	realnum *TauAbsGeo[2], *TauScatGeo[2], *TauTotalGeo[2];
+	vector<realnum> TauGeoNext;
+	if( lgGet )
+	{
+		for( i=0; i<2; ++i )
+		{
+			TauAbsGeo[i] = opac.TauAbsGeo[i];
+			TauScatGeo[i] = opac.TauScatGeo[i];
+			TauTotalGeo[i] = opac.TauTotalGeo[i];
+		}
+	}
+	else
+	{
+		TauGeoNext.resize( 6*rfield.nupper );
+		for( i=0; i<2; ++i )
+		{
+			TauAbsGeo[i] = &TauGeoNext[(3*i  )*rfield.nupper];
+			TauScatGeo[i] = &TauGeoNext[(3*i+1)*rfield.nupper];
+			TauTotalGeo[i] = &TauGeoNext[(3*i+2)*rfield.nupper];
+			for( n=0; n < rfield.nupper; ++n )
+			{
+				TauAbsGeo[i][n] = opac.TauAbsGeo[i][n];
+				TauScatGeo[i][n] = opac.TauScatGeo[i][n];
+				TauTotalGeo[i][n] = opac.TauTotalGeo[i][n];
+			}
+		}
+		RT_tau_reset_geo( TauAbsGeo, TauScatGeo, TauTotalGeo );
+	}
+
 	for( i=0; i<2; ++i )
 	{
-		state_do( opac.TauAbsGeo[i]  , (size_t)rfield.nupper*sizeof(realnum) );
+		state_do( TauAbsGeo[i]  , (size_t)rfield.nupper*sizeof(realnum) );
 		if( state.lgState_print )
 		{
 			for( n=0; n< rfield.nupper; ++n )
 			{
 				fprintf(ioQQQ," TauAbsGeo %li %li %.4e \n",
 					i , n , 
-					opac.TauAbsGeo[i][n] );
+					TauAbsGeo[i][n] );
 			}
 		}
 
-		state_do( opac.TauScatGeo[i] , (size_t)rfield.nupper*sizeof(realnum) );
+		state_do( TauScatGeo[i] , (size_t)rfield.nupper*sizeof(realnum) );
 		if( state.lgState_print )
 		{
 			for( n=0; n< rfield.nupper; ++n )
 			{
 				fprintf(ioQQQ," TauScatGeo %li %li %.4e \n",
 					i , n , 
-					opac.TauAbsGeo[i][n] );
+					TauScatGeo[i][n] );
 			}
 		}
 
-		state_do( opac.TauTotalGeo[i], (size_t)rfield.nupper*sizeof(realnum) );
+		state_do( TauTotalGeo[i], (size_t)rfield.nupper*sizeof(realnum) );
 		if( state.lgState_print )
 		{
 			for( n=0; n< rfield.nupper; ++n )
 			{
 				fprintf(ioQQQ," TauTotalGeo %li %li %.4e \n",
 					i , n , 
-					opac.TauAbsGeo[i][n] );
+					TauTotalGeo[i][n] );
 			}
 		}
 
@@ -307,6 +368,7 @@ void state_get_put( const char chJob[] )
 
 	state_do( struc.coolstr,(size_t)(struc.nzlim)*sizeof(double ) );
 	state_do( struc.heatstr , (size_t)(struc.nzlim)*sizeof(double ) );
+	state_do( struc.dCmHdTstr , (size_t)(struc.nzlim)*sizeof(double ) );
 
 	for( nelem=ipHYDROGEN; nelem<LIMELM; ++nelem )
 	{
@@ -340,6 +402,10 @@ void state_get_put( const char chJob[] )
 		state_do( struc.gas_phase[nelem] , (size_t)(struc.nzlim)*sizeof(realnum ) );
 	}
 
+	/* the upstream structure of the advection solution */
+	if( dynamics.lgAdvection )
+		DynaStateGetPut( lgGet );
+
 	/*fprintf(ioQQQ,"DEBUG done\n");*/
 
 	/* close the file */
@@ -8,6 +8,17 @@
 /**state_get_put get or save state - job is either "get" or "put" */
 void state_get_put( const char chJob[] );
 
+/**state_do - worker to actually get or put one block of the state file,
+ * only valid while state_get_put is running */
+void state_do( void *pnt , size_t sizeof_pnt );
+
+/** number of values in the tag in front of a state file */
+const long STATE_NTAG = 4;
+
+/**state_get_tag read the tag of a state file without getting the state,
+ * returns false if the file cannot be read */
+bool state_get_tag( const char chFile[] , double tag[STATE_NTAG] );
+
 struct t_state {
 
 	/** file pointer for the files to get or put the state 
@@ -26,6 +37,14 @@ struct t_state {
 	/** print keyword on state command to turn on printout */
 	bool lgState_print;
 
+	/** WARM keyword on state get - the recovered structure is also
+	 * used as initial solution of the first iteration */
+	bool lgWarmStart;
+
+	/** TAG keyword on state put - numbers written in front of the state,
+	 * which tell the caller which model saved it, zero by default */
+	double tag[STATE_NTAG];
+
 	};
 
 extern t_state state;
@@ -78,6 +78,10 @@ struct t_struc {
 	double *coolstr ,
 	  *heatstr;
 
+	/** derivative of cooling - heating wrt temperature for each zone,
+	 * thermal.dCooldT - thermal.dHeatdT */
+	double *dCmHdTstr;
+
 	/** this is the relative ionization that is the limit for choosing 
 	 * zones using it, and for detecting it in prt_comment,
 	 * default is 1e-3 */
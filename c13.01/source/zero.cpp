@@ -56,6 +56,7 @@
 #include "hyperfine.h"
 #include "init.h"
 #include "dark_matter.h"
+#include "rate_cache.h"
 
 // //////////////////////////////////////////////////////////////////////////
 //
@@ -139,6 +140,9 @@ void zero(void)
 	state.lgGet_state = false;
 	state.lgPut_state = false;
 	state.lgState_print = false;
+	state.lgWarmStart = false;
+	for( long i=0; i < STATE_NTAG; ++i )
+		state.tag[i] = 0.;
 
 	/* this is default number of zones
 	 * >>chng 96 jun 5, from 400 to 500 for thickest corners4 grid */
@@ -904,6 +908,9 @@ void zero(void)
 	 * >> refer Federman, S. R. & Zsargo, J. 2003, ApJ, 589, 319
 	 * By default, this is false - changed with set chemistry command */
 	mole_global.lgNeutrals = true;
+	/* dense LU for the Newton step of the chemistry, changed with
+	 * set chemistry solver sparse */
+	mole_global.lgSparseSolve = false;
 	/* option to use H2 continuum dissociation cross sections computed by P.C. Stancil
 	 * By default, this is true - changed with "set H2 continuum dissociation xxx" command
 	 * options are "Stancil" or "AD69" */
@@ -1265,6 +1272,9 @@ void zero(void)
 	/* zero out some grain variables */
 	GrainZero();
 
+	/* cached rate coefficients depend on the parameters of the model */
+	RateCacheZero();
+
 	/* this is flag saying whether this is very first call,
 	 * a time when space has not been allocated */
 	lgFirstCall = false;
@@ -0,0 +1,9 @@
+#!/usr/bin/perl
+
+# This perl script cleans out the benchmark directory after a run, it will only
+# leave files that are part of the official distribution, the cloudy executable
+# (with a name ending in .exe) if that was present, and the reference results
+# bench_reference.dat!
+
+system "../auto/clean_tsuite.pl";
+unlink "bench_results.dat";
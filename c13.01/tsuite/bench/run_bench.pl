@@ -0,0 +1,256 @@
+#!/usr/bin/perl
+
+# This perl script runs the performance benchmark: a subset of the test suite
+# (listed in bench_list.dat) and optionally the coupled 1D TPCI problem. The
+# models are run one at a time so that the timings are not disturbed by other
+# jobs. The syntax is:
+#
+# ./run_bench.pl [ <exe> ] [ -record ] [ -tol <frac> ] [ -tpci <dir> [ -np <n> ] [ -steps <n> ] ]
+#
+# <exe>: the Cloudy executable, or the name of a directory under source/ as for
+#      run_parallel.pl (e.g. sys_gcc). The default is ../../source/cloudy.exe.
+#      A relative path to the executable must be given relative to this directory.
+# -record: store the results as the new reference in bench_reference.dat
+# -tol: allowed relative increase of the timings, memory use and convergence
+#      loops before a regression is flagged (default 0.10)
+# -tpci: also run the coupled problem in <dir>, a TPCI directory set up from
+#      template/ in which the pluto executable has been built. It is run with
+#      template/bench.ini for -steps time steps (default 100) without writing
+#      output, on <np> processors using mpirun if -np is given.
+#
+# For each model the results are written as one line to bench_results.dat:
+#
+# name  wall[s]  cpu[s]  zones  iterations  itr/zn  rss[MB]  update[s]
+#
+# wall is the wall clock time, cpu the ExecTime of Cloudy, zones and iterations
+# are taken from the "Cloudy ends" line, itr/zn is the number of ionization
+# convergence loops per zone of the last iteration, rss the peak memory use
+# (printed by Cloudy with the -m flag) and update the time per radiative update
+# of the TPCI run (cloudy/rays timer).
+# For the TPCI run cpu is the time spent in CloudyRadSolve (cloudy timer) and
+# the zones and iterations columns hold the number of time steps and radiative
+# updates. Quantities that are not known are written as "-".
+#
+# Unless -record is given, the results are compared with bench_reference.dat.
+# A regression is flagged when a timing, the memory use or itr/zn exceeds the
+# reference by more than the tolerance, or when the number of zones or
+# iterations has changed. Timings below 1 s are not checked. The exit status is
+# 1 if a regression was found and 0 otherwise.
+
+use strict;
+use Cwd;
+use Time::HiRes qw( time );
+
+my $exe = "../../source/cloudy.exe";
+my $lgRecord = 0;
+my $tol = 0.10;
+my $tpci = "";
+my $np = 0;
+my $nsteps = 100;
+
+while( @ARGV ) {
+    my $arg = shift @ARGV;
+    if( $arg eq "-record" ) {
+	$lgRecord = 1;
+    }
+    elsif( $arg eq "-tol" ) {
+	$tol = shift @ARGV;
+    }
+    elsif( $arg eq "-tpci" ) {
+	$tpci = shift @ARGV;
+    }
+    elsif( $arg eq "-np" ) {
+	$np = shift @ARGV;
+    }
+    elsif( $arg eq "-steps" ) {
+	$nsteps = shift @ARGV;
+    }
+    elsif( -d "../../source/$arg" ) {
+	$exe = "../../source/$arg/cloudy.exe";
+    }
+    else {
+	$exe = $arg;
+    }
+}
+
+chomp( my $base_dir = `pwd` );
+my $tsuite = "$base_dir/..";
+my $template = "$base_dir/../../../template";
+
+my @results;
+
+# the Cloudy models
+open( LIST, "<bench_list.dat" ) or die "could not open bench_list.dat\n";
+while( <LIST> ) {
+    s/#.*//;
+    next if( /^\s*$/ );
+    my ( $input ) = split;
+    push( @results, run_cloudy( $input ) );
+}
+close( LIST );
+
+# the coupled TPCI problem
+if( $tpci ne "" ) {
+    push( @results, run_tpci( $tpci ) );
+}
+
+open( RES, ">bench_results.dat" );
+print RES "# name  wall[s]  cpu[s]  zones  iterations  itr/zn  rss[MB]  update[s]\n";
+foreach my $r ( @results ) {
+    print RES join( "  ", @$r ), "\n";
+}
+close( RES );
+
+if( $lgRecord ) {
+    system "cp bench_results.dat bench_reference.dat";
+    print "\nThe results were stored in bench_reference.dat\n";
+    exit 0;
+}
+
+exit( compare( \@results ) > 0 ? 1 : 0 );
+
+# run a single Cloudy model, the input script is given relative to tsuite/
+sub run_cloudy {
+    my ( $input ) = @_;
+
+    my $name = $input;
+    $name =~ s|^.*/||;
+    $name =~ s/\.in$//;
+    my $dir = $input;
+    $dir =~ s|/[^/]*$||;
+
+    print "running $input...\n";
+    my $t0 = time();
+    system "$tsuite/auto/run_single_r.pl $tsuite \"$exe -m\" $input";
+    my $wall = sprintf( "%.2f", time() - $t0 );
+
+    my ( $cpu, $zones, $iter, $itrzn, $rss ) = ( "-", "-", "-", "-", "-" );
+    if( open( OUTP, "<$tsuite/$dir/$name.out" ) ) {
+	while( <OUTP> ) {
+	    if( /Cloudy ends: (\d+) zones?, (\d+) iterations?/ ) {
+		$zones = $1;
+		$iter = $2;
+	    }
+	    $cpu = $1 if( /ExecTime\(s\)\s+([\d.]+)/ );
+	    $itrzn = $1 if( /itr\/zn:\s*([\d.]+)/ );
+	    $rss = $1 if( /Peak memory\(MB\)\s+([\d.]+)/ );
+	}
+	close( OUTP );
+    }
+    else {
+	print "  PROBLEM: no output found for $input\n";
+    }
+    return [ $name, $wall, $cpu, $zones, $iter, $itrzn, $rss, "-" ];
+}
+
+# run the coupled 1D problem in the TPCI directory $dir
+sub run_tpci {
+    my ( $dir ) = @_;
+
+    my $name = "tpci_1d";
+    if( ! -x "$dir/pluto" ) {
+	print "  PROBLEM: $dir/pluto not found, build TPCI there first\n";
+	return [ $name, "-", "-", "-", "-", "-", "-", "-" ];
+    }
+    system "cp $template/bench.ini $dir/bench.ini";
+
+    my $command = "./pluto -i bench.ini -maxsteps $nsteps -no-write";
+    $command = "mpirun -np $np $command" if( $np > 0 );
+
+    print "running $name ($nsteps steps)...\n";
+    my $cwd = getcwd();
+    chdir $dir;
+    my $t0 = time();
+    system "$command > bench.log 2>&1";
+    my $wall = sprintf( "%.2f", time() - $t0 );
+
+    # the timers of the last report, maximum over the processors
+    my ( %calls, %tm );
+    if( open( TM, "<cl_timers.out" ) ) {
+	while( <TM> ) {
+	    next if( /^#/ );
+	    my ( $step, $t, $rank, $timer, $ncalls, $twall ) = split;
+	    %calls = %tm = () if( $rank == 0 && $timer eq "integrate" );
+	    $calls{$timer} = $ncalls if( $ncalls > $calls{$timer} );
+	    $tm{$timer} = $twall if( $twall > $tm{$timer} );
+	}
+	close( TM );
+    }
+    my $rss = "-";
+    foreach my $log ( "pluto.log", "bench.log" ) {
+	if( open( LOG, "<$log" ) ) {
+	    while( <LOG> ) {
+		$rss = $1 if( /peak memory ([\d.]+) MB/ );
+	    }
+	    close( LOG );
+	}
+    }
+    chdir $cwd;
+
+    my ( $cpu, $update ) = ( "-", "-" );
+    $cpu = sprintf( "%.2f", $tm{"cloudy"} ) if( defined $tm{"cloudy"} );
+    $update = sprintf( "%.4e", $tm{"cloudy/rays"}/$calls{"cloudy/rays"} )
+	if( $calls{"cloudy/rays"} > 0 );
+    if( $update eq "-" ) {
+	print "  PROBLEM: no radiative update found in $dir/cl_timers.out\n";
+    }
+    my $steps = defined $calls{"integrate"} ? $calls{"integrate"} : "-";
+    my $updates = defined $calls{"cloudy/rays"} ? $calls{"cloudy/rays"} : "-";
+    return [ $name, $wall, $cpu, $steps, $updates, "-", $rss, $update ];
+}
+
+# compare the results with the reference, returns the number of regressions
+sub compare {
+    my ( $results ) = @_;
+
+    my %ref;
+    if( ! open( REF, "<bench_reference.dat" ) ) {
+	print "\nNo bench_reference.dat found, run ./run_bench.pl -record to create it\n";
+	return 0;
+    }
+    while( <REF> ) {
+	next if( /^#/ );
+	my @r = split;
+	$ref{$r[0]} = [ @r ];
+    }
+    close( REF );
+
+    # column, label, type: 0 = may not increase, 1 = may not change
+    my @checks = ( [ 1, "wall", 0 ], [ 2, "cpu", 0 ], [ 3, "zones", 1 ], [ 4, "iterations", 1 ],
+		   [ 5, "itr/zn", 0 ], [ 6, "rss", 0 ], [ 7, "update", 0 ] );
+
+    my $nRegress = 0;
+    print "\n";
+    foreach my $r ( @$results ) {
+	my $name = $$r[0];
+	if( ! defined $ref{$name} ) {
+	    print "$name: no reference\n";
+	    next;
+	}
+	my @msg;
+	foreach my $c ( @checks ) {
+	    my ( $col, $label, $type ) = @$c;
+	    my $new = $$r[$col];
+	    my $old = $ref{$name}[$col];
+	    next if( $new eq "-" || $old eq "-" );
+	    if( $type == 1 ) {
+		push( @msg, "$label changed from $old to $new" ) if( $new != $old );
+	    }
+	    elsif( $new > $old*(1.+$tol) ) {
+		# short timings are dominated by noise
+		next if( $label =~ /wall|cpu/ && $new < 1. );
+		my $frac = ( $old > 0 ) ? sprintf( " (%+.1f%%)", 100.*($new/$old-1.) ) : "";
+		push( @msg, "$label increased from $old to $new$frac" );
+	    }
+	}
+	if( @msg ) {
+	    print "$name: REGRESSION: ", join( ", ", @msg ), "\n";
+	    ++$nRegress;
+	}
+	else {
+	    print "$name: OK\n";
+	}
+    }
+    print "\n$nRegress regression(s) found\n";
+    return $nRegress;
+}
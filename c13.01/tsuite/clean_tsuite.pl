@@ -8,4 +8,5 @@
 
 system "cd auto ; ./clean_tsuite.pl";
 system "cd slow ; ./clean_tsuite.pl";
+system "cd bench ; ./clean_tsuite.pl";
 unlink "Makefile";
@@ -23,11 +23,23 @@
 
 #include "cddefines.h"
 #include "cddrive.h"
+#include "iso.h"
+#include "state.h"
+#include "thirdparty.h"
 
 #ifdef PARALLEL
   #include <mpi.h>
 #endif
 
+#include <unistd.h>
+#include <poll.h>
+#include <sys/wait.h>
+#include <sys/mman.h>
+
+#ifdef _OPENMP
+  #include <omp.h>
+#endif
+
 #define REALNUM_DEFINED YES
   extern "C" {
     #include "pluto.h"
@@ -35,6 +47,7 @@
 #undef REALNUM_DEFINED
 
 #include "params.h"
+#include "cloudy_timer.h"
 
 
 /*! \name Inverse domain loop
@@ -47,21 +60,366 @@
 
 #define USE_CLOUDY YES
 #define USE_ADVEC NO
-#define CLOUDY_PRINT_FREQ  10
 #define CLOUDY_CONVERGE NO
 
+/*! Cloudy output of the rays (cl_data.*) is written every 
+    CLOUDY_PRINT_FREQ solutions and at the first and last one
+    ("Cloudy_print_freq  n" in pluto.ini, 0 = never). The save files
+    are selected with "Cloudy_save  n  type1 type2 ..." (see
+    Cl_save_types) and are written for the last iteration only with
+    "Cloudy_save_last  yes". With "Cloudy_binary  yes" every solution
+    writes the profiles of all rays into one binary file
+    cl_data.NNNN.bin (see CloudyWriteBinary). */
+#define CLOUDY_PRINT_FREQ  10
+#define CLOUDY_BINARY      NO
+
 #define CHANGE_FAKTOR     0.1
+
+/*! Radiative heating: the pressure may change by FRAC_COOL_TIMESTEP
+    in one step. With CLOUDY_IMPLICIT the net heating of the last 
+    Cloudy model is linearized in the temperature,
+    (H-C)(T) = (H-C)_cl + d(H-C)/dT (T - T_cl), and applied with a 
+    backward Euler step, which relaxes towards the equilibrium 
+    temperature instead of overshooting it. Cells which cool or heat
+    strongly then limit the hydro step much less than with the explicit
+    update. Cells with d(H-C)/dT >= 0 are updated explicitly.
+    Can be changed with "Cloudy_implicit  yes/no" in pluto.ini */
 #define FRAC_COOL_TIMESTEP  0.1
+#define CLOUDY_IMPLICIT     NO
+
+/*! The rays are tested for changes every CLOUDY_CHECK_FREQ calls
+    ("Cloudy_check_freq  n" in pluto.ini). A ray which has not been
+    solved for CLOUDY_MAX_STALE calls is solved in any case
+    ("Cloudy_max_stale  n", 0 = never). */
+#define CLOUDY_CHECK_FREQ  1000
+#define CLOUDY_MAX_STALE   0
+
+/*! Number of Cloudy models that run at the same time on one 
+    processor (forked worker processes). With MPI the library must
+    allow fork(), see CloudyRaysStart. Can be changed with 
+    "Cloudy_workers  n" in pluto.ini */
+#define CLOUDY_NWORKERS  1
+
+/*! Warm start: every ray saves its converged structure in a
+    state file and the next model of the same ray starts from it.
+    The line optical depths are not part of the state, so a warm
+    started model still needs two iterations. Off by default, can
+    be changed with "Cloudy_warm_start  yes/no" in pluto.ini */
+#define CLOUDY_WARM_START  NO
+
+/*! Number of iterations of a cold and of a warm started model,
+    the latter can be changed with "Cloudy_warm_iter  n" (>= 2) */
+#if ( USE_ADVEC )
+  #define CLOUDY_ITER       150
+  #define CLOUDY_WARM_ITER  10
+#else
+  #define CLOUDY_ITER       2
+  #define CLOUDY_WARM_ITER  2
+#endif
+
+/*! Load balance: the rays of all processors are distributed by
+    the wall time of their last solution, so that all processors
+    get the same amount of work (PARALLEL only). Can be changed
+    with "Cloudy_balance  yes/no" in pluto.ini */
+#define CLOUDY_BALANCE  NO
+
+/*! Asynchronous solution: the rays are solved by worker processes
+    on a snapshot of the hydro variables, while PLUTO continues with
+    the last radiative heating and acceleration. The new results are
+    applied when all rays are solved, but at the latest after 
+    CLOUDY_MAX_LAG steps. Can be changed with "Cloudy_async  yes/no"
+    and "Cloudy_max_lag  n" in pluto.ini */
+#define CLOUDY_ASYNC    NO
+#define CLOUDY_MAX_LAG  10
+
+/*! Cache of the Cloudy results on a grid over log n_H, log T,
+    log N_H (column to the illuminated face) and x1 velocity in km/s
+    (with USE_ADVEC only). A ray which must be solved is taken from 
+    the cache if all its cells are found, between the Cloudy calls
+    the cells of the other rays are updated from the cache in every
+    step. The grid is written to CLOUDY_CACHE_FILE at the last step
+    and read at the start of the next run.
+    Can be changed with "Cloudy_cache  yes/no", 
+    "Cloudy_cache_file  name" (none = no file) and
+    "Cloudy_cache_tol  dlogn  dlogT  dlogN  dv" in pluto.ini */
+#define CLOUDY_CACHE       NO
+#define CLOUDY_CACHE_FILE  "cl_cache.bin"
+#define CLOUDY_CACHE_DLOGN  0.05
+#define CLOUDY_CACHE_DLOGT  0.01
+#define CLOUDY_CACHE_DLOGC  0.05
+#define CLOUDY_CACHE_DVEL   1.0
+
+/*! Transit spectra: at every analysis step ("analysis  dt  dn" in
+    pluto.ini) the excess absorption of the lines in Tr_lines is 
+    computed from the level populations of the last Cloudy models
+    (see TransitSpectrum). Can be changed with 
+    "Transit_lines  n  name1 ...", "Transit_rstar  R/Rsun",
+    "Transit_rmax  r" (code units, 0 = domain) and "Transit_scale  f"
+    (scales populations and velocities) in pluto.ini */
+#define TRANSIT_RSTAR  1.0
+#define TRANSIT_RMAX   0.0
+#define TRANSIT_SCALE  1.0
+
+/*! Incident SED: the table in CLOUDY_SED_FILE is read only once and
+    passed to Cloudy with cdSetIncidentSED (see CloudyIncidentSED) */
+#define CLOUDY_SED_FILE  "spectra.ini"
+#define CL_SED_NCMD      16
+#define CL_SED_LINE      256
+
+/*! pi e^2/(m_e c^2) in cm */
+#define TR_PI_E2_MEC2  8.85282e-13
+
+/*! Segments of a chord with a line center optical depth scale
+    below TR_TAU_MIN are skipped (see TransitLineDepth) */
+#define TR_TAU_MIN     1.e-12
+
+/*! Cloudy save commands which can be selected with Cloudy_save:
+    name, command (without "last") and default selection, where 
+    2 = selected for the last iteration, 1 = selected, 0 = off.
+    A type selected in pluto.ini keeps its "last" setting. */
+static const char *Cl_save_types[][3] = {
+  {"over",      "save overview \"over.tab\"",                        "1"},
+  {"pres",      "save pressure \"pres.tab\"",                        "2"},
+  {"wind",      "save wind \"wind.tab\"",                            "1"},
+  {"dyna",      "save dynamics advection \"dyna.tab\"",              "2"},
+  {"continuum", "save continuum \"continuum.tab\" units Angstrom",    "2"},
+  {"hcond",     "save hydrogen conditions \"H_cond.tab\"",           "0"},
+  {"cool",      "save cooling \"cool.tab\"",                         "2"},
+  {"heat",      "save heating \"heat.tab\"",                         "0"},
+  {"ages",      "save ages \"ages.tab\"",                            "2"},
+  {"pops",      "save species populations \"pops.tab\"",             "2"},
+  {"energies",  "save species energies \"energies.tab\"",            "2"}};
+#define CL_NSAVE_TYPES  11
 
 int counter = 0;
+static int Cl_print_freq = CLOUDY_PRINT_FREQ;
+static int Cl_binary = CLOUDY_BINARY;
+static int Cl_save[CL_NSAVE_TYPES];
+static int Cl_async = CLOUDY_ASYNC;
+static int Cl_max_lag = CLOUDY_MAX_LAG;
+static int Cl_nworkers = CLOUDY_NWORKERS;
+static int Cl_balance = CLOUDY_BALANCE;
+static int Cl_warm_start = CLOUDY_WARM_START;
+static int Cl_warm_iter = CLOUDY_WARM_ITER;
+static int Cl_check_freq = CLOUDY_CHECK_FREQ;
+static int Cl_max_stale = CLOUDY_MAX_STALE;
+static int Cl_cache = CLOUDY_CACHE;
+static int Cl_implicit = CLOUDY_IMPLICIT;
+
+/*! Main output of the Cloudy models: cloudy.out, a worker process
+    writes to its own file (see CloudyRaysProgress) */
+static char Cl_out_file[64] = "cloudy.out";
+static int  Cl_out_new = NO;   /**< truncate Cl_out_file with the next model */
+
+/*! User defined variables which are set by a Cloudy model
+    and must be sent back from a worker process */
+static const char *Cl_ray_vars[] = {"U_MEAN_MOL", "U_RAD_HEAT", "U_RAD_ACCEL",
+                                    "U_HEAT_EFF", "U_EDEN", "U_N_HE23S", "U_N_H1S",
+                                    "U_RAD_DHDT", "U_RAD_TEMP"};
+#define CL_NRAY_VARS  9
+
+/*! Lines of the transit spectra: name, user defined variable of the
+    lower level, atomic mass (amu), transition probability (s-1),
+    wavelength range (Angstrom, vacuum), resolution lambda/dlambda
+    and the fine structure components (vacuum wavelength, f-value) */
+typedef struct TR_LINE {
+  const char *name;
+  const char *uvar;
+  double mass, A;
+  double lmin, lmax, res;
+  int ncomp;
+  double wl[3], f[3];
+} Tr_Line;
+
+static const Tr_Line Tr_lines[] = {
+  {"he10830", "U_N_HE23S", 4.0026, 1.0216e7, 10829.0, 10836.0, 375000., 3,
+   {10832.057, 10833.217, 10833.306}, {5.9902e-2, 1.7974e-1, 2.9958e-1}},
+  {"lya",     "U_N_H1S",   1.00794, 6.2649e8, 1190.5, 1250.0, 37500., 2,
+   {1215.6682, 1215.6736, 0.0}, {1.3881e-1, 2.7761e-1, 0.0}}};
+#define TR_NLINES  2
+
+/*! \name Ray column
+    A ray is passed to Cloudy as a column of CL_NCOL_VARS
+    x1 profiles of length NX1_TOT (density, pressure, x1 velocity,
+    mean mol. weight), so that it can be solved on any processor.
+    The results are returned as CL_NRAY_VARS profiles in the
+    order of Cl_ray_vars.
+*/
+/**@{ */
+#define CL_COL_RHO    0
+#define CL_COL_PRS    1
+#define CL_COL_VX1    2
+#define CL_COL_MU     3
+#define CL_NCOL_VARS  4
+/**@} */
+
+/*! Table of the rays which are currently solved by Cloudy
+    (see CloudyRaysBegin) */
+typedef struct CL_RAY_TABLE {
+  int nrays;          /**< number of rays in the table */
+  int nloc;           /**< number of rays of this processor */
+  int rbeg;           /**< first ray of this processor */
+  int nalloc;         /**< allocated size of the table */
+  int *ray_j, *ray_k;     /**< local indices (valid for own rays) */
+  int *ray_jg, *ray_kg;   /**< global indices */
+  double *col;        /**< columns, CL_NCOL_VARS*NX1_TOT per ray */
+  double *res;        /**< results, CL_NRAY_VARS*NX1_TOT per ray */
+  
+  int lg_fork;        /**< rays are solved in worker processes */
+  int lg_balance;     /**< rays are balanced between processors */
+  int *cnt, *displ;   /**< rays of every processor in the table */
+  int *proc;          /**< processor which solves the ray */
+  double *cost;       /**< wall time of the ray */
+  double **ray_cost;  /**< wall time of the last solution of (k,j) */
+  int *list, nlist;   /**< rays solved by this processor, longest first */
+  int *qnext;         /**< next entry of list, shared with the workers */
+  int nfork;          /**< maximum number of workers */
+  int nrun;           /**< 0 if all rays are handed out */
+  int nactive;        /**< number of running workers */
+  int success;        /**< 0 or exit status of failed model */
+  int nsolved;        /**< rays solved by this process */
+  pid_t *pid;         /**< process ids of the workers */
+  int *fd;            /**< pipe of the workers */
+  int *wid;           /**< output file number of the workers */
+  int *wused;         /**< output file n has been written */
+  struct pollfd *pfd;
+  
+  Grid *grid;
+  int Cl_ncalls, lg_last_step;
+  double x1_dom_len;
+  #ifdef PARALLEL
+   MPI_Comm comm;     /**< communicator of the ray exchange */
+  #endif
+} Cl_RayTable;
+
+static Cl_RayTable Cl_rt;
+
+/*! Buffers for the zone structure of the last Cloudy model
+    (see CloudyGetResults). They are reused for every ray and
+    only grow with the number of zones. */
+typedef struct CL_ZONE_TABLE {
+  long nalloc;        /**< allocated number of zones */
+  double *depth;      /**< depth, followed by numden, massden, cooling, heating */
+  double *numden, *massden, *cooling, *heating;
+  double *val;        /**< CL_NRAY_VARS profiles of nalloc zones */
+  int *ilow, *ihigh;  /**< interpolation zones of the x1 cells */
+  double *wght;       /**< interpolation weights of the x1 cells */
+} Cl_ZoneTable;
+
+static Cl_ZoneTable Cl_zt;
+
+/*! Cache of the results (see CloudyCacheLookup): hash table of
+    the filled nodes of the grid with open addressing */
+#define CL_CACHE_NDIM  4
+
+typedef struct CL_CACHE {
+  long nslot;         /**< size of the table, power of 2 */
+  long nused;         /**< number of filled nodes */
+  unsigned long long *key;   /**< packed node indices, 0 = empty */
+  double *val;        /**< CL_NRAY_VARS results per node */
+  double dx[CL_CACHE_NDIM];  /**< node distance = tolerance */
+  char file[128];     /**< cache file or "none" */
+  long nray;          /**< rays taken from the cache */
+} Cl_Cache;
+
+static Cl_Cache Cl_cc;
 
-int CallCloudy(Data *d, Grid *grid, int Cl_ncalls, double x1_dom_len, int Pl_k, int Pl_j, int koff, int joff, int lg_last_step);
-void CloudyInputScript(Data *d, Grid *grid, int Cl_ncalls, double x1_dom_len, int Pl_k, int Pl_j, int koff, int joff, int lg_last_step);
-void CloudyGetResults( Grid *grid, int Pl_k, int Pl_j );
-void MapCloudytoPLUTO( Grid *grid, double ***Pl_val, int Pl_k, int Pl_j, 
-                       double *Cl_depth, double *Cl_val, int Cl_nzone );
+/*! Net radiative heating and its pressure derivative of the
+    present step (see RadiativeRate) */
+static double ***Rad_heat, ***Rad_dhdp;
+
+/*! Coupling state of CloudyRadSolve which is written with every
+    restart dump (see CloudyCouplingDump): the reference density and
+    pressure of the change detection and the counter of the last
+    solution of the rays go to cl_coupling.NNNN.dbl, the Cloudy file
+    number and the call counter to CL_COUPLING_FILE. The results of
+    Cloudy are user defined variables (Cl_ray_vars) and are restored
+    from the dbl or dbl.h5 output itself. */
+#define CL_COUPLING_FILE  "cl_coupling.out"
+
+typedef struct CL_COUPLING {
+  int lg_restart;     /**< the state was read by CloudyCouplingRestart */
+  int ncalls;         /**< number of the next Cloudy solution (file #) */
+  double ***last_dn, ***last_pr;  /**< density and pressure of the last solution */
+  int **ray_last;     /**< counter of the last solution of a ray */
+  double ***buf;      /**< ray_last as 3D array for the binary I/O */
+} Cl_Coupling;
+
+static Cl_Coupling Cl_cp;
+
+/*! Accumulated time of a phase (see cloudy_timer.h). Only
+    doubles, so that the timers can be sent as MPI_DOUBLE and
+    through the pipe of a worker. */
+typedef struct CL_TIMER {
+  double calls;       /**< number of calls */
+  double wall;        /**< wall clock time (s) */
+  double cpu;         /**< CPU time of Cloudy since cdInit (cdExecTime, s) */
+  double tmin, tmax;  /**< shortest and longest call (s) */
+  double t0;          /**< start of the running call */
+} Cl_Timer;
+
+#define CL_TM_NREC  (int)(sizeof(Cl_Timer)/sizeof(double))
+#define CL_NTM_RAY  (CL_TM_MAP - CL_TM_RAY + 1)  /* timers sent by a worker */
+#define CL_TM_FILE  "cl_timers.out"
+
+static Cl_Timer Cl_tm[CL_NTIMERS];
+static const char *Cl_tm_names[CL_NTIMERS] = {"integrate", "cloudy", "cloudy/check",
+                                    "cloudy/rays", "cloudy/rays/ray", "cloudy/rays/ray/init",
+                                    "cloudy/rays/ray/script", "cloudy/rays/ray/drive",
+                                    "cloudy/rays/ray/results", "cloudy/rays/ray/results/map",
+                                    "output", "mpi_wait"};
+
+int CloudySolveRays(Data *d, Grid *grid, int **ray_solve, int Cl_ncalls, double x1_dom_len, int koff, int joff, int lg_last_step);
+void CloudyRaysBegin(Data *d, Grid *grid, int **ray_solve, int Cl_ncalls, double x1_dom_len,
+                     int koff, int joff, int lg_last_step, int lg_async);
+void CloudyRaysStart();
+int CloudyRaysProgress(int lg_wait);
+int CloudyRaysEnd();
+#ifdef PARALLEL
+void CloudyBalanceRays();
+void CloudyExchangeRays(int lg_results);
+#endif
+int CloudyCostCmp(const void *a, const void *b);
+void CloudySaveRayState(double ***last_dn, double ***last_pr, int **ray_last, int Cl_counter);
+void CloudyCouplingAlloc();
+void CloudyCouplingIO(int nfile, char *mode, int swap_endian);
+void CloudyCouplingDump(int nfile);
+int CloudyCouplingRestart(Input *ini, int nrestart, int type);
+int CloudyTakeRay();
+void CloudyFinalize();
+void CloudyOutputSettings();
+void CloudyWriteBinary();
+void CloudyCacheInit();
+long CloudyCacheFind(unsigned long long key, int lg_insert);
+void CloudyCacheCoords(Grid *grid, double *Pl_col, double *Pl_x);
+int CloudyCacheLookup(double *Cl_x, double *Cl_val);
+int CloudyCacheRay(Grid *grid, double *Pl_col, double *Pl_res, int *Pl_hit);
+void CloudyCacheStore(Grid *grid, double *Pl_col, double *Pl_res);
+int CloudyCacheSolveRay(Data *d, Grid *grid, int Pl_k, int Pl_j);
+void CloudyCacheRefresh(Data *d, Grid *grid, int **ray_solve);
+void CloudyCacheWrite();
+void CloudyPackRay(Data *d, int Pl_k, int Pl_j, double *Pl_col);
+void CloudyUnpackRay(int Pl_k, int Pl_j, double *Pl_res);
+int CallCloudy(Grid *grid, double *Pl_col, double *Pl_res, int Cl_ncalls, double x1_dom_len, int Pl_jg, int Pl_kg, int lg_last_step);
+void CloudyIncidentSED();
+void CloudyConstantScript(double x1_dom_len);
+void CloudyInputScript(Grid *grid, double *Pl_col, int Cl_ncalls, int Pl_jg, int Pl_kg, int lg_last_step);
+void CloudyGetResults( Grid *grid, double *Pl_res );
+void MapCloudytoPLUTO( Grid *grid, double *Pl_res, double *Cl_depth,
+                       double *Cl_val, long Cl_nzone, long Cl_nalloc );
+void RadiativeRate(Data *d, double ***heat, double ***dhdp);
 void RadiativeHeating(Data *d);
 void RadiativeTimestep(Data *d,  Time_Step *Dts, int lg_last_step);
+extern "C" void TransitSpectrum(const Data *d, Grid *grid);
+void TransitLineDepth(const Tr_Line *line, double *Pl_r, double *Pl_dr, double *Pl_n,
+                      double *Pl_T, double *Pl_v, int nr, double Tr_rstar,
+                      double Tr_rmax, double *Tr_wl, double *Tr_depth, int nwl);
+double CloudyClock();
+void CloudyTimerMerge(Cl_Timer *tm, int nbeg, int nend);
+void CloudyTimerPause(int n);
+void CloudyTimerCount(int n, int ncalls);
+size_t CloudyPipeWrite(int fd, void *vbuf, size_t len);
+size_t CloudyPipeRead(int fd, void *vbuf, size_t len);
 
 int CloudyRadSolve(Data *d, Time_Step *Dts, Grid *grid, int restart, int lg_last_step)
 /*!
@@ -82,20 +440,14 @@ int CloudyRadSolve(Data *d, Time_Step *Dts, Grid *grid, int restart, int lg_last
  *
  *********************************************************************** */
 {
-  //  return 0;
-    
-  //printf("counter %d\n", counter);
+  CloudyTimerStart(CL_TM_CLOUDY);
   counter++;
-  if ( counter < 1000 ) {
-    //return 0;
-  }
 
   int i, j, k;
   int joff, koff;
   int Cl_success = 1;
   bool lg_solve_rad = false;
   static bool lg_first_call = true;
-  static bool lg_second_call = true;
   static int Cl_ncalls;
   double fac;
   
@@ -103,28 +455,94 @@ int CloudyRadSolve(Data *d, Time_Step *Dts, Grid *grid, int restart, int lg_last
   x1_dom_len = 0.9995*(grid[IDIR].x[IEND] - grid[IDIR].x[IBEG-1])*g_unitLength;
   
   static double ***last_dn, ***last_pr;
+  static int **ray_solve, **ray_last;
+  int nray_solve = 0;
   
   double ***mean_mol;
   mean_mol = GetUserVar("U_MEAN_MOL");
   
   
   if (last_dn == NULL){
-    last_dn  = ARRAY_3D(NX3_TOT, NX2_TOT, NX1_TOT, double);
-    last_pr  = ARRAY_3D(NX3_TOT, NX2_TOT, NX1_TOT, double);
-    DOM_LOOP(k,j,i){ // initialize the arrays
-      last_dn[k][j][i]  = d->Vc[DN][k][j][i];
-      last_pr[k][j][i]  = d->Vc[PR][k][j][i];
-    }
-    if( restart == YES ){
-      // no good solution for restart:
-      // set Cl_ncalls and comment the print1 and QUIT lines
-      Cl_ncalls = 100;
-//       print1 ("! You must set the restart number for Cloudy!\n");
-//       QUIT_PLUTO(1);
+    CloudyCouplingAlloc();
+    last_dn   = Cl_cp.last_dn;
+    last_pr   = Cl_cp.last_pr;
+    ray_last  = Cl_cp.ray_last;
+    ray_solve = ARRAY_2D(NX3_TOT, NX2_TOT, int);
+    if( Cl_cp.lg_restart ){
+      // coupling state of the restart file (CloudyCouplingRestart):
+      // the results are valid, no first call
+      Cl_ncalls = Cl_cp.ncalls;
+      lg_first_call = false;
+      print1 ("> Cloudy: coupling state restored, next file #%d\n", Cl_ncalls);
     }
     else{
-      Cl_ncalls = 1;
+      DOM_LOOP(k,j,i){ // initialize the arrays
+        last_dn[k][j][i]  = d->Vc[DN][k][j][i];
+        last_pr[k][j][i]  = d->Vc[PR][k][j][i];
+        ray_last[k][j]    = counter;
+      }
+      // restart without coupling state: all rays are solved
+      // again and the file numbers continue at 100
+      Cl_ncalls = ( restart == YES ? 100:1 );
+    }
+    Cl_out_new = ( Cl_ncalls == 1 );  /* -- a new run starts a new cloudy.out -- */
+    
+    if ( ParQuery ("Cloudy_workers") ){
+      Cl_nworkers = MAX(1, atoi(ParGet("Cloudy_workers", 1)));
+    }
+    print1 ("> Cloudy: %d worker(s) per processor\n", Cl_nworkers);
+    
+    #ifdef PARALLEL
+     if ( ParQuery ("Cloudy_balance") ){
+       Cl_balance = ( strcmp(ParGet("Cloudy_balance", 1), "yes") == 0 ? YES:NO );
+     }
+     if ( Cl_balance ) print1 ("> Cloudy: rays are balanced between processors\n");
+    #else
+     Cl_balance = NO;
+    #endif
+    
+    CloudyOutputSettings();
+    
+    if ( ParQuery ("Cloudy_async") ){
+      Cl_async = ( strcmp(ParGet("Cloudy_async", 1), "yes") == 0 ? YES:NO );
+    }
+    if ( ParQuery ("Cloudy_max_lag") ){
+      Cl_max_lag = MAX(1, atoi(ParGet("Cloudy_max_lag", 1)));
+    }
+    if ( Cl_async ){
+      print1 ("> Cloudy: asynchronous solution, max. lag %d steps\n", Cl_max_lag);
+    }
+    #ifdef PARALLEL
+     if ( Cl_nworkers > 1 || Cl_async ){
+       print1 ("> Cloudy: workers are forked after MPI_Init, the MPI library must allow fork()\n");
+     }
+    #endif
+    
+    if ( ParQuery ("Cloudy_check_freq") ){
+      Cl_check_freq = MAX(1, atoi(ParGet("Cloudy_check_freq", 1)));
+    }
+    if ( ParQuery ("Cloudy_max_stale") ){
+      Cl_max_stale = MAX(0, atoi(ParGet("Cloudy_max_stale", 1)));
+    }
+    
+    if ( ParQuery ("Cloudy_warm_start") ){
+      Cl_warm_start = ( strcmp(ParGet("Cloudy_warm_start", 1), "yes") == 0 ? YES:NO );
+    }
+    if ( ParQuery ("Cloudy_warm_iter") ){
+      Cl_warm_iter = MAX(2, atoi(ParGet("Cloudy_warm_iter", 1)));
+    }
+    if ( Cl_warm_start ){
+      print1 ("> Cloudy: warm start, %d iterations per model\n", Cl_warm_iter);
     }
+    
+    if ( ParQuery ("Cloudy_implicit") ){
+      Cl_implicit = ( strcmp(ParGet("Cloudy_implicit", 1), "yes") == 0 ? YES:NO );
+    }
+    if ( Cl_implicit ){
+      print1 ("> Cloudy: implicit radiative heating\n");
+    }
+    
+    CloudyCacheInit();
   }
   
   /* ------------------------------------------
@@ -180,53 +598,124 @@ int CloudyRadSolve(Data *d, Time_Step *Dts, Grid *grid, int restart, int lg_last
   
 
   /* ------------------------------------------------------
-      Check if Cloudy must be called. True if:
-      a) convergence:
+      Check which rays (j,k) must be solved by Cloudy:
+      a) all rays at the first and the last call
+      b) convergence:
           not yet
-      b) evolve:
+      c) evolve, every Cl_check_freq calls:
          - if the 
                i) density
               ii) pressure
              iii) velocity (NOT YET)
-           at some point in the domain is
-           changed by more than CHANGE_FAKTOR
+           at some point of the ray is changed by more
+           than CHANGE_FAKTOR since its last solution
+      d) if the ray was not solved for Cl_max_stale calls
+      e) but not if the ray is found in the cache
      ------------------------------------------------------ */
+  /* ------------------------------------------------------
+      asynchronous mode: collect the running rays and apply
+      the new results when all processors are finished or
+      the maximum lag is reached. The first and last call
+      always wait for a synchronous solution.
+     ------------------------------------------------------ */
+  
+  static int lg_async_run = NO, async_lag = 0, async_counter;
+  
+  if ( lg_async_run ){
+    async_lag++;
+    int lg_wait = ( async_lag >= Cl_max_lag || lg_last_step );
+    CloudyTimerStart(CL_TM_RAYS);
+    int lg_done = CloudyRaysProgress(lg_wait);
+    CloudyTimerPause(CL_TM_RAYS);
+    #ifdef PARALLEL
+     int lgD1 = lg_done, lgD2 = 0;
+     CloudyTimerStart(CL_TM_MPI);
+     MPI_Allreduce ( &lgD1, &lgD2, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD );
+     CloudyTimerStop(CL_TM_MPI);
+     lg_done = lgD2;
+    #endif
+    if ( lg_done ){
+      CloudyTimerStart(CL_TM_RAYS);
+      Cl_success = CloudyRaysEnd();
+      CloudyTimerPause(CL_TM_RAYS);
+      CloudyTimerCount(CL_TM_RAYS, Cl_rt.nsolved);
+      if ( Cl_success != 0 ) { 
+        print1 ("\n! PROBLEM DISASTER in Cloudy -> Cannot continue\n\n");
+        QUIT_PLUTO(1);
+      }
+      print1 ("> Cloudy: results of file #%d applied after %d steps\n", Cl_ncalls-1, async_lag);
+      CloudySaveRayState(last_dn, last_pr, ray_last, async_counter);
+      lg_async_run = NO;
+    }
+  }
+  
+  CloudyTimerStart(CL_TM_CHECK);
+  KDOM_LOOP(k){
+    JDOM_LOOP(j){
+      ray_solve[k][j] = ( lg_first_call || lg_last_step );
+    }
+  }
+  
   #if ( CLOUDY_CONVERGE )
     
   #else
-    double max_fac_dn = 0;
-    double max_fac_pr = 0;
-    DOM_LOOP(k,j,i){
-      // density
-      fac = abs(last_dn[k][j][i]-d->Vc[DN][k][j][i])/MAX(last_dn[k][j][i],d->Vc[DN][k][j][i]);
-      if (fac > max_fac_dn)
-	max_fac_dn = fac;
-	    
-      if ( fac >= CHANGE_FAKTOR ) {
-        lg_solve_rad = true;
-      }
-      // pressure
-      fac = abs(last_pr[k][j][i]-d->Vc[PR][k][j][i])/MAX(last_pr[k][j][i],d->Vc[PR][k][j][i]);
-      if ( fac >= CHANGE_FAKTOR ) {
-        lg_solve_rad = true;
+    if ( counter % Cl_check_freq == 0 && !lg_async_run ){
+      KDOM_LOOP(k){
+        JDOM_LOOP(j){
+          if ( ray_solve[k][j] ) continue;
+          IDOM_LOOP(i){
+            // density
+            fac = abs(last_dn[k][j][i]-d->Vc[DN][k][j][i])/MAX(last_dn[k][j][i],d->Vc[DN][k][j][i]);
+            if ( fac >= CHANGE_FAKTOR ) {
+              ray_solve[k][j] = YES;
+              break;
+            }
+            // pressure
+            fac = abs(last_pr[k][j][i]-d->Vc[PR][k][j][i])/MAX(last_pr[k][j][i],d->Vc[PR][k][j][i]);
+            if ( fac >= CHANGE_FAKTOR ) {
+              ray_solve[k][j] = YES;
+              break;
+            }
+          }
+        }
       }
-      
-      if (fac > max_fac_pr)
-        max_fac_pr = fac;
-    };
-
-    if (counter % 1000 != 0) {
-      lg_solve_rad = false;                  
     }
-    //printf("max_fac_dn=%e, max_fac_pr=%e\n", max_fac_dn, max_fac_pr);
   #endif
   
+  KDOM_LOOP(k){
+    JDOM_LOOP(j){
+      if ( Cl_max_stale > 0 && counter - ray_last[k][j] >= Cl_max_stale && !lg_async_run ){
+        ray_solve[k][j] = YES;
+      }
+      /* -- e) the ray is completely found in the cache -- */
+      if ( ray_solve[k][j] && Cl_cache && !lg_first_call && !lg_last_step ){
+        if ( CloudyCacheSolveRay(d, grid, k, j) ){
+          ray_solve[k][j] = NO;
+          IDOM_LOOP(i){
+            last_dn[k][j][i] = d->Vc[DN][k][j][i];
+            last_pr[k][j][i] = d->Vc[PR][k][j][i];
+          }
+          ray_last[k][j] = counter;
+        }
+      }
+      if ( ray_solve[k][j] ) nray_solve++;
+    }
+  }
+  CloudyTimerStop(CL_TM_CHECK);
+  
+  /* -- all processors must agree on a call, since the 
+        file numbers and the barriers below are global -- */
+  
   #ifdef PARALLEL
-   int lgSC1 = lg_solve_rad;
-   int lgSC2 = 0;
-   MPI_Barrier ( MPI_COMM_WORLD );
-   MPI_Allreduce ( &lgSC1, &lgSC2, 1, MPI_LOGICAL, MPI_LOR, MPI_COMM_WORLD );
-   lg_solve_rad = lgSC2;
+   int nSC1 = nray_solve;
+   int nSC2 = 0;
+   CloudyTimerStart(CL_TM_MPI);
+   MPI_Allreduce ( &nSC1, &nSC2, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD );
+   CloudyTimerStop(CL_TM_MPI);
+   lg_solve_rad = ( nSC2 > 0 );
+  #else
+   int nSC2 = nray_solve;
+   lg_solve_rad = ( nray_solve > 0 );
   #endif
   
   if ( lg_solve_rad || lg_first_call || lg_last_step){
@@ -237,37 +726,45 @@ int CloudyRadSolve(Data *d, Time_Step *Dts, Grid *grid, int restart, int lg_last
           Cloudy computes along the 1st dimension
        ------------------------------------------------------ */
 
-    print1 ("> Cloudy: Solving Irradiation - file #%d \n", Cl_ncalls);
+    print1 ("> Cloudy: Solving Irradiation - file #%d (%d rays)\n", Cl_ncalls, nSC2);
     
-    KDOM_LOOP(k){
-      JDOM_LOOP(j){
-        Cl_success = CallCloudy(d, grid, Cl_ncalls, x1_dom_len, k, j, koff, joff, lg_last_step);
-        if ( Cl_success != 0 ) { 
-          print1 ("\n! PROBLEM DISASTER in Cloudy -> Cannot continue\n\n");
-          QUIT_PLUTO(1);
-        }
+    if ( Cl_async && !lg_first_call && !lg_last_step ){
+      CloudyTimerStart(CL_TM_RAYS);
+      CloudyRaysBegin(d, grid, ray_solve, Cl_ncalls, x1_dom_len, koff, joff, lg_last_step, YES);
+      CloudyTimerPause(CL_TM_RAYS);
+      lg_async_run  = YES;
+      async_lag     = 0;
+      async_counter = counter;
+    }else{
+      CloudyTimerStart(CL_TM_RAYS);
+      Cl_success = CloudySolveRays(d, grid, ray_solve, Cl_ncalls, x1_dom_len, koff, joff, lg_last_step);
+      CloudyTimerPause(CL_TM_RAYS);
+      CloudyTimerCount(CL_TM_RAYS, Cl_rt.nsolved);
+      if ( Cl_success != 0 ) { 
+        print1 ("\n! PROBLEM DISASTER in Cloudy -> Cannot continue\n\n");
+        QUIT_PLUTO(1);
       }
+      #ifdef PARALLEL
+       CloudyTimerStart(CL_TM_MPI);
+       MPI_Barrier (MPI_COMM_WORLD);  // all irradiation slices should be finished
+       CloudyTimerStop(CL_TM_MPI);
+      #endif
+      
+      CloudySaveRayState(last_dn, last_pr, ray_last, counter);
     }
-    #ifdef PARALLEL
-     MPI_Barrier (MPI_COMM_WORLD);  // all irradiation slices should be finished
-    #endif
     
-    /* ------------------------------------------------------
-        save the state for check on change/convergence
-       ------------------------------------------------------ */
-    
-    DOM_LOOP(k,j,i){
-      last_dn[k][j][i]  = d->Vc[DN][k][j][i];
-      last_pr[k][j][i]  = d->Vc[PR][k][j][i];
-    };
+    if ( Cl_cache && lg_last_step ) CloudyCacheWrite();
     
     Cl_ncalls ++;
-    if( !lg_first_call ){
-      lg_second_call = false;
-    }
     lg_first_call = false;
   }
   
+  /* ------------------------------------------------------
+      Update the rays which are not solved from the cache
+     ------------------------------------------------------ */
+  
+  if ( Cl_cache ) CloudyCacheRefresh(d, grid, ray_solve);
+  
   /* ------------------------------------------------------
       Apply the radiative heating/cooling
      ------------------------------------------------------ */
@@ -280,168 +777,1692 @@ int CloudyRadSolve(Data *d, Time_Step *Dts, Grid *grid, int restart, int lg_last
   
   RadiativeTimestep(d, Dts, lg_last_step);
   
+  Cl_cp.ncalls = Cl_ncalls;
+  #ifdef USE_HDF5
+   SetHDF5CloudyCall(Cl_ncalls - 1);  // attribute "cloudy_call" of the hdf5 output
+  #endif
+  CloudyTimerStop(CL_TM_CLOUDY);
   return Cl_success;
 }
 
 
-void RadiativeHeating(Data *d)
+int CloudySolveRays(Data *d, Grid *grid, int **ray_solve, int Cl_ncalls, double x1_dom_len, int koff, int joff, int lg_last_step)
 /*!
- * Apply the radiatvie heating/cooling
+ * Solve the selected rays (j,k) of the local domain
  * 
- * The userdef variable U_RAD_HEAT contains the
- * net heating-cooling (erg cm-3 s-1) computed in Cloudy.
- * This is applied in every hydro step.
+ * Starts the rays (CloudyRaysBegin), waits until all rays are
+ * solved (CloudyRaysProgress) and copies the results into the
+ * user defined variables (CloudyRaysEnd).
+ *
+ * \return 0 on success, the exit status of the failing model otherwise.
  *
- * \param  d  pointer to PLUTO Data structure;
- * 
  *********************************************************************** */
 {
-  int k, j, i;
-  double unitErg;
-  unitErg = g_unitDensity*pow(g_unitVelocity,3)/g_unitLength;
-  
-  double ***rad_heat;
-  rad_heat = GetUserVar("U_RAD_HEAT");
-  
-  DOM_LOOP(k,j,i){
-    d->Vc[PR][k][j][i] += rad_heat[k][j][i]*(g_gamma-1)*g_dt /unitErg;
-  };
-  
+  CloudyRaysBegin(d, grid, ray_solve, Cl_ncalls, x1_dom_len, koff, joff, lg_last_step, NO);
+  CloudyRaysProgress(YES);
+  return CloudyRaysEnd();
 }
 
-void RadiativeTimestep(Data *d,  Time_Step *Dts, int lg_last_step)
+void CloudyRaysBegin(Data *d, Grid *grid, int **ray_solve, int Cl_ncalls, double x1_dom_len,
+                     int koff, int joff, int lg_last_step, int lg_async)
 /*!
- * Control timestepping via Cooling/Heating rate
+ * Start the solution of the selected rays (j,k) of the local domain
  * 
- * The userdef variable U_RAD_HEAT contains the
- * net heating-cooling (erg cm-3 s-1) computed in Cloudy.
- * Energy may not change by more than 10 percent (TBD)
- *
- * \param  d  pointer to PLUTO Data structure;
- * \param  Dts    pointer to time Step structure;
+ * Only rays with ray_solve[k][j] set are computed, all other
+ * rays keep the user defined variables of their last solution.
  * 
+ * The rays are packed into a table of columns (CloudyPackRay),
+ * which is a snapshot of the hydro variables at this time.
+ * With Cl_balance the rays of all processors are distributed by
+ * the wall time of their last solution (CloudyBalanceRays) and
+ * the columns of the rays which are solved elsewhere are sent to
+ * their solver (collective). The rays of a processor are solved
+ * the longest first (CloudyTakeRay).
+ * 
+ * Cloudy keeps its state in global variables, so two models
+ * cannot run in threads of the same process. With Cl_nworkers > 1
+ * or lg_async the rays are therefore solved in forked child
+ * processes, which own a private copy of all Cloudy globals.
+ * The workers are started here (CloudyRaysStart), so with lg_async
+ * they solve the rays while this process continues with the hydro
+ * steps. The main output of a child goes to cloudy.NN.out
+ * (cloudy.RR.NN.out in parallel, RR = rank), where NN is the
+ * lowest number which is not used by a running child; only this
+ * process writes to cloudy.out.
+ * 
+ * The first ray of the first call is always solved in this process,
+ * so that the atomic data are loaded once
+ * and shared (copy on write) with all children.
+ * 
+ * Children do not make MPI calls, but the MPI transport must
+ * allow fork() (see CloudyRaysStart).
+ *
+ * \param [in] lg_async  YES if this process continues with the hydro
+ *                       steps while the rays are solved
+ *
  *********************************************************************** */
 {
-  int k, j, i;
-  double dtcool, coolheat;
-  double unitErg;
-  unitErg = g_unitDensity*pow(g_unitVelocity,3)/g_unitLength;
+  static bool lg_primed = false;
+  int j, k, n, ir;
+  int col_len = CL_NCOL_VARS*NX1_TOT;
+  int res_len = CL_NRAY_VARS*NX1_TOT;
+  Cl_RayTable *rt = &Cl_rt;
   
-  double ***rad_heat;
-  rad_heat = GetUserVar("U_RAD_HEAT");
+  rt->grid         = grid;
+  rt->Cl_ncalls    = Cl_ncalls;
+  rt->x1_dom_len   = x1_dom_len;
+  rt->lg_last_step = lg_last_step;
+  rt->success      = 0;
+  rt->nsolved      = 0;
+  rt->nactive      = 0;
+  rt->nrun         = 1;
+  rt->lg_fork      = ( Cl_nworkers > 1 || lg_async );
+  rt->nfork        = MAX(1, Cl_nworkers);
+  #ifdef PARALLEL
+   rt->lg_balance  = Cl_balance;
+  #else
+   rt->lg_balance  = NO;
+  #endif
   
-  dtcool = 1.e38;
-  DOM_LOOP(k,j,i){
-    coolheat = fabs(rad_heat[k][j][i]/unitErg);
-    if (coolheat > 0.0){
-      dtcool = MIN(dtcool, FRAC_COOL_TIMESTEP*d->Vc[PR][k][j][i]/(g_gamma-1)/coolheat);
+  /* ------------------------------------------
+      table of the local rays
+     ------------------------------------------ */
+  
+  rt->nloc = 0;
+  KDOM_LOOP(k){
+    JDOM_LOOP(j){
+      if ( !ray_solve[k][j] ) continue;
+      rt->nloc++;
     }
-  };
+  }
+  rt->nrays = rt->nloc;
+  rt->rbeg  = 0;
   
-  Dts->dt_cool = dtcool;
+  #ifdef PARALLEL
+   if ( rt->lg_balance ){
+     int nproc;
+     MPI_Comm_size (MPI_COMM_WORLD, &nproc);
+     if ( rt->cnt == NULL ){
+       rt->cnt   = ARRAY_1D(nproc, int);
+       rt->displ = ARRAY_1D(nproc, int);
+       MPI_Comm_dup (MPI_COMM_WORLD, &rt->comm);
+     }
+     CloudyTimerStart(CL_TM_MPI);
+     MPI_Allgather (&rt->nloc, 1, MPI_INT, rt->cnt, 1, MPI_INT, rt->comm);
+     CloudyTimerStop(CL_TM_MPI);
+     rt->nrays = 0;
+     for (n = 0; n < nproc; n++){
+       rt->displ[n] = rt->nrays;
+       rt->nrays   += rt->cnt[n];
+     }
+     rt->rbeg = rt->displ[prank];
+   }
+  #endif
+  
+  /* -- the tables only grow, rays are never removed -- */
+  
+  if ( rt->nrays > rt->nalloc ){
+    if ( rt->nalloc > 0 ){
+      FreeArray1D(rt->ray_j);  FreeArray1D(rt->ray_k);
+      FreeArray1D(rt->ray_jg); FreeArray1D(rt->ray_kg);
+      FreeArray1D(rt->col);    FreeArray1D(rt->res);
+      FreeArray1D(rt->proc);   FreeArray1D(rt->cost);
+      FreeArray1D(rt->list);
+    }
+    rt->nalloc = MAX(rt->nrays, NX2_TOT*NX3_TOT);
+    rt->ray_j  = ARRAY_1D(rt->nalloc, int);
+    rt->ray_k  = ARRAY_1D(rt->nalloc, int);
+    rt->ray_jg = ARRAY_1D(rt->nalloc, int);
+    rt->ray_kg = ARRAY_1D(rt->nalloc, int);
+    rt->col    = ARRAY_1D(rt->nalloc*col_len, double);
+    rt->res    = ARRAY_1D(rt->nalloc*res_len, double);
+    rt->proc   = ARRAY_1D(rt->nalloc, int);
+    rt->cost   = ARRAY_1D(rt->nalloc, double);
+    rt->list   = ARRAY_1D(rt->nalloc, int);
+  }
+  if ( rt->pid == NULL ){
+    rt->pid  = ARRAY_1D(rt->nfork, pid_t);
+    rt->fd   = ARRAY_1D(rt->nfork, int);
+    rt->wid  = ARRAY_1D(rt->nfork, int);
+    rt->wused = ARRAY_1D(rt->nfork, int);
+    for (n = 0; n < rt->nfork; n++) rt->wused[n] = ( Cl_ncalls > 1 );  /* -- append after a restart -- */
+    rt->pfd  = ARRAY_1D(rt->nfork, struct pollfd);
+    rt->qnext = (int *)mmap(NULL, sizeof(int), PROT_READ | PROT_WRITE,
+                            MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if ( rt->qnext == MAP_FAILED ){
+      print1 ("! CloudyRaysBegin: cannot map the ray queue\n");
+      QUIT_PLUTO(1);
+    }
+    rt->ray_cost = ARRAY_2D(NX3_TOT, NX2_TOT, double);
+    for (k = 0; k < NX3_TOT; k++){
+      for (j = 0; j < NX2_TOT; j++) rt->ray_cost[k][j] = 0.0;
+    }
+  }
+  
+  ir = rt->rbeg;
+  KDOM_LOOP(k){
+    JDOM_LOOP(j){
+      if ( !ray_solve[k][j] ) continue;
+      rt->ray_j[ir]  = j;
+      rt->ray_k[ir]  = k;
+      rt->ray_jg[ir] = j-JBEG+joff;
+      rt->ray_kg[ir] = k-KBEG+koff;
+      rt->proc[ir]   = prank;
+      /* -- a ray which was never solved here counts as 1 s -- */
+      rt->cost[ir]   = ( rt->ray_cost[k][j] > 0.0 ? rt->ray_cost[k][j]:1.0 );
+      CloudyPackRay(d, k, j, rt->col + ir*col_len);
+      ir++;
+    }
+  }
+  
+  #ifdef PARALLEL
+   if ( rt->lg_balance ) CloudyBalanceRays();
+  #endif
+  
+  rt->nlist = 0;
+  for (ir = 0; ir < rt->nrays; ir++){
+    if ( rt->proc[ir] == prank ) rt->list[rt->nlist++] = ir;
+  }
+  qsort (rt->list, rt->nlist, sizeof(int), CloudyCostCmp);
+  *rt->qnext = 0;
   
   /* ------------------------------------------
-      print warning if advection should be
-      included
+      serial solution in this process
      ------------------------------------------ */
-  #if ( !USE_ADVEC )
-    if ( g_stepNumber%1000 == 0 || lg_last_step){
-      int lg_advec_rec, lg_advec_mol;
-      double ***hd_time, ***hrec_time, ***hmol_time;
-      hd_time = GetUserVar("U_HD_TIME");
-      hrec_time = GetUserVar("U_HREC_TIME");
-      hmol_time = GetUserVar("U_HMOL_TIME");
-    
-      lg_advec_rec = 0;
-      lg_advec_mol = 0;
-      DOM_LOOP(k,j,i){
-         if( hrec_time[k][j][i]>0.0 && hrec_time[k][j][i]>hd_time[k][j][i]){
-           lg_advec_rec = 1;
-         };
-         if( hmol_time[k][j][i]>0.0 && hmol_time[k][j][i]>hd_time[k][j][i]){
-           lg_advec_mol = 1;
-         };
-      };
-      
-      if( lg_advec_rec ){
-        print1 ("! WARNING: H recombination timescale is longer than the HD timescale.\n");
-        print1 ("!          Please consider using advection!\n");
-      }
-      if( lg_advec_mol ){
-        print1 ("! WARNING: Molecular timescales could be longer than the HD timescale.\n");
-        print1 ("!          Please consider using advection!\n");
-      }
+  
+  if ( !rt->lg_fork || !lg_primed ){
+    while ( rt->success == 0 && (ir = CloudyTakeRay()) >= 0 ){
+      double t0 = CloudyClock();
+      rt->success = CallCloudy(grid, rt->col + ir*col_len, rt->res + ir*res_len, Cl_ncalls, x1_dom_len,
+                               rt->ray_jg[ir], rt->ray_kg[ir], lg_last_step);
+      rt->cost[ir] = CloudyClock() - t0;
+      if ( rt->success == 0 ) rt->nsolved++;
+      lg_primed = true;
+      if ( rt->lg_fork ) break;
     }
-  #endif
+    if ( !rt->lg_fork ) rt->nrun = 0;
+  }
+  
+  if ( rt->lg_fork ) CloudyRaysStart();
 }
 
+void CloudyRaysStart()
+/*!
+ * Start worker processes for the next rays of the table
+ * 
+ * Up to Cl_nworkers workers run at the same time. A worker takes
+ * further rays (CloudyTakeRay) until the list of this processor is
+ * empty, so the rays are solved without this process.
+ * A worker sends the index, the wall time, the resulting user
+ * defined variables and the timers of each ray through a pipe and
+ * exits with the status of the failing model.
+ * 
+ * The workers are forked after MPI_Init. They make no MPI calls,
+ * but fork() is undefined with some MPI transports which register
+ * memory with the network card (InfiniBand verbs, UCX). Parallel
+ * runs with Cl_nworkers > 1 or Cl_async need a transport which
+ * allows fork() (e.g. shared memory and TCP, OpenMPI: --mca btl
+ * self,vader,tcp --mca mpi_warn_on_fork 0).
+ *
+ *********************************************************************** */
+{
+  int ir, status;
+  int col_len = CL_NCOL_VARS*NX1_TOT;
+  int res_len = CL_NRAY_VARS*NX1_TOT;
+  Cl_RayTable *rt = &Cl_rt;
+  
+  if ( rt->success != 0 ){  /* -- drain, do not start new rays -- */
+    rt->nrun = 0;
+    __sync_lock_test_and_set(rt->qnext, rt->nlist);
+    return;
+  }
+  
+  while ( rt->nrun && rt->nactive < rt->nfork ){
+    if ( (ir = CloudyTakeRay()) < 0 ){
+      rt->nrun = 0;
+      break;
+    }
+    int pp[2];
+    if ( pipe(pp) != 0 ){
+      print1 ("! CloudyRaysStart: cannot create pipe\n");
+      QUIT_PLUTO(1);
+    }
+    /* -- the lowest output file number which is not in use -- */
+    int wid, m;
+    for (wid = 0; wid < rt->nfork; wid++){
+      for (m = 0; m < rt->nactive; m++) if ( rt->wid[m] == wid ) break;
+      if ( m == rt->nactive ) break;
+    }
+    fflush (NULL);
+    rt->pid[rt->nactive] = fork();
+    if ( rt->pid[rt->nactive] < 0 ){
+      print1 ("! CloudyRaysStart: cannot fork worker process\n");
+      QUIT_PLUTO(1);
+    }
+    if ( rt->pid[rt->nactive] == 0 ){  /* -- child: solve, send, exit -- */
+      close (pp[0]);
+      #ifdef PARALLEL
+       sprintf (Cl_out_file, "cloudy.%02d.%02d.out", prank, wid);
+      #else
+       sprintf (Cl_out_file, "cloudy.%02d.out", wid);
+      #endif
+      Cl_out_new = !rt->wused[wid];
+      do{
+        double t0 = CloudyClock();
+        memset (Cl_tm + CL_TM_RAY, 0, CL_NTM_RAY*sizeof(Cl_Timer));
+        status = CallCloudy(rt->grid, rt->col + ir*col_len, rt->res + ir*res_len, rt->Cl_ncalls,
+                            rt->x1_dom_len, rt->ray_jg[ir], rt->ray_kg[ir], rt->lg_last_step);
+        rt->cost[ir] = CloudyClock() - t0;
+        if ( status == 0 ){
+          if ( CloudyPipeWrite(pp[1], &ir, sizeof(int)) != 0 ||
+               CloudyPipeWrite(pp[1], rt->cost + ir, sizeof(double)) != 0 ||
+               CloudyPipeWrite(pp[1], rt->res + ir*res_len, res_len*sizeof(double)) != 0 ||
+               CloudyPipeWrite(pp[1], Cl_tm + CL_TM_RAY, CL_NTM_RAY*sizeof(Cl_Timer)) != 0 ){
+            status = 1;
+          }
+        }
+      }while ( status == 0 && (ir = CloudyTakeRay()) >= 0 );
+      close (pp[1]);
+      fflush (NULL);
+      _exit (status);
+    }
+    close (pp[1]);
+    rt->fd[rt->nactive]  = pp[0];
+    rt->wid[rt->nactive] = wid;
+    rt->wused[wid]       = YES;
+    rt->nactive++;
+  }
+}
 
-int CallCloudy(Data *d, Grid *grid, int Cl_ncalls, double x1_dom_len, int Pl_k, int Pl_j, int koff, int joff, int lg_last_step)
+int CloudyRaysProgress(int lg_wait)
 /*!
- * Initialize + start Cloudy
- * (developed from Cloudy template)
+ * Collect the rays solved by the worker processes
  * 
- * - creates the Cloudy input script
- * - executes Cloudy
- * - retrieves the results and saves them
- * - catches all possible errors
+ * The results are read from the pipes of the workers, finished
+ * workers are collected and new workers are started for the
+ * rays which are left (CloudyRaysStart).
  *
- * \param  d      pointer to PLUTO Data structure;
- * \param  Dts    pointer to time Step structure;
- * \param  grid   pointer to grid structure.
+ * \param [in] lg_wait  YES: return when all rays are solved,
+ *                      NO: return immediately
  *
- * \return An integer giving success / failure of the Cloudy run.
+ * \return 1 if all rays of this process are solved, 0 otherwise.
  *
  *********************************************************************** */
 {
-  exit_type exit_status = ES_SUCCESS;
-
-  DEBUG_ENTRY( "main()" );
-
-  try {
-
-    bool Cl_lgAbort;
-    long Cl_nw , Cl_nc , Cl_nn , Cl_ns , Cl_nte , Cl_npe , Cl_nione, Cl_neden;
-    int i;
-    
-    /* ------------------------------------------------------
-        initialize Cloudy
-       ------------------------------------------------------ */
-    
-    cdInit();
+  int n, ir, status;
+  size_t left;
+  int res_len = CL_NRAY_VARS*NX1_TOT;
+  Cl_RayTable *rt = &Cl_rt;
+  
+  while ( rt->nrun || rt->nactive > 0 ){
     
-    /* ------------------------------------------------------
-        generate the input script
-       ------------------------------------------------------ */
+    CloudyRaysStart();
+    if ( rt->nactive == 0 ) break;
     
-    CloudyInputScript(d, grid, Cl_ncalls, x1_dom_len, Pl_k, Pl_j, koff, joff, lg_last_step);
+    for (n = 0; n < rt->nactive; n++){
+      rt->pfd[n].fd      = rt->fd[n];
+      rt->pfd[n].events  = POLLIN;
+      rt->pfd[n].revents = 0;
+    }
+    n = poll(rt->pfd, rt->nactive, (lg_wait ? -1:0));
+    if ( n == 0 && !lg_wait ) break;
+    if ( n < 0 ) continue;
     
-    /* ------------------------------------------------------
-        execute the input script from above
-       ------------------------------------------------------ */
-    printf("I'm here3\n");  
-    if( cdDrive() )
+    for (n = rt->nactive-1; n >= 0; n--){
+      if ( rt->pfd[n].revents == 0 ) continue;
+      
+      /* -- a solved ray: index, wall time, results, timers -- */
+      
+      Cl_Timer tm[CL_NTM_RAY];
+      left = CloudyPipeRead(rt->fd[n], &ir, sizeof(int));
+      if ( left == 0 ){
+        left = ( ir >= 0 && ir < rt->nrays ? 
+                 CloudyPipeRead(rt->fd[n], rt->cost + ir, sizeof(double)):1 );
+        if ( left == 0 ) left = CloudyPipeRead(rt->fd[n], rt->res + ir*res_len, res_len*sizeof(double));
+        if ( left == 0 ) left = CloudyPipeRead(rt->fd[n], tm, CL_NTM_RAY*sizeof(Cl_Timer));
+        if ( left == 0 ){
+          CloudyTimerMerge(tm, CL_TM_RAY, CL_TM_MAP);
+          rt->nsolved++;
+          continue;
+        }
+      }
+      
+      /* -- end of file: the worker has finished or failed -- */
+      
+      close (rt->fd[n]);
+      waitpid (rt->pid[n], &status, 0);
+      
+      if ( left != sizeof(int) || !WIFEXITED(status) || WEXITSTATUS(status) != 0 ){
+        if ( rt->success == 0 ){
+          rt->success = ( WIFEXITED(status) && WEXITSTATUS(status) != 0 ? WEXITSTATUS(status):1 );
+        }
+      }
+      
+      rt->nactive--;
+      rt->pid[n] = rt->pid[rt->nactive];
+      rt->fd[n]  = rt->fd[rt->nactive];
+      rt->wid[n] = rt->wid[rt->nactive];
+    }
+  }
+  
+  return ( rt->nrun == 0 && rt->nactive == 0 );
+}
+
+int CloudyRaysEnd()
+/*!
+ * Finish the solution of the rays
+ * 
+ * With Cl_balance the results and wall times of the rays which
+ * were solved for another processor are sent back to their owner
+ * (collective). Each processor copies the results of its own rays
+ * into the user defined variables (CloudyUnpackRay) and keeps the
+ * wall time for the next distribution.
+ * With Cl_binary all rays are written to one file.
+ * All rays must be solved (CloudyRaysProgress).
+ *
+ * \return 0 on success, the exit status of the failing model otherwise.
+ *
+ *********************************************************************** */
+{
+  int ir;
+  int res_len = CL_NRAY_VARS*NX1_TOT;
+  Cl_RayTable *rt = &Cl_rt;
+  
+  #ifdef PARALLEL
+   if ( rt->lg_balance ){
+     int lgS1 = rt->success, lgS2 = 0;
+     CloudyTimerStart(CL_TM_MPI);
+     MPI_Allreduce (&lgS1, &lgS2, 1, MPI_INT, MPI_MAX, rt->comm);
+     CloudyTimerStop(CL_TM_MPI);
+     rt->success = lgS2;
+     if ( rt->success == 0 ) CloudyExchangeRays(YES);
+   }
+  #endif
+  
+  if ( rt->success == 0 ){
+    for (ir = rt->rbeg; ir < rt->rbeg+rt->nloc; ir++){
+      CloudyUnpackRay(rt->ray_k[ir], rt->ray_j[ir], rt->res + ir*res_len);
+      rt->ray_cost[rt->ray_k[ir]][rt->ray_j[ir]] = rt->cost[ir];
+    }
+    if ( Cl_binary ) CloudyWriteBinary();
+    
+    /* -- own rays and rays solved here -- */
+    if ( Cl_cache ){
+      for (ir = 0; ir < rt->nrays; ir++){
+        if ( rt->proc[ir] != prank && (ir < rt->rbeg || ir >= rt->rbeg+rt->nloc) ) continue;
+        CloudyCacheStore(rt->grid, rt->col + ir*CL_NCOL_VARS*NX1_TOT, rt->res + ir*res_len);
+      }
+    }
+  }
+  
+  return rt->success;
+}
+
+#ifdef PARALLEL
+void CloudyBalanceRays()
+/*!
+ * Distribute the rays of all processors by their wall time
+ * (collective)
+ *
+ * The global indices and the wall times of all rays are gathered,
+ * so that every processor computes the same distribution: a
+ * processor keeps its own rays, the longest first, as long as its
+ * work stays below the mean (at least its longest ray); the other
+ * rays go, the longest first, to the processor with the least work.
+ * The columns of the rays are then sent to their solver
+ * (CloudyExchangeRays).
+ *
+ *********************************************************************** */
+{
+  int n, m, p, ir, nproc, npool = 0;
+  double mean = 0.0, *load;
+  int *order;
+  Cl_RayTable *rt = &Cl_rt;
+  
+  MPI_Comm_size (rt->comm, &nproc);
+  
+  CloudyTimerStart(CL_TM_MPI);
+  MPI_Allgatherv (MPI_IN_PLACE, 0, MPI_DATATYPE_NULL, rt->ray_jg, rt->cnt, rt->displ, MPI_INT, rt->comm);
+  MPI_Allgatherv (MPI_IN_PLACE, 0, MPI_DATATYPE_NULL, rt->ray_kg, rt->cnt, rt->displ, MPI_INT, rt->comm);
+  MPI_Allgatherv (MPI_IN_PLACE, 0, MPI_DATATYPE_NULL, rt->cost, rt->cnt, rt->displ, MPI_DOUBLE, rt->comm);
+  CloudyTimerStop(CL_TM_MPI);
+  
+  load  = ARRAY_1D(nproc, double);
+  order = ARRAY_1D(MAX(1, rt->nrays), int);
+  
+  for (ir = 0; ir < rt->nrays; ir++) mean += rt->cost[ir];
+  mean /= nproc;
+  
+  /* -- own rays up to the mean work -- */
+  
+  for (p = 0; p < nproc; p++){
+    load[p] = 0.0;
+    for (n = 0; n < rt->cnt[p]; n++) order[n] = rt->displ[p] + n;
+    qsort (order, rt->cnt[p], sizeof(int), CloudyCostCmp);
+    for (n = 0; n < rt->cnt[p]; n++){
+      ir = order[n];
+      if ( n == 0 || load[p] + rt->cost[ir] <= mean ){
+        rt->proc[ir] = p;
+        load[p]     += rt->cost[ir];
+      }else rt->proc[ir] = -1;
+    }
+  }
+  
+  /* -- the rest to the processor with the least work -- */
+  
+  for (ir = 0; ir < rt->nrays; ir++){
+    if ( rt->proc[ir] < 0 ) order[npool++] = ir;
+  }
+  qsort (order, npool, sizeof(int), CloudyCostCmp);
+  for (n = 0; n < npool; n++){
+    ir = order[n];
+    for (p = m = 0; p < nproc; p++) if ( load[p] < load[m] ) m = p;
+    rt->proc[ir] = m;
+    load[m]     += rt->cost[ir];
+  }
+  
+  FreeArray1D(load);
+  FreeArray1D(order);
+  
+  CloudyExchangeRays(NO);
+}
+
+void CloudyExchangeRays(int lg_results)
+/*!
+ * Exchange the rays which are solved by another processor than
+ * their owner, point to point (collective)
+ *
+ * Messages are only sent between processors which share rays, in
+ * the order of the table on both sides.
+ *
+ * \param [in] lg_results  NO: send the columns of the own rays to
+ *                         their solver, YES: send the results and
+ *                         wall times of the rays solved here to
+ *                         their owner
+ *
+ *********************************************************************** */
+{
+  int p, ir, nproc, nreq = 0, ns = 0, nr = 0, s0, r0;
+  int col_len = CL_NCOL_VARS*NX1_TOT;
+  int res_len = CL_NRAY_VARS*NX1_TOT;
+  int len     = ( lg_results ? res_len+1:col_len );
+  double *sbuf, *rbuf;
+  MPI_Request *req;
+  Cl_RayTable *rt = &Cl_rt;
+  
+  MPI_Comm_size (rt->comm, &nproc);
+  
+  /* -- own rays solved elsewhere and rays of others solved here -- */
+  
+  for (ir = 0; ir < rt->nrays; ir++){
+    int lg_own = ( ir >= rt->rbeg && ir < rt->rbeg+rt->nloc );
+    if (  lg_own && rt->proc[ir] != prank ) ns++;
+    if ( !lg_own && rt->proc[ir] == prank ) nr++;
+  }
+  if ( lg_results ){
+    p = ns; ns = nr; nr = p;
+  }
+  sbuf = ARRAY_1D(MAX(1, ns*len), double);
+  rbuf = ARRAY_1D(MAX(1, nr*len), double);
+  req  = ARRAY_1D(2*nproc, MPI_Request);
+  
+  CloudyTimerStart(CL_TM_MPI);
+  ns = nr = 0;
+  for (p = 0; p < nproc; p++){
+    if ( p == prank ) continue;
+    s0 = ns;
+    r0 = nr;
+    for (ir = rt->rbeg; ir < rt->rbeg+rt->nloc; ir++){   /* -- own rays solved by p -- */
+      if ( rt->proc[ir] != p ) continue;
+      if ( !lg_results ) memcpy (sbuf + (ns++)*len, rt->col + ir*col_len, col_len*sizeof(double));
+      else nr++;
+    }
+    for (ir = rt->displ[p]; ir < rt->displ[p]+rt->cnt[p]; ir++){   /* -- rays of p solved here -- */
+      if ( rt->proc[ir] != prank ) continue;
+      if ( lg_results ){
+        memcpy (sbuf + ns*len, rt->res + ir*res_len, res_len*sizeof(double));
+        sbuf[ns*len + res_len] = rt->cost[ir];
+        ns++;
+      }else nr++;
+    }
+    if ( ns > s0 ) MPI_Isend (sbuf + s0*len, (ns-s0)*len, MPI_DOUBLE, p, 0, rt->comm, req + nreq++);
+    if ( nr > r0 ) MPI_Irecv (rbuf + r0*len, (nr-r0)*len, MPI_DOUBLE, p, 0, rt->comm, req + nreq++);
+  }
+  MPI_Waitall (nreq, req, MPI_STATUSES_IGNORE);
+  CloudyTimerStop(CL_TM_MPI);
+  
+  /* -- unpack in the same order -- */
+  
+  nr = 0;
+  for (p = 0; p < nproc; p++){
+    if ( p == prank ) continue;
+    if ( lg_results ){
+      for (ir = rt->rbeg; ir < rt->rbeg+rt->nloc; ir++){
+        if ( rt->proc[ir] != p ) continue;
+        memcpy (rt->res + ir*res_len, rbuf + nr*len, res_len*sizeof(double));
+        rt->cost[ir] = rbuf[nr*len + res_len];
+        nr++;
+      }
+    }else{
+      for (ir = rt->displ[p]; ir < rt->displ[p]+rt->cnt[p]; ir++){
+        if ( rt->proc[ir] != prank ) continue;
+        memcpy (rt->col + ir*col_len, rbuf + nr*len, col_len*sizeof(double));
+        nr++;
+      }
+    }
+  }
+  
+  FreeArray1D(sbuf);
+  FreeArray1D(rbuf);
+  FreeArray1D(req);
+}
+#endif
+
+int CloudyCostCmp(const void *a, const void *b)
+/*!
+ * Order of two rays of the table Cl_rt for qsort: the longest
+ * wall time first, then the lower index
+ *
+ *********************************************************************** */
+{
+  int ia = *(const int *)a, ib = *(const int *)b;
+  
+  if ( Cl_rt.cost[ia] != Cl_rt.cost[ib] ) return ( Cl_rt.cost[ia] > Cl_rt.cost[ib] ? -1:1 );
+  return ( ia < ib ? -1:(ia > ib) );
+}
+
+void CloudySaveRayState(double ***last_dn, double ***last_pr, int **ray_last, int Cl_counter)
+/*!
+ * Save the state of the solved rays for the check on
+ * change/convergence
+ *
+ * The density and pressure are taken from the columns of the
+ * ray table, i.e. the hydro state which was passed to Cloudy.
+ *
+ * \param [out] last_dn     density of the last solution
+ * \param [out] last_pr     pressure of the last solution
+ * \param [out] ray_last    call counter of the last solution
+ * \param [in]  Cl_counter  call counter at the start of the solution
+ *
+ *********************************************************************** */
+{
+  int i, ir;
+  double *col;
+  Cl_RayTable *rt = &Cl_rt;
+  
+  for (ir = rt->rbeg; ir < rt->rbeg+rt->nloc; ir++){
+    col = rt->col + ir*CL_NCOL_VARS*NX1_TOT;
+    IDOM_LOOP(i){
+      last_dn[rt->ray_k[ir]][rt->ray_j[ir]][i] = col[CL_COL_RHO*NX1_TOT + i];
+      last_pr[rt->ray_k[ir]][rt->ray_j[ir]][i] = col[CL_COL_PRS*NX1_TOT + i];
+    }
+    ray_last[rt->ray_k[ir]][rt->ray_j[ir]] = Cl_counter;
+  }
+}
+
+void CloudyCouplingAlloc()
+/*!
+ * Allocate the arrays of the coupling state (see Cl_Coupling)
+ *
+ *********************************************************************** */
+{
+  if ( Cl_cp.last_dn != NULL ) return;
+  Cl_cp.last_dn  = ARRAY_3D(NX3_TOT, NX2_TOT, NX1_TOT, double);
+  Cl_cp.last_pr  = ARRAY_3D(NX3_TOT, NX2_TOT, NX1_TOT, double);
+  Cl_cp.buf      = ARRAY_3D(NX3_TOT, NX2_TOT, NX1_TOT, double);
+  Cl_cp.ray_last = ARRAY_2D(NX3_TOT, NX2_TOT, int);
+}
+
+void CloudyCouplingIO(int nfile, char *mode, int swap_endian)
+/*!
+ * Write or read the arrays of the coupling state to/from 
+ * cl_coupling.NNNN.dbl, same layout as a single_file dbl output
+ * with the three variables last_dn, last_pr and ray_last.
+ *
+ * \param [in] nfile        number of the dbl output
+ * \param [in] mode         "w" or "r"
+ * \param [in] swap_endian  swap the bytes when reading
+ *
+ *********************************************************************** */
+{
+  int n;
+  char fname[64];
+  double ***V[3] = {Cl_cp.last_dn, Cl_cp.last_pr, Cl_cp.buf};
+  FILE *fbin;
+  
+  sprintf (fname, "cl_coupling.%04d.dbl", nfile);
+  #ifdef PARALLEL
+   long long offset = 0;
+  #else
+   fbin = OpenBinaryFile (fname, 0, mode);
+  #endif
+  for (n = 0; n < 3; n++){
+    #ifdef PARALLEL
+     fbin = OpenBinaryFile (fname, SZ, mode);
+     AL_Set_offset(SZ, offset);
+    #endif
+    if ( mode[0] == 'w' ){
+      WriteBinaryArray ((void *)V[n][0][0], sizeof(double), SZ, fbin, -1);
+    }else{
+      ReadBinaryArray ((void *)V[n][0][0], sizeof(double), SZ, fbin, -1, swap_endian);
+    }
+    #ifdef PARALLEL
+     offset = AL_Get_offset(SZ);
+     CloseBinaryFile(fbin, SZ);
+    #endif
+  }
+  #ifndef PARALLEL
+   CloseBinaryFile(fbin, SZ);
+  #endif
+}
+
+void CloudyCouplingDump(int nfile)
+/*!
+ * Write the coupling state together with a restart dump
+ * (called from CheckForOutput after RestartDump).
+ * Nothing is written before the first call of Cloudy, a restart
+ * from such a file solves all rays.
+ *
+ * \param [in] nfile  number of the dbl output
+ *
+ *********************************************************************** */
+{
+  int k, j, i;
+  FILE *fst;
+  
+  if ( Cl_cp.last_dn == NULL ) return;
+  
+  DOM_LOOP(k,j,i){
+    Cl_cp.buf[k][j][i] = Cl_cp.ray_last[k][j];
+  }
+  CloudyCouplingIO(nfile, (char *)"w", NO);
+  
+  if ( prank == 0 ){
+    fst = fopen(CL_COUPLING_FILE, "a");
+    fprintf (fst, "%d  %d  %d  %s\n", nfile, Cl_cp.ncalls, counter,
+             ( IsLittleEndian() ? "little":"big" ));
+    fclose(fst);
+  }
+}
+
+int CloudyCouplingRestart(Input *ini, int nrestart, int type)
+/*!
+ * Read the coupling state of the restart file nrestart, so that
+ * the first call of CloudyRadSolve does not solve all rays and
+ * the mean molecular weight is not reset.
+ * The state is only used if the results of Cloudy (Cl_ray_vars)
+ * were dumped to the restart file and, for dbl.h5, have been read
+ * back by ReadHDF5 (QueryHDF5Var).
+ *
+ * \param [in] ini       pointer to the Input structure
+ * \param [in] nrestart  number of the restart file
+ * \param [in] type      DBL_OUTPUT or DBL_H5_OUTPUT
+ *
+ * \return YES if the state was restored, NO otherwise.
+ *
+ *********************************************************************** */
+{
+  int k, j, i, n, nv, lg_read;
+  int st[4] = {0, 0, 0, 0};   /* found, ncalls, counter, swap_endian */
+  int nf, nc, cnt;
+  char str[512], endian[32];
+  Output *output;
+  FILE *fst;
+  
+  for (n = 0; n < MAX_OUTPUT_TYPES; n++){
+    output = ini->output + n;
+    if (output->type == type) break;
+  }
+  for (n = 0; n < CL_NRAY_VARS; n++){
+    for (nv = 0; nv < output->nvar; nv++){
+      if ( strcmp(output->var_name[nv], Cl_ray_vars[n]) == 0 ) break;
+    }
+    if ( nv == output->nvar || !output->dump_var[nv] ){
+      print1 ("> Cloudy: %s not in the restart file, all rays are solved\n", Cl_ray_vars[n]);
+      return NO;
+    }
+    /* -- a dbl.h5 file may have been written without the user variables -- */
+    if ( type == DBL_H5_OUTPUT ){
+      #ifdef USE_HDF5
+       lg_read = QueryHDF5Var(output, (char *)Cl_ray_vars[n]);
+      #else
+       lg_read = NO;
+      #endif
+      if ( !lg_read ){
+        print1 ("> Cloudy: %s not read from the restart file, all rays are solved\n", Cl_ray_vars[n]);
+        return NO;
+      }
+    }
+  }
+  
+  /* -- the last entry of the restart file in CL_COUPLING_FILE -- */
+  
+  if ( prank == 0 ){
+    fst = fopen(CL_COUPLING_FILE, "r");
+    if ( fst != NULL ){
+      while ( fgets(str, 512, fst) != NULL ){
+        if ( sscanf(str, "%d %d %d %31s", &nf, &nc, &cnt, endian) != 4 ) continue;
+        if ( nf != nrestart ) continue;
+        st[0] = YES;
+        st[1] = nc;
+        st[2] = cnt;
+        st[3] = ( (strcmp(endian, "big") == 0) == IsLittleEndian() );
+      }
+      fclose(fst);
+    }
+  }
+  #ifdef PARALLEL
+   MPI_Bcast (st, 4, MPI_INT, 0, MPI_COMM_WORLD);
+  #endif
+  if ( !st[0] ){
+    print1 ("> Cloudy: no coupling state of file #%d, all rays are solved\n", nrestart);
+    return NO;
+  }
+  
+  CloudyCouplingAlloc();
+  CloudyCouplingIO(nrestart, (char *)"r", st[3]);
+  DOM_LOOP(k,j,i){
+    Cl_cp.ray_last[k][j] = (int)Cl_cp.buf[k][j][i];
+  }
+  Cl_cp.ncalls     = st[1];
+  Cl_cp.lg_restart = YES;
+  counter          = st[2];
+  return YES;
+}
+
+int CloudyTakeRay()
+/*!
+ * Take the next ray of this processor from the table Cl_rt
+ *
+ * The rays of the list are handed out by a counter in memory
+ * which is shared with the workers (CloudyRaysStart), so that a
+ * worker takes its next ray as soon as it is free, without this
+ * process.
+ *
+ * \return index of the next ray, -1 if all rays are handed out.
+ *
+ *********************************************************************** */
+{
+  Cl_RayTable *rt = &Cl_rt;
+  int n;
+  
+  n = __sync_fetch_and_add(rt->qnext, 1);
+  return ( n < rt->nlist ? rt->list[n]:-1 );
+}
+
+void CloudyFinalize()
+/*!
+ * Release the resources of the ray dispatch before MPI_Finalize.
+ * Must be called by all processors.
+ *
+ *********************************************************************** */
+{
+  if ( Cl_rt.qnext != NULL ) munmap (Cl_rt.qnext, sizeof(int));
+  Cl_rt.qnext = NULL;
+  #ifdef PARALLEL
+   if ( Cl_rt.cnt != NULL ) MPI_Comm_free (&Cl_rt.comm);
+  #endif
+}
+
+void CloudyOutputSettings()
+/*!
+ * Read the output settings of the Cloudy models from pluto.ini
+ *
+ * - Cloudy_print_freq  n
+ * - Cloudy_save        n  type1 ... typen   (or 0 for no save files)
+ * - Cloudy_save_last   yes/no
+ * - Cloudy_binary      yes/no
+ *
+ *********************************************************************** */
+{
+  int n, m, nsave;
+  
+  for (n = 0; n < CL_NSAVE_TYPES; n++) Cl_save[n] = atoi(Cl_save_types[n][2]);
+  
+  if ( ParQuery ("Cloudy_print_freq") ){
+    Cl_print_freq = MAX(0, atoi(ParGet("Cloudy_print_freq", 1)));
+  }
+  if ( ParQuery ("Cloudy_save") ){
+    for (n = 0; n < CL_NSAVE_TYPES; n++) Cl_save[n] = 0;
+    nsave = atoi(ParGet("Cloudy_save", 1));
+    for (m = 0; m < nsave; m++){
+      char *chType = ParGet("Cloudy_save", 2+m);
+      for (n = 0; n < CL_NSAVE_TYPES; n++){
+        if ( strcmp(chType, Cl_save_types[n][0]) == 0 ) break;
+      }
+      if ( n == CL_NSAVE_TYPES ){
+        print1 ("! CloudyOutputSettings: unknown save type '%s'\n", chType);
+        QUIT_PLUTO(1);
+      }
+      Cl_save[n] = MAX(1, atoi(Cl_save_types[n][2]));
+    }
+  }
+  if ( ParQuery ("Cloudy_save_last") && strcmp(ParGet("Cloudy_save_last", 1), "yes") == 0 ){
+    for (n = 0; n < CL_NSAVE_TYPES; n++) if ( Cl_save[n] ) Cl_save[n] = 2;
+  }
+  if ( ParQuery ("Cloudy_binary") ){
+    Cl_binary = ( strcmp(ParGet("Cloudy_binary", 1), "yes") == 0 ? YES:NO );
+  }
+  
+  print1 ("> Cloudy: output every %d solutions, save files:", Cl_print_freq);
+  for (n = 0; n < CL_NSAVE_TYPES; n++){
+    if ( Cl_save[n] ) print1 (" %s%s", Cl_save_types[n][0], (Cl_save[n] == 2 ? "(last)":""));
+  }
+  print1 ("%s\n", (Cl_binary ? ", binary":""));
+}
+
+void CloudyWriteBinary()
+/*!
+ * Write the columns and results of all rays of the last solution
+ * into one binary file cl_data.NNNN.bin (collective)
+ *
+ * The rays of all processors are collected on processor 0.
+ * File layout (native byte order):
+ *
+ * - char[8]  "TPCICL01"
+ * - int      file number, number of rays, NX1, 
+ *            CL_NCOL_VARS, CL_NRAY_VARS
+ * - double   x1 coordinates of the domain [NX1] (cm)
+ * - for every ray: double jg, kg (global indices),
+ *   double columns [CL_NCOL_VARS][NX1] (code units: rho, prs, vx1, mu),
+ *   double results [CL_NRAY_VARS][NX1] (order of Cl_ray_vars)
+ *
+ *********************************************************************** */
+{
+  int i, n, ir, nv, nrays;
+  int nval = (CL_NCOL_VARS + CL_NRAY_VARS)*NX1;
+  int nrec = 2 + nval;
+  double *rec;
+  Cl_RayTable *rt = &Cl_rt;
+  
+  /* -- pack the own rays: indices + the domain part of the profiles -- */
+  
+  double *buf = ARRAY_1D(MAX(1, rt->nloc*nrec), double);
+  for (n = 0; n < rt->nloc; n++){
+    ir  = rt->rbeg + n;
+    buf[n*nrec]     = rt->ray_jg[ir];
+    buf[n*nrec + 1] = rt->ray_kg[ir];
+    rec = buf + n*nrec + 2;
+    for (nv = 0; nv < CL_NCOL_VARS; nv++){
+      IDOM_LOOP(i) *rec++ = rt->col[ir*CL_NCOL_VARS*NX1_TOT + nv*NX1_TOT + i];
+    }
+    for (nv = 0; nv < CL_NRAY_VARS; nv++){
+      IDOM_LOOP(i) *rec++ = rt->res[ir*CL_NRAY_VARS*NX1_TOT + nv*NX1_TOT + i];
+    }
+  }
+  
+  double *all = buf;
+  nrays = rt->nloc;
+  #ifdef PARALLEL
+   int nproc, *cnt = NULL, *displ = NULL;
+   MPI_Comm_size (MPI_COMM_WORLD, &nproc);
+   if ( prank == 0 ){
+     cnt   = ARRAY_1D(nproc, int);
+     displ = ARRAY_1D(nproc, int);
+   }
+   n = rt->nloc*nrec;
+   MPI_Gather (&n, 1, MPI_INT, cnt, 1, MPI_INT, 0, MPI_COMM_WORLD);
+   if ( prank == 0 ){
+     displ[0] = 0;
+     for (n = 1; n < nproc; n++) displ[n] = displ[n-1] + cnt[n-1];
+     nrays = (displ[nproc-1] + cnt[nproc-1])/nrec;
+     all   = ARRAY_1D(MAX(1, nrays*nrec), double);
+   }
+   MPI_Gatherv (buf, rt->nloc*nrec, MPI_DOUBLE, all, cnt, displ, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+  #endif
+  
+  /* -- write the file -- */
+  
+  if ( prank == 0 ){
+    char fname[64];
+    int  head[5] = {rt->Cl_ncalls, nrays, (int)NX1, CL_NCOL_VARS, CL_NRAY_VARS};
+    sprintf (fname, "cl_data.%04d.bin", rt->Cl_ncalls);
+    FILE *fp = fopen(fname, "wb");
+    if ( fp == NULL ){
+      print1 ("! CloudyWriteBinary: cannot open %s\n", fname);
+      QUIT_PLUTO(1);
+    }
+    fwrite ("TPCICL01", 1, 8, fp);
+    fwrite (head, sizeof(int), 5, fp);
+    IDOM_LOOP(i){
+      double x1 = rt->grid[IDIR].x[i]*g_unitLength;
+      fwrite (&x1, sizeof(double), 1, fp);
+    }
+    fwrite (all, sizeof(double), (size_t)nrays*nrec, fp);
+    fclose (fp);
+  }
+  
+  #ifdef PARALLEL
+   if ( prank == 0 ){
+     FreeArray1D(cnt);
+     FreeArray1D(displ);
+     FreeArray1D(all);
+   }
+  #endif
+  FreeArray1D(buf);
+}
+
+void CloudyCacheInit()
+/*!
+ * Read the cache settings from pluto.ini and pre-warm the
+ * cache from the file of an earlier run
+ *
+ * - Cloudy_cache       yes/no
+ * - Cloudy_cache_file  name   (none = no file)
+ * - Cloudy_cache_tol   dlogn  dlogT  dlogN  dv
+ *
+ * The file is only used if it was written with the same
+ * node distances and the same USE_ADVEC (the results of
+ * static and advected models differ).
+ *
+ *********************************************************************** */
+{
+  int n, advec;
+  long s, nnode;
+  char chHead[9];
+  double dx[CL_CACHE_NDIM];
+  unsigned long long key;
+  FILE *fp;
+  Cl_Cache *cc = &Cl_cc;
+  
+  if ( ParQuery ("Cloudy_cache") ){
+    Cl_cache = ( strcmp(ParGet("Cloudy_cache", 1), "yes") == 0 ? YES:NO );
+  }
+  if ( !Cl_cache ) return;
+  
+  sprintf (cc->file, "%s", CLOUDY_CACHE_FILE);
+  if ( ParQuery ("Cloudy_cache_file") ){
+    sprintf (cc->file, "%.127s", ParGet("Cloudy_cache_file", 1));
+  }
+  cc->dx[0] = CLOUDY_CACHE_DLOGN;
+  cc->dx[1] = CLOUDY_CACHE_DLOGT;
+  cc->dx[2] = CLOUDY_CACHE_DLOGC;
+  cc->dx[3] = CLOUDY_CACHE_DVEL;
+  if ( ParQuery ("Cloudy_cache_tol") ){
+    for (n = 0; n < CL_CACHE_NDIM; n++){
+      cc->dx[n] = atof(ParGet("Cloudy_cache_tol", 1+n));
+      if ( cc->dx[n] <= 0.0 ){
+        print1 ("! CloudyCacheInit: Cloudy_cache_tol must be positive\n");
+        QUIT_PLUTO(1);
+      }
+    }
+  }
+  
+  cc->nslot = 1 << 16;
+  cc->nused = 0;
+  cc->nray  = 0;
+  cc->key   = ARRAY_1D(cc->nslot, unsigned long long);
+  cc->val   = ARRAY_1D(cc->nslot*CL_NRAY_VARS, double);
+  for (s = 0; s < cc->nslot; s++) cc->key[s] = 0;
+  
+  print1 ("> Cloudy: result cache, tolerance %g %g %g %g, file %s\n",
+          cc->dx[0], cc->dx[1], cc->dx[2], cc->dx[3], cc->file);
+  
+  /* ------------------------------------------
+      pre-warm from the file, all processors
+      read the same nodes
+     ------------------------------------------ */
+  
+  if ( strcmp(cc->file, "none") == 0 ) return;
+  fp = fopen(cc->file, "rb");
+  if ( fp == NULL ) return;
+  
+  if ( fread(chHead, 1, 8, fp) != 8 || strncmp(chHead, "TPCICC02", 8) != 0 ||
+       fread(&n, sizeof(int), 1, fp) != 1 || n != CL_CACHE_NDIM ||
+       fread(&n, sizeof(int), 1, fp) != 1 || n != CL_NRAY_VARS ||
+       fread(&advec, sizeof(int), 1, fp) != 1 ||
+       fread(dx, sizeof(double), CL_CACHE_NDIM, fp) != CL_CACHE_NDIM ||
+       fread(&nnode, sizeof(long), 1, fp) != 1 ){
+    print1 ("! CloudyCacheInit: %s is no cache file, not used\n", cc->file);
+    fclose(fp);
+    return;
+  }
+  if ( advec != USE_ADVEC ){
+    print1 ("! CloudyCacheInit: %s was written %s USE_ADVEC, not used\n",
+            cc->file, advec ? "with":"without");
+    fclose(fp);
+    return;
+  }
+  for (n = 0; n < CL_CACHE_NDIM; n++){
+    if ( fabs(dx[n]/cc->dx[n] - 1.0) > 1.e-6 ){
+      print1 ("! CloudyCacheInit: %s has another tolerance, not used\n", cc->file);
+      fclose(fp);
+      return;
+    }
+  }
+  for ( ; nnode > 0; nnode--){
+    if ( fread(&key, sizeof(key), 1, fp) != 1 ) break;
+    s = CloudyCacheFind(key, YES);
+    if ( fread(cc->val + s*CL_NRAY_VARS, sizeof(double), CL_NRAY_VARS, fp) != CL_NRAY_VARS ) break;
+  }
+  fclose(fp);
+  print1 ("> Cloudy: %ld cache nodes read from %s\n", cc->nused, cc->file);
+}
+
+long CloudyCacheFind(unsigned long long key, int lg_insert)
+/*!
+ * Find a node in the hash table of the cache
+ *
+ * \param [in] key        packed node indices (see CloudyCacheLookup)
+ * \param [in] lg_insert  YES to add the node if it is not found
+ *
+ * \return slot of the node, -1 if it is not found.
+ *
+ *********************************************************************** */
+{
+  long s, n, nslot;
+  unsigned long long *key_old;
+  double *val_old;
+  Cl_Cache *cc = &Cl_cc;
+  
+  s = (long)((key*0x9E3779B97F4A7C15ULL) >> 32) & (cc->nslot-1);
+  while ( cc->key[s] != 0 ){
+    if ( cc->key[s] == key ) return s;
+    s = (s+1) & (cc->nslot-1);
+  }
+  if ( !lg_insert ) return -1;
+  
+  /* -- keep the table at most half filled -- */
+  
+  if ( 2*(cc->nused+1) > cc->nslot ){
+    key_old = cc->key;
+    val_old = cc->val;
+    nslot   = cc->nslot;
+    cc->nslot *= 2;
+    cc->nused  = 0;
+    cc->key    = ARRAY_1D(cc->nslot, unsigned long long);
+    cc->val    = ARRAY_1D(cc->nslot*CL_NRAY_VARS, double);
+    for (s = 0; s < cc->nslot; s++) cc->key[s] = 0;
+    for (s = 0; s < nslot; s++){
+      if ( key_old[s] == 0 ) continue;
+      n = CloudyCacheFind(key_old[s], YES);
+      memcpy(cc->val + n*CL_NRAY_VARS, val_old + s*CL_NRAY_VARS, CL_NRAY_VARS*sizeof(double));
+    }
+    FreeArray1D(key_old);
+    FreeArray1D(val_old);
+    return CloudyCacheFind(key, YES);
+  }
+  
+  cc->key[s] = key;
+  cc->nused++;
+  return s;
+}
+
+void CloudyCacheCoords(Grid *grid, double *Pl_col, double *Pl_x)
+/*!
+ * Coordinates of the cells of a ray in the cache grid:
+ * log n_H, log T, log N_H and x1 velocity (km/s). The column
+ * density is integrated from the illuminated face (IEND) to the
+ * cell center. Without USE_ADVEC the velocity is not used.
+ *
+ * \param [in]  grid    pointer to grid structure.
+ * \param [in]  Pl_col  column of the ray (see CloudyPackRay)
+ * \param [out] Pl_x    CL_CACHE_NDIM coordinates per cell
+ *
+ *********************************************************************** */
+{
+  int i;
+  double nH, NH;
+  double *rho, *prs, *vx1, *mean_mol, *x;
+  rho      = Pl_col + CL_COL_RHO*NX1_TOT;
+  prs      = Pl_col + CL_COL_PRS*NX1_TOT;
+  vx1      = Pl_col + CL_COL_VX1*NX1_TOT;
+  mean_mol = Pl_col + CL_COL_MU *NX1_TOT;
+  
+  NH = 0.0;
+  for (i = IEND; i >= IBEG; i--){
+    x  = Pl_x + i*CL_CACHE_NDIM;
+    nH = rho[i]*g_unitDensity/(CONST_amu*mu) * hydrogen_frac;
+    NH += 0.5*nH*grid[IDIR].dx[i]*g_unitLength;
+    x[0] = log10(nH);
+    x[1] = log10(KELVIN *mean_mol[i] *prs[i]/rho[i]);
+    x[2] = log10(NH);
+    x[3] = ( USE_ADVEC ? vx1[i]*g_unitVelocity*1.e-5:0.0 );
+    NH += 0.5*nH*grid[IDIR].dx[i]*g_unitLength;
+  }
+}
+
+int CloudyCacheLookup(double *Cl_x, double *Cl_val)
+/*!
+ * Interpolate the results at one point from the cache
+ *
+ * The point is found if the nearest node is filled. The
+ * result is the multilinear interpolation of the filled
+ * nodes of the surrounding cell, with the weights of the
+ * missing nodes left out.
+ *
+ * \param [in]  Cl_x    CL_CACHE_NDIM coordinates
+ * \param [out] Cl_val  CL_NRAY_VARS results
+ *
+ * \return YES if the point is found.
+ *
+ *********************************************************************** */
+{
+  int n, nc, nv;
+  long s, ilow[CL_CACHE_NDIM], ix;
+  double wght[CL_CACHE_NDIM], w, wsum, f;
+  unsigned long long key;
+  Cl_Cache *cc = &Cl_cc;
+  
+  /* -- node indices are packed in 16 bits each, 0 is not used -- */
+  
+  key = 0;
+  for (n = 0; n < CL_CACHE_NDIM; n++){
+    f = Cl_x[n]/cc->dx[n];
+    ilow[n] = (long)floor(f);
+    wght[n] = f - ilow[n];
+    ix  = ilow[n] + (wght[n] >= 0.5);
+    ix  = MAX(-32767, MIN(32767, ix));
+    key = (key << 16) | (unsigned long long)(ix + 32768);
+  }
+  if ( CloudyCacheFind(key, NO) < 0 ) return NO;
+  
+  for (nv = 0; nv < CL_NRAY_VARS; nv++) Cl_val[nv] = 0.0;
+  wsum = 0.0;
+  for (nc = 0; nc < (1 << CL_CACHE_NDIM); nc++){
+    key = 0;
+    w   = 1.0;
+    for (n = 0; n < CL_CACHE_NDIM; n++){
+      ix  = ilow[n] + ((nc >> n) & 1);
+      w  *= ( (nc >> n) & 1 ? wght[n]:1.0-wght[n] );
+      ix  = MAX(-32767, MIN(32767, ix));
+      key = (key << 16) | (unsigned long long)(ix + 32768);
+    }
+    if ( w <= 0.0 || (s = CloudyCacheFind(key, NO)) < 0 ) continue;
+    for (nv = 0; nv < CL_NRAY_VARS; nv++) Cl_val[nv] += w*cc->val[s*CL_NRAY_VARS + nv];
+    wsum += w;
+  }
+  
+  for (nv = 0; nv < CL_NRAY_VARS; nv++) Cl_val[nv] /= wsum;
+  return YES;
+}
+
+int CloudyCacheRay(Grid *grid, double *Pl_col, double *Pl_res, int *Pl_hit)
+/*!
+ * Interpolate the results of all cells of a ray from the cache
+ *
+ * \param [in]  grid    pointer to grid structure.
+ * \param [in]  Pl_col  column of the ray (see CloudyPackRay)
+ * \param [out] Pl_res  CL_NRAY_VARS*NX1_TOT results, only the
+ *                      cells which are found are set
+ * \param [out] Pl_hit  YES for the cells which are found
+ *
+ * \return number of cells which are not found.
+ *
+ *********************************************************************** */
+{
+  int i, nv, nmiss = 0;
+  double Cl_val[CL_NRAY_VARS];
+  static double *Pl_x;
+  
+  if ( Pl_x == NULL ) Pl_x = ARRAY_1D(NX1_TOT*CL_CACHE_NDIM, double);
+  
+  CloudyCacheCoords(grid, Pl_col, Pl_x);
+  IDOM_LOOP(i){
+    Pl_hit[i] = CloudyCacheLookup(Pl_x + i*CL_CACHE_NDIM, Cl_val);
+    if ( !Pl_hit[i] ){
+      nmiss++;
+      continue;
+    }
+    for (nv = 0; nv < CL_NRAY_VARS; nv++) Pl_res[nv*NX1_TOT + i] = Cl_val[nv];
+  }
+  if ( Pl_hit[IBEG] ) Pl_res[IBEG-1] = Pl_res[IBEG];
+  return nmiss;
+}
+
+void CloudyCacheStore(Grid *grid, double *Pl_col, double *Pl_res)
+/*!
+ * Save the results of a Cloudy model in the cache, every cell
+ * sets its nearest node
+ *
+ * \param [in] grid    pointer to grid structure.
+ * \param [in] Pl_col  column of the ray (see CloudyPackRay)
+ * \param [in] Pl_res  CL_NRAY_VARS*NX1_TOT results
+ *
+ *********************************************************************** */
+{
+  int i, n, nv;
+  long s, ix;
+  unsigned long long key;
+  double *x;
+  static double *Pl_x;
+  Cl_Cache *cc = &Cl_cc;
+  
+  if ( Pl_x == NULL ) Pl_x = ARRAY_1D(NX1_TOT*CL_CACHE_NDIM, double);
+  
+  CloudyCacheCoords(grid, Pl_col, Pl_x);
+  IDOM_LOOP(i){
+    x   = Pl_x + i*CL_CACHE_NDIM;
+    key = 0;
+    for (n = 0; n < CL_CACHE_NDIM; n++){
+      ix  = (long)floor(x[n]/cc->dx[n] + 0.5);
+      ix  = MAX(-32767, MIN(32767, ix));
+      key = (key << 16) | (unsigned long long)(ix + 32768);
+    }
+    s = CloudyCacheFind(key, YES);
+    for (nv = 0; nv < CL_NRAY_VARS; nv++) cc->val[s*CL_NRAY_VARS + nv] = Pl_res[nv*NX1_TOT + i];
+  }
+}
+
+int CloudyCacheSolveRay(Data *d, Grid *grid, int Pl_k, int Pl_j)
+/*!
+ * Take ray (j,k) from the cache instead of solving it with Cloudy
+ *
+ * \return YES if all cells of the ray are found, the user defined
+ *         variables are set in this case.
+ *
+ *********************************************************************** */
+{
+  static double *Pl_col, *Pl_res;
+  static int *Pl_hit;
+  
+  if ( Pl_col == NULL ){
+    Pl_col = ARRAY_1D(CL_NCOL_VARS*NX1_TOT, double);
+    Pl_res = ARRAY_1D(CL_NRAY_VARS*NX1_TOT, double);
+    Pl_hit = ARRAY_1D(NX1_TOT, int);
+  }
+  
+  CloudyPackRay(d, Pl_k, Pl_j, Pl_col);
+  if ( CloudyCacheRay(grid, Pl_col, Pl_res, Pl_hit) > 0 ) return NO;
+  
+  CloudyUnpackRay(Pl_k, Pl_j, Pl_res);
+  Cl_cc.nray++;
+  return YES;
+}
+
+void CloudyCacheRefresh(Data *d, Grid *grid, int **ray_solve)
+/*!
+ * Update the user defined variables of the rays, which are not
+ * solved in this step, from the cache. Cells which are not found
+ * keep the results of the last solution.
+ *
+ *********************************************************************** */
+{
+  int i, j, k, nv;
+  double ***uvar;
+  static double *Pl_col, *Pl_res;
+  static int *Pl_hit;
+  
+  if ( Pl_col == NULL ){
+    Pl_col = ARRAY_1D(CL_NCOL_VARS*NX1_TOT, double);
+    Pl_res = ARRAY_1D(CL_NRAY_VARS*NX1_TOT, double);
+    Pl_hit = ARRAY_1D(NX1_TOT, int);
+  }
+  if ( Cl_cc.nused == 0 ) return;
+  
+  KDOM_LOOP(k){
+    JDOM_LOOP(j){
+      if ( ray_solve[k][j] ) continue;
+      CloudyPackRay(d, k, j, Pl_col);
+      if ( CloudyCacheRay(grid, Pl_col, Pl_res, Pl_hit) == NX1 ) continue;
+      for (nv = 0; nv < CL_NRAY_VARS; nv++){
+        uvar = GetUserVar((char *)Cl_ray_vars[nv]);
+        IDOM_LOOP(i) if ( Pl_hit[i] ) uvar[k][j][i] = Pl_res[nv*NX1_TOT + i];
+      }
+      if ( Pl_hit[IBEG] ){
+        uvar = GetUserVar("U_MEAN_MOL");
+        uvar[k][j][IBEG-1] = Pl_res[IBEG-1];
+      }
+    }
+  }
+}
+
+void CloudyCacheWrite()
+/*!
+ * Write the cache to Cl_cc.file (collective)
+ *
+ * The nodes of all processors are merged on processor 0,
+ * which writes the file:
+ * - "TPCICC02", int CL_CACHE_NDIM, int CL_NRAY_VARS, int USE_ADVEC
+ * - double node distances [CL_CACHE_NDIM]
+ * - long number of nodes
+ * - per node: unsigned long long key, double results [CL_NRAY_VARS]
+ *
+ *********************************************************************** */
+{
+  long s, nnode, nray;
+  FILE *fp;
+  Cl_Cache *cc = &Cl_cc;
+  
+  nray = cc->nray;
+  
+  #ifdef PARALLEL
+   int n, m, nproc, nloc, *cnt = NULL, *displ = NULL, *cntv = NULL, *displv = NULL;
+   unsigned long long *key_all = NULL, *key_loc;
+   double *val_all = NULL, *val_loc;
+   
+   MPI_Comm_size (MPI_COMM_WORLD, &nproc);
+   MPI_Allreduce (&cc->nray, &nray, 1, MPI_LONG, MPI_SUM, MPI_COMM_WORLD);
+   
+   nloc    = (int)cc->nused;
+   key_loc = ARRAY_1D(MAX(1,nloc), unsigned long long);
+   val_loc = ARRAY_1D(MAX(1,nloc)*CL_NRAY_VARS, double);
+   m = 0;
+   for (s = 0; s < cc->nslot; s++){
+     if ( cc->key[s] == 0 ) continue;
+     key_loc[m] = cc->key[s];
+     memcpy(val_loc + m*CL_NRAY_VARS, cc->val + s*CL_NRAY_VARS, CL_NRAY_VARS*sizeof(double));
+     m++;
+   }
+   if ( prank == 0 ){
+     cnt    = ARRAY_1D(nproc, int);
+     displ  = ARRAY_1D(nproc, int);
+     cntv   = ARRAY_1D(nproc, int);
+     displv = ARRAY_1D(nproc, int);
+   }
+   MPI_Gather (&nloc, 1, MPI_INT, cnt, 1, MPI_INT, 0, MPI_COMM_WORLD);
+   if ( prank == 0 ){
+     m = 0;
+     for (n = 0; n < nproc; n++){
+       displ[n]  = m;
+       cntv[n]   = cnt[n]*CL_NRAY_VARS;
+       displv[n] = m*CL_NRAY_VARS;
+       m += cnt[n];
+     }
+     key_all = ARRAY_1D(MAX(1,m), unsigned long long);
+     val_all = ARRAY_1D(MAX(1,m)*CL_NRAY_VARS, double);
+   }
+   MPI_Gatherv (key_loc, nloc, MPI_UNSIGNED_LONG_LONG, key_all, cnt, displ,
+                MPI_UNSIGNED_LONG_LONG, 0, MPI_COMM_WORLD);
+   MPI_Gatherv (val_loc, nloc*CL_NRAY_VARS, MPI_DOUBLE, val_all, cntv, displv,
+                MPI_DOUBLE, 0, MPI_COMM_WORLD);
+   if ( prank == 0 ){
+     for (n = cnt[0]; n < m; n++){   /* nodes of the other processors */
+       s = CloudyCacheFind(key_all[n], YES);
+       memcpy(cc->val + s*CL_NRAY_VARS, val_all + n*CL_NRAY_VARS, CL_NRAY_VARS*sizeof(double));
+     }
+     FreeArray1D(cnt);  FreeArray1D(displ);
+     FreeArray1D(cntv); FreeArray1D(displv);
+     FreeArray1D(key_all);
+     FreeArray1D(val_all);
+   }
+   FreeArray1D(key_loc);
+   FreeArray1D(val_loc);
+  #endif
+  
+  print1 ("> Cloudy: %ld rays taken from the cache\n", nray);
+  
+  if ( prank != 0 || strcmp(cc->file, "none") == 0 ) return;
+  
+  fp = fopen(cc->file, "wb");
+  if ( fp == NULL ){
+    print1 ("! CloudyCacheWrite: cannot open %s\n", cc->file);
+    return;
+  }
+  int head[3] = {CL_CACHE_NDIM, CL_NRAY_VARS, USE_ADVEC};
+  nnode = cc->nused;
+  fwrite ("TPCICC02", 1, 8, fp);
+  fwrite (head, sizeof(int), 3, fp);
+  fwrite (cc->dx, sizeof(double), CL_CACHE_NDIM, fp);
+  fwrite (&nnode, sizeof(long), 1, fp);
+  for (s = 0; s < cc->nslot; s++){
+    if ( cc->key[s] == 0 ) continue;
+    fwrite (cc->key + s, sizeof(unsigned long long), 1, fp);
+    fwrite (cc->val + s*CL_NRAY_VARS, sizeof(double), CL_NRAY_VARS, fp);
+  }
+  fclose(fp);
+  print1 ("> Cloudy: %ld cache nodes written to %s\n", nnode, cc->file);
+}
+
+void CloudyPackRay(Data *d, int Pl_k, int Pl_j, double *Pl_col)
+/*!
+ * Copy the x1 profiles of ray (j,k) into a column
+ *
+ * \param [in]  d       pointer to PLUTO Data structure
+ * \param [in]  Pl_k    k-indice of the ray
+ * \param [in]  Pl_j    j-indice of the ray
+ * \param [out] Pl_col  column of CL_NCOL_VARS*NX1_TOT values
+ *
+ *********************************************************************** */
+{
+  int i;
+  double ***mean_mol;
+  mean_mol = GetUserVar("U_MEAN_MOL");
+  
+  ITOT_LOOP(i){
+    Pl_col[CL_COL_RHO*NX1_TOT + i] = d->Vc[RHO][Pl_k][Pl_j][i];
+    Pl_col[CL_COL_PRS*NX1_TOT + i] = d->Vc[PRS][Pl_k][Pl_j][i];
+    Pl_col[CL_COL_VX1*NX1_TOT + i] = d->Vc[VX][Pl_k][Pl_j][i];
+    Pl_col[CL_COL_MU *NX1_TOT + i] = mean_mol[Pl_k][Pl_j][i];
+  }
+}
+
+void CloudyUnpackRay(int Pl_k, int Pl_j, double *Pl_res)
+/*!
+ * Copy the results of a Cloudy model into the user defined
+ * variables of ray (j,k)
+ *
+ * Only the values set by CloudyGetResults are copied: the
+ * domain and the first boundary point of the mean mol. weight.
+ *
+ * \param [in] Pl_k    k-indice of the ray
+ * \param [in] Pl_j    j-indice of the ray
+ * \param [in] Pl_res  CL_NRAY_VARS*NX1_TOT results
+ *
+ *********************************************************************** */
+{
+  int i, nv;
+  double ***uvar;
+  
+  for (nv = 0; nv < CL_NRAY_VARS; nv++){
+    uvar = GetUserVar((char *)Cl_ray_vars[nv]);
+    IDOM_LOOP(i) uvar[Pl_k][Pl_j][i] = Pl_res[nv*NX1_TOT + i];
+  }
+  uvar = GetUserVar("U_MEAN_MOL");
+  uvar[Pl_k][Pl_j][IBEG-1] = Pl_res[IBEG-1];
+}
+
+void RadiativeRate(Data *d, double ***heat, double ***dhdp)
+/*!
+ * Net radiative heating of the cells at their present temperature
+ *
+ * The userdef variable U_RAD_HEAT contains the net heating-cooling
+ * (erg cm-3 s-1) computed in Cloudy at the temperature U_RAD_TEMP,
+ * and U_RAD_DHDT its derivative with respect to the temperature.
+ * With Cl_implicit the heating is extrapolated to the temperature
+ * of the cell.
+ *
+ * \param [in]  d     pointer to PLUTO Data structure;
+ * \param [out] heat  net heating (code units)
+ * \param [out] dhdp  derivative of heat with respect to the pressure
+ *                    at constant density, 0 if the cell is updated
+ *                    explicitly
+ *
+ *********************************************************************** */
+{
+  int k, j, i;
+  double unitErg, T;
+  double ***rad_heat, ***rad_dhdt, ***rad_temp, ***mean_mol;
+  unitErg = g_unitDensity*pow(g_unitVelocity,3)/g_unitLength;
+
+  rad_heat = GetUserVar("U_RAD_HEAT");
+  rad_dhdt = GetUserVar("U_RAD_DHDT");
+  rad_temp = GetUserVar("U_RAD_TEMP");
+  mean_mol = GetUserVar("U_MEAN_MOL");
+
+  DOM_LOOP(k,j,i){
+    heat[k][j][i] = rad_heat[k][j][i]/unitErg;
+    dhdp[k][j][i] = 0.0;
+    if ( Cl_implicit && rad_dhdt[k][j][i] < 0.0 && rad_temp[k][j][i] > 0.0 ){
+      T = KELVIN*mean_mol[k][j][i]*d->Vc[PR][k][j][i]/d->Vc[RHO][k][j][i];
+      heat[k][j][i] += rad_dhdt[k][j][i]*(T - rad_temp[k][j][i])/unitErg;
+      dhdp[k][j][i]  = rad_dhdt[k][j][i]*T/d->Vc[PR][k][j][i]/unitErg;
+    }
+  };
+}
+
+void RadiativeHeating(Data *d)
+/*!
+ * Apply the radiatvie heating/cooling
+ *
+ * The net heating-cooling computed in Cloudy (see RadiativeRate)
+ * is applied in every hydro step. With Cl_implicit the change of
+ * the pressure is the backward Euler step of the linearized heating,
+ * dp = (g-1) dt heat / (1 - (g-1) dt dheat/dp).
+ *
+ * \param  d  pointer to PLUTO Data structure;
+ *
+ *********************************************************************** */
+{
+  int k, j, i;
+
+  if (Rad_heat == NULL){
+    Rad_heat = ARRAY_3D(NX3_TOT, NX2_TOT, NX1_TOT, double);
+    Rad_dhdp = ARRAY_3D(NX3_TOT, NX2_TOT, NX1_TOT, double);
+  }
+  RadiativeRate(d, Rad_heat, Rad_dhdp);
+
+  DOM_LOOP(k,j,i){
+    d->Vc[PR][k][j][i] += Rad_heat[k][j][i]*(g_gamma-1)*g_dt
+                          /(1.0 - (g_gamma-1)*g_dt*Rad_dhdp[k][j][i]);
+  };
+
+}
+
+void RadiativeTimestep(Data *d,  Time_Step *Dts, int lg_last_step)
+/*!
+ * Control timestepping via Cooling/Heating rate
+ *
+ * The pressure may not change by more than FRAC_COOL_TIMESTEP
+ * in one step. For the implicit update the change
+ * f = a dt/(1 + b dt) with a = (g-1)|heat|/p and b = (g-1)|dheat/dp|
+ * is bounded by a/b, so only cells with a > FRAC_COOL_TIMESTEP*b
+ * limit the time step to dt = FRAC_COOL_TIMESTEP/(a - FRAC_COOL_TIMESTEP*b).
+ * Without Cl_implicit b = 0.
+ *
+ * \param  d  pointer to PLUTO Data structure;
+ * \param  Dts    pointer to time Step structure;
+ *
+ *********************************************************************** */
+{
+  int k, j, i;
+  double dtcool, a, b;
+
+  RadiativeRate(d, Rad_heat, Rad_dhdp);
+
+  dtcool = 1.e38;
+  DOM_LOOP(k,j,i){
+    a = (g_gamma-1)*fabs(Rad_heat[k][j][i])/d->Vc[PR][k][j][i];
+    b = (g_gamma-1)*fabs(Rad_dhdp[k][j][i]);
+    if (a > FRAC_COOL_TIMESTEP*b){
+      dtcool = MIN(dtcool, FRAC_COOL_TIMESTEP/(a - FRAC_COOL_TIMESTEP*b));
+    }
+  };
+
+  Dts->dt_cool = dtcool;
+  
+  /* ------------------------------------------
+      print warning if advection should be
+      included
+     ------------------------------------------ */
+  #if ( !USE_ADVEC )
+    if ( g_stepNumber%1000 == 0 || lg_last_step){
+      int lg_advec_rec, lg_advec_mol;
+      double ***hd_time, ***hrec_time, ***hmol_time;
+      hd_time = GetUserVar("U_HD_TIME");
+      hrec_time = GetUserVar("U_HREC_TIME");
+      hmol_time = GetUserVar("U_HMOL_TIME");
+    
+      lg_advec_rec = 0;
+      lg_advec_mol = 0;
+      DOM_LOOP(k,j,i){
+         if( hrec_time[k][j][i]>0.0 && hrec_time[k][j][i]>hd_time[k][j][i]){
+           lg_advec_rec = 1;
+         };
+         if( hmol_time[k][j][i]>0.0 && hmol_time[k][j][i]>hd_time[k][j][i]){
+           lg_advec_mol = 1;
+         };
+      };
+      
+      if( lg_advec_rec ){
+        print1 ("! WARNING: H recombination timescale is longer than the HD timescale.\n");
+        print1 ("!          Please consider using advection!\n");
+      }
+      if( lg_advec_mol ){
+        print1 ("! WARNING: Molecular timescales could be longer than the HD timescale.\n");
+        print1 ("!          Please consider using advection!\n");
+      }
+    }
+  #endif
+}
+
+
+int CallCloudy(Grid *grid, double *Pl_col, double *Pl_res, int Cl_ncalls, double x1_dom_len, int Pl_jg, int Pl_kg, int lg_last_step)
+/*!
+ * Initialize + start Cloudy
+ * (developed from Cloudy template)
+ * 
+ * - creates the Cloudy input script
+ * - executes Cloudy
+ * - retrieves the results and saves them
+ * - catches all possible errors
+ *
+ * \param  grid    pointer to grid structure.
+ * \param  Pl_col  column of the ray (see CloudyPackRay)
+ * \param  Pl_res  results of the ray (see CloudyUnpackRay)
+ * \param  Pl_jg   global j-indice of the ray
+ * \param  Pl_kg   global k-indice of the ray
+ *
+ * \return An integer giving success / failure of the Cloudy run.
+ *
+ *********************************************************************** */
+{
+  exit_type exit_status = ES_SUCCESS;
+
+  DEBUG_ENTRY( "main()" );
+
+  try {
+
+    bool Cl_lgAbort;
+    long Cl_nw , Cl_nc , Cl_nn , Cl_ns , Cl_nte , Cl_npe , Cl_nione, Cl_neden;
+    int i;
+    
+    /* ------------------------------------------------------
+        initialize Cloudy
+       ------------------------------------------------------ */
+    
+    CloudyTimerStart(CL_TM_RAY);
+    CloudyTimerStart(CL_TM_INIT);
+    cdInit();
+    CloudyTimerStop(CL_TM_INIT);
+    
+    /* ------------------------------------------------------
+        generate the input script: the constant commands
+        and the structure of this ray
+       ------------------------------------------------------ */
+    
+    CloudyTimerStart(CL_TM_SCRIPT);
+    CloudyConstantScript(x1_dom_len);
+    CloudyInputScript(grid, Pl_col, Cl_ncalls, Pl_jg, Pl_kg, lg_last_step);
+    CloudyTimerStop(CL_TM_SCRIPT);
+    
+    /* ------------------------------------------------------
+        execute the input script from above
+       ------------------------------------------------------ */
+    CloudyTimerStart(CL_TM_DRIVE);
+    if( cdDrive() )
     {
       exit_status = ES_FAILURE;
     }
-    printf("I'm here3.2\n");  
+    Cl_tm[CL_TM_DRIVE].cpu += cdExecTime();
+    CloudyTimerStop(CL_TM_DRIVE);
     /* ------------------------------------------------------
         retrieve the error messages
        ------------------------------------------------------ */    
     
     cdNwcns( &Cl_lgAbort , &Cl_nw , &Cl_nc , &Cl_nn , &Cl_ns , &Cl_nte , &Cl_npe , &Cl_nione, &Cl_neden );
-    printf("I'm here3.5\n");  
     /* ------------------------------------------------------
         if Cloudy did not abort, get the results
        ------------------------------------------------------ */ 
     
     if( !Cl_lgAbort )
     {
-      printf("I'm here4\n");  
-      CloudyGetResults( grid, Pl_k, Pl_j );
-      printf("I'm here5\n");  
+      CloudyTimerStart(CL_TM_RESULTS);
+      CloudyGetResults( grid, Pl_res );
+      CloudyTimerStop(CL_TM_RESULTS);
     }
     
+    CloudyTimerStop(CL_TM_RAY);
     cdEXIT(exit_status);
   }
   // here we catch all the possible exceptions that the code can throw
@@ -544,95 +2565,144 @@ int CallCloudy(Data *d, Grid *grid, int Cl_ncalls, double x1_dom_len, int Pl_k,
 
 
 
-void CloudyInputScript(Data *d, Grid *grid, int Cl_ncalls, double x1_dom_len, int Pl_k, int Pl_j, int koff, int joff, int lg_last_step)
+void CloudyIncidentSED()
+/*!
+ * Pass the incident SED to Cloudy
+ *
+ * The numbers on the "interpolate" and "continue" lines of
+ * CLOUDY_SED_FILE are read on the first call only and stored in
+ * Cloudy with cdSetIncidentSED, so that the table does not pass 
+ * the Cloudy command parser for every ray. The model uses it with
+ * "interpolate external". All other lines of the file (e.g. the
+ * luminosity) are kept and entered as commands.
+ *
+ *********************************************************************** */
+{
+  static int lg_read = 0, ncmd = 0;
+  static char cmd[CL_SED_NCMD][CL_SED_LINE];
+  char line[CL_SED_LINE], *pc, *pend;
+  long n, npairs, nnum;
+  double x, *nu, *flux;
+  FILE *fp;
+  int pass, i;
+
+  if (!lg_read){
+    fp = fopen(CLOUDY_SED_FILE, "r");
+    if (fp == NULL){
+      print1 ("! CloudyIncidentSED: cannot open %s\n", CLOUDY_SED_FILE);
+      QUIT_PLUTO(1);
+    }
+    
+    /* count the numbers in the first pass, store them in the second */
+    nu = flux = NULL;
+    nnum = 0;
+    for (pass = 0; pass < 2; pass++){
+      n = 0;
+      rewind(fp);
+      while (fgets(line, CL_SED_LINE, fp) != NULL){
+        pc = line;
+        while (*pc == ' ' || *pc == '\t') pc++;
+        if (*pc == '\0' || *pc == '\n' || *pc == '#' || *pc == '*' || *pc == '%') continue;
+        
+        if (strncasecmp(pc, "inte", 4) && strncasecmp(pc, "cont", 4)){
+          /* some other command, keep it */
+          if (pass == 0){
+            if (ncmd == CL_SED_NCMD){
+              print1 ("! CloudyIncidentSED: more than %d commands in %s\n", 
+                      CL_SED_NCMD, CLOUDY_SED_FILE);
+              QUIT_PLUTO(1);
+            }
+            pc[strcspn(pc, "\r\n")] = '\0';
+            strcpy(cmd[ncmd++], pc);
+          }
+          continue;
+        }
+        
+        while (*pc != '\0' && !isspace(*pc)) pc++;
+        while (*pc != '\0'){
+          if (!isdigit(*pc) && *pc != '-' && *pc != '+' && *pc != '.'){
+            pc++;
+            continue;
+          }
+          x = strtod(pc, &pend);
+          if (pend == pc){
+            pc++;
+            continue;
+          }
+          pc = pend;
+          if (pass == 1){
+            if (n % 2 == 0) nu[n/2] = x;
+            else flux[n/2] = x;
+          }
+          n++;
+        }
+      }
+      if (pass == 0){
+        nnum = n;
+        if (nnum < 4 || nnum % 2){
+          print1 ("! CloudyIncidentSED: %s must contain pairs of energy and flux\n",
+                  CLOUDY_SED_FILE);
+          QUIT_PLUTO(1);
+        }
+        nu   = ARRAY_1D(nnum/2, double);
+        flux = ARRAY_1D(nnum/2, double);
+      }
+    }
+    fclose(fp);
+    
+    npairs = nnum/2;
+    cdSetIncidentSED(nu, flux, npairs);
+    FreeArray1D(nu);
+    FreeArray1D(flux);
+    lg_read = 1;
+  }
+
+  cdRead( "interpolate external" );
+  for (i = 0; i < ncmd; i++) cdRead( cmd[i] );
+}
+
+
+
+void CloudyConstantScript(double x1_dom_len)
 /*!
- * Create the input script
+ * Create the constant part of the input script
+ *
+ * These commands are the same for every ray and every call
+ * of Cloudy.
+ *
+ * \param [in] x1_dom_len  depth of the x1 domain in cm
  *
  *********************************************************************** */
 {
   long nleft;
   char chLine [50];
-  int i;
-  double x1, val, dxmin;
-  double ***mean_mol, ***rad_heat;
-  mean_mol = GetUserVar("U_MEAN_MOL");
-  rad_heat = GetUserVar("U_RAD_HEAT");
   
   /* ****************** IRRADIATION SED ********************* */
   nleft = cdRead("CMB");
   nleft = cdRead( "cosmic rays background" );
   
-  nleft = cdRead( "init \"spectra.ini\"" );
-      
-  /* ************* GEOMETRY AND DENSITY STRUCTURE ********** */
-  nleft = cdRead("radius 2.3e11 linear");
-  
-  sprintf( chLine , "stop depth %10.4e linear", x1_dom_len);
-  //printf("Limit %s\n", chLine);
-  nleft = cdRead( chLine );
-  
-  /* **** PASS DENSITY STRUCTURE FROM PLUTO TO CLOUDY ***** */
-  //nleft = cdRead( "print off hide" );
-  nleft = cdRead( "dlaw table depth linear" );
-  INV_IDOM_LOOP(i){
-    x1  = (grid[IDIR].x[IEND] - grid[IDIR].x[i])*g_unitLength;
-    val = d->Vc[DN][Pl_k][Pl_j][i]*g_unitDensity/(CONST_amu*mu) * hydrogen_frac;
-    //printf("dlaw %e %e\n", x1, val);
-    // HOW DO I GET THE HYDROGEN DENSITY AUTOMATICALLY ????
-    // Solar: 1.427  ,  ISM: 1.426  ,  H + He: 1.408  ,  H: 1.008
-    sprintf( chLine , "%11.5e %11.5e", x1, val);
-    nleft = cdRead( chLine );
-  };
-  nleft = cdRead( "end of dlaw" );
-  nleft = cdRead( "print on" );
-
-
-  /* ** PASS TEMPERATURE STRUCTURE FROM PLUTO TO CLOUDY **** */
-  //nleft = cdRead( "print off hide" );
-  nleft = cdRead( "tlaw table depth linear" );
-  INV_IDOM_LOOP(i){
-    x1  = (grid[IDIR].x[IEND] - grid[IDIR].x[i])*g_unitLength;
-    val = KELVIN *mean_mol[Pl_k][Pl_j][i] *d->Vc[PRS][Pl_k][Pl_j][i]/d->Vc[RHO][Pl_k][Pl_j][i];
-    sprintf( chLine , "%11.5e %11.5e", x1, val);
-    nleft = cdRead( chLine );
-    //printf("tlaw %e %s\n", grid[IDIR].x[IEND], chLine);
-  };
-  nleft = cdRead( "end of tlaw" );
-  nleft = cdRead( "print on" );
-
-  
-  /* *********** PASS THE VELOCITY STRUCTURE ************** */
+  CloudyIncidentSED();
+      
+  /* ************* GEOMETRY AND DENSITY STRUCTURE ********** */
+  nleft = cdRead("radius 2.3e11 linear");
+  
+  sprintf( chLine , "stop depth %10.4e linear", x1_dom_len);
+  //printf("Limit %s\n", chLine);
+  nleft = cdRead( chLine );
+  
+  /* ******************** ITERATIONS ********************** */
+  /* the number of iterations is set in CloudyInputScript */
   #if ( USE_ADVEC )
-  //nleft = cdRead( "print off hide" );
-    nleft = cdRead( "wind advection table depth linear" );
-    INV_IDOM_LOOP(i){
-      x1   = (grid[IDIR].x[IEND] - grid[IDIR].x[i])*g_unitLength;
-      val  = (-1.0)*d->Vc[VX][Pl_k][Pl_j][i]*g_unitVelocity;
-      //sprintf( chLine , "%11.5e %11.5e", x1, val);
-      if( val < 0.0 ){
-        sprintf( chLine , "%11.5e %11.5e", x1, val);
-      }
-      else{
-        sprintf( chLine , "%11.5e %11.5e", x1, -1.e-10);
-      }
-      //printf("velocity: %s\n", chLine);
-      nleft = cdRead( chLine );
-    };
-    nleft = cdRead( "end of velocity table" );
-    nleft = cdRead( "print on" );
-    nleft = cdRead( "iterate 150" );
     nleft = cdRead( "set dynamics advection length fraction 0.01" );
-  #else
-    nleft = cdRead( "iterate 2" );
   #endif
 
-
   /* ************ SPEED UP / ITERATE ********************** */ 
 //   nleft = cdRead( "stop zone 1" );
 //   nleft = cdRead( "atom h-like levels small" ); 
 //   nleft = cdRead( "atom he-like levels small" ); 
 //   nleft = cdRead( "no level2" );
      nleft = cdRead( "no molecules" );
+//   nleft = cdRead( "set chemistry solver sparse" );
 //   nleft = cdRead( "no opacity reevaluation" );
 //   nleft = cdRead( "no ionization reevaluation" );
 //   nleft = cdRead( "no fine opacities" );
@@ -687,13 +2757,124 @@ void CloudyInputScript(Data *d, Grid *grid, int Cl_ncalls, double x1_dom_len, in
   
   nleft = cdRead( "print short" );
   nleft = cdRead( "print line faint -2 log" );
-  printf("I'm here2\n");  
+}
+
+void CloudyInputScript(Grid *grid, double *Pl_col, int Cl_ncalls, int Pl_jg, int Pl_kg, int lg_last_step)
+/*!
+ * Create the ray dependent part of the input script
+ *
+ * The density, temperature and velocity structure of the ray
+ * and the output files. The constant commands are passed with
+ * CloudyConstantScript().
+ *
+ * \param [in] Pl_col  column of the ray (see CloudyPackRay)
+ * \param [in] Pl_jg   global j-indice of the ray
+ * \param [in] Pl_kg   global k-indice of the ray
+ *
+ *********************************************************************** */
+{
+  long nleft;
+  char chLine [128];
+  int i;
+  double *rho, *prs, *mean_mol;
+  #if ( DIMENSIONS == 1 )
+   (void)Pl_jg; (void)Pl_kg;  /* -- one ray, see the file names below -- */
+  #endif
+  rho      = Pl_col + CL_COL_RHO*NX1_TOT;
+  prs      = Pl_col + CL_COL_PRS*NX1_TOT;
+  mean_mol = Pl_col + CL_COL_MU *NX1_TOT;
+  
+  /* ------------------------------------------
+      the structures are passed as arrays,
+      depth increases from the outer boundary
+     ------------------------------------------ */
+  
+  static double *tab_depth, *tab_val;
+  int n;
+  
+  if (tab_depth == NULL){
+    tab_depth = ARRAY_1D(NX1_TOT, double);
+    tab_val   = ARRAY_1D(NX1_TOT, double);
+  }
+  
+  n = 0;
+  INV_IDOM_LOOP(i){
+    tab_depth[n++] = (grid[IDIR].x[IEND] - grid[IDIR].x[i])*g_unitLength;
+  };
+  
+  /* **** PASS DENSITY STRUCTURE FROM PLUTO TO CLOUDY ***** */
+  n = 0;
+  INV_IDOM_LOOP(i){
+    // HOW DO I GET THE HYDROGEN DENSITY AUTOMATICALLY ????
+    // Solar: 1.427  ,  ISM: 1.426  ,  H + He: 1.408  ,  H: 1.008
+    tab_val[n++] = rho[i]*g_unitDensity/(CONST_amu*mu) * hydrogen_frac;
+  };
+  nleft = cdSetDensityTable( tab_depth, tab_val, n, true );
+
+
+  /* ** PASS TEMPERATURE STRUCTURE FROM PLUTO TO CLOUDY **** */
+  n = 0;
+  INV_IDOM_LOOP(i){
+    tab_val[n++] = KELVIN *mean_mol[i] *prs[i]/rho[i];
+  };
+  nleft = cdSetTemperatureTable( tab_depth, tab_val, n, true );
+
+  
+  /* *********** PASS THE VELOCITY STRUCTURE ************** */
+  #if ( USE_ADVEC )
+    double val, *vx1 = Pl_col + CL_COL_VX1*NX1_TOT;
+    n = 0;
+    INV_IDOM_LOOP(i){
+      val  = (-1.0)*vx1[i]*g_unitVelocity;
+      tab_val[n++] = ( val < 0.0 ? val:-1.e-10 );
+    };
+    nleft = cdSetWindTable( tab_depth, tab_val, n, true, "advection" );
+  #endif
+
+
+  /* ***************** WARM START / ITERATIONS ************ */
+  /* the state file of the last model of this ray is recovered,
+     if its tag shows that it was saved by an earlier call of
+     this run (or of the run before the restart) on this grid:
+     tag = file number, step, number of rays, cells per ray */
+  char chState [50];
+  int  n_iter = CLOUDY_ITER;
+  double tag[STATE_NTAG];
+  double nrays = (double)grid[JDIR].np_int_glob*grid[KDIR].np_int_glob;
+  
+  #if ( DIMENSIONS == 1 )
+    sprintf( chState , "cl_state");
+  #elif ( DIMENSIONS == 2 )
+    sprintf( chState , "cl_state.%02d", Pl_jg);
+  #else
+    sprintf( chState , "cl_state.%02d.%02d", Pl_jg, Pl_kg);
+  #endif
+  if ( Cl_warm_start ){
+    if ( Cl_ncalls > 1 && state_get_tag(chState, tag) &&
+         tag[0] < Cl_ncalls && tag[1] <= g_stepNumber &&
+         tag[2] == nrays && tag[3] == grid[IDIR].np_int_glob ){
+      sprintf( chLine , "state get warm \"%s\"", chState);
+      nleft = cdRead( chLine );
+      n_iter = Cl_warm_iter;
+    }
+    sprintf( chLine , "state put \"%s\" tag %d %ld %.0f %d", chState, 
+             Cl_ncalls, g_stepNumber, nrays, grid[IDIR].np_int_glob);
+    nleft = cdRead( chLine );
+  }
+  if ( n_iter > 1 ){
+    sprintf( chLine , "iterate %d", n_iter);
+    nleft = cdRead( chLine );
+  }
+
+  /* ******************* OUTPUT *************************** */
+  
   cdTalk ( false );
-  cdOutput( "cloudy.out", "a");
-  if (Cl_ncalls == 1){cdOutput( "cloudy.out");}
+  cdOutput( Cl_out_file, (Cl_out_new ? "w":"a") );
+  Cl_out_new = NO;
   
-  //if ( Cl_ncalls%CLOUDY_PRINT_FREQ == 0 || g_stepNumber == 0 || lg_last_step){ // if not print every Cloudy call
-  if (true) {
+  if ( Cl_print_freq > 0 && (Cl_ncalls%Cl_print_freq == 0 || Cl_ncalls == 1 || lg_last_step) ){
+    char chSave [128];
+    int  n;
     cdTalk ( true );
     #if ( DIMENSIONS == 1 )
       sprintf( chLine , "cl_data.%04d.out", Cl_ncalls);
@@ -701,94 +2882,93 @@ void CloudyInputScript(Data *d, Grid *grid, int Cl_ncalls, double x1_dom_len, in
       sprintf( chLine , "set save prefix \"cl_data.%04d.\"", Cl_ncalls);
       nleft = cdRead( chLine );
     #elif ( DIMENSIONS == 2 )
-      sprintf( chLine , "cl_data.%04d.%02ld.out", Cl_ncalls, (Pl_j-JBEG+joff));
+      sprintf( chLine , "cl_data.%04d.%02d.out", Cl_ncalls, Pl_jg);
       cdOutput( chLine);
-      sprintf( chLine , "set save prefix \"cl_data.%04d.%02ld.\"", Cl_ncalls, (Pl_j-JBEG+joff));
+      sprintf( chLine , "set save prefix \"cl_data.%04d.%02d.\"", Cl_ncalls, Pl_jg);
       nleft = cdRead( chLine );
     #else
-      sprintf( chLine , "cl_data.%04d.%02ld.%02ld.out", Cl_ncalls, (Pl_j-JBEG+joff), (Pl_k-KBEG+koff));
+      sprintf( chLine , "cl_data.%04d.%02d.%02d.out", Cl_ncalls, Pl_jg, Pl_kg);
       cdOutput( chLine);
-      sprintf( chLine , "set save prefix \"cl_data.%04d.%02ld.%02ld.\"", Cl_ncalls, (Pl_j-JBEG+joff), (Pl_k-KBEG+koff));
+      sprintf( chLine , "set save prefix \"cl_data.%04d.%02d.%02d.\"", Cl_ncalls, Pl_jg, Pl_kg);
       nleft = cdRead( chLine );
     #endif
     nleft = cdRead( "set save hash \"\"" );
-//     nleft = cdRead( "save overview \"over.tab\" last" );
-    nleft = cdRead( "save overview \"over.tab\" " );
-    nleft = cdRead( "save pressure \"pres.tab\" last" );
-//     nleft = cdRead( "save wind \"wind.tab\" last" );
-    nleft = cdRead( "save wind \"wind.tab\" " );
-    nleft = cdRead( "save dynamics advection \"dyna.tab\" last" );
-    nleft = cdRead( "save continuum \"continuum.tab\" last units Angstrom" );
-    // nleft = cdRead( "save hydrogen conditions \"H_cond.tab\" last" );
-    nleft = cdRead( "save cooling \"cool.tab\" last" );
-    // nleft = cdRead( "save heating \"heat.tab\" last" );
-    nleft = cdRead( "save ages \"ages.tab\" last" );
-    nleft = cdRead( "save species populations \"pops.tab\" last" );
-    nleft = cdRead( "save species energies \"energies.tab\" last" );
-    printf("I'm here3\n");  
+    for (n = 0; n < CL_NSAVE_TYPES; n++){
+      if ( !Cl_save[n] ) continue;
+      sprintf( chSave , "%s%s", Cl_save_types[n][1], (Cl_save[n] == 2 ? " last":""));
+      nleft = cdRead( chSave );
+    }
   }
 }
 
-void CloudyGetResults( Grid *grid ,int Pl_k, int Pl_j )
+void CloudyGetResults( Grid *grid, double *Pl_res )
 /*!
  * Retrieve the results from the computation
  * 
- * - creates arrays to retieve the results from the last Cloudy
- *   computation
- * - calls the cdget-functions
- * - calls the maping function, which also saves the result in
- *   userdefined variables.
- *
- * \param [in] grid     pointer to grid structure.
- * \param [in] int      k-indice of current Cloudy run
- * \param [in] int      j-indice of current Cloudy run
+ * - gets the zone structure of the last Cloudy computation
+ *   with a single call of cdZoneResults into the reusable
+ *   buffers Cl_zt, which are only enlarged if the number of
+ *   zones exceeds their size
+ * - calls the maping function, which saves the result in
+ *   the result column of the ray (see CloudyUnpackRay).
+ *
+ * \param [in]  grid     pointer to grid structure.
+ * \param [out] Pl_res   results of the current Cloudy run
  * 
  *********************************************************************** */
 {
-  int i;
-  int Cl_nzone;
-  static double *Cl_depth;
-  static double *Cl_numden, *Cl_massden, *Cl_meanmol;    // do I need static???
-  static double *Cl_cooling, *Cl_heating, *Cl_radheat;
-  static double *Cl_radaccel, *Cl_heateff, *Cl_eden;
-  double ***mean_mol, ***rad_heat, ***rad_accel, ***heat_eff, ***eden;
+  long i, nal;
+  long Cl_nzone;
+  Cl_ZoneTable *zt = &Cl_zt;
+  double *Cl_meanmol, *Cl_radheat, *Cl_radaccel, *Cl_heateff, *Cl_raddhdt;
   double aux_heat;
-  mean_mol = GetUserVar("U_MEAN_MOL");
-  rad_heat = GetUserVar("U_RAD_HEAT");
-  rad_accel = GetUserVar("U_RAD_ACCEL");
-  heat_eff = GetUserVar("U_HEAT_EFF");
-  eden = GetUserVar("U_EDEN");
-  
-  Cl_nzone = cdnZone();
- 
-  /* ------------------------------------------
-      these vectors must be allocated each time
-      because the number of zones in Cloudy
-      changes
-     ------------------------------------------ */
- 
-  Cl_depth     = ARRAY_1D(Cl_nzone, double);
-  Cl_numden    = ARRAY_1D(Cl_nzone, double);
-  Cl_massden   = ARRAY_1D(Cl_nzone, double);
-  Cl_meanmol   = ARRAY_1D(Cl_nzone, double);
-  Cl_cooling   = ARRAY_1D(Cl_nzone, double);
-  Cl_heating   = ARRAY_1D(Cl_nzone, double);
-  Cl_radheat   = ARRAY_1D(Cl_nzone, double);
-  Cl_radaccel  = ARRAY_1D(Cl_nzone, double);
-  Cl_heateff   = ARRAY_1D(Cl_nzone, double);
-  Cl_eden      = ARRAY_1D(Cl_nzone, double);
   
   /* ------------------------------------------
-      get results from last Cloudy run
+      get results from last Cloudy run, the
+      number of zones changes from model to
+      model, so enlarge the buffers if needed
      ------------------------------------------ */
 
-  cdDepth_depth(Cl_depth);
-  cdDenPart_depth(Cl_numden);
-  cdDenMass_depth(Cl_massden);
-  cdCooling_depth(Cl_cooling);
-  cdHeating_depth(Cl_heating);
-  cdRadAcce_depth(Cl_radaccel);
-  cdEDEN_depth(Cl_eden);
+  Cl_nzone = cdZoneResults(zt->depth, zt->numden, zt->massden,
+                           zt->cooling, zt->heating,
+                           zt->val + 2*zt->nalloc, zt->val + 4*zt->nalloc,
+                           zt->nalloc);
+  if (Cl_nzone > zt->nalloc){
+    if (zt->nalloc > 0){
+      FreeArray1D(zt->depth);
+      FreeArray1D(zt->val);
+    }
+    nal = Cl_nzone + Cl_nzone/2;
+    zt->depth   = ARRAY_1D(5*nal, double);
+    zt->numden  = zt->depth + nal;
+    zt->massden = zt->depth + 2*nal;
+    zt->cooling = zt->depth + 3*nal;
+    zt->heating = zt->depth + 4*nal;
+    zt->val     = ARRAY_1D(CL_NRAY_VARS*nal, double);
+    zt->nalloc  = nal;
+    cdZoneResults(zt->depth, zt->numden, zt->massden,
+                  zt->cooling, zt->heating,
+                  zt->val + 2*nal, zt->val + 4*nal, nal);
+  }
+  
+  nal = zt->nalloc;
+  
+  /* -- level populations for the transit spectra -- */
+  if ( cdIsoPop_depth(ipHE_LIKE, ipHELIUM, ipHe2s3S, zt->val + 5*nal) ){
+    for ( i = 0; i < Cl_nzone; i++) zt->val[5*nal + i] = 0.0;
+  }
+  if ( cdIsoPop_depth(ipH_LIKE, ipHYDROGEN, ipH1s, zt->val + 6*nal) ){
+    for ( i = 0; i < Cl_nzone; i++) zt->val[6*nal + i] = 0.0;
+  }
+  
+  /* -- temperature derivative for the implicit heating -- */
+  cdCoolHeatDeriv_depth(zt->val + 8*nal, zt->val + 7*nal);
+  
+  Cl_meanmol  = zt->val;            /* same order as Cl_ray_vars */
+  Cl_radheat  = zt->val + nal;
+  Cl_radaccel = zt->val + 2*nal;
+  Cl_heateff  = zt->val + 3*nal;   /* eden is filled by cdZoneResults */
+  Cl_raddhdt  = zt->val + 7*nal;
   
   /* ------------------------------------------
       only pass difference of rad. heating/cooling
@@ -798,11 +2978,12 @@ void CloudyGetResults( Grid *grid ,int Pl_k, int Pl_j )
         Cloudy
      ------------------------------------------ */
   for ( i = 0; i < Cl_nzone; i++){
-    Cl_meanmol[i] = Cl_massden[i]/(CONST_amu*Cl_numden[i]);
-    aux_heat = fabs(Cl_heating[i] - Cl_cooling[i])/MAX(MAX(fabs(Cl_heating[i]),fabs(Cl_cooling[i])),1.e-30);
-    Cl_radheat[i] = (aux_heat > 0.005 ? Cl_heating[i]-Cl_cooling[i]:0.0);
-    Cl_heateff[i] = (aux_heat > 0.005 ? (Cl_heating[i] - Cl_cooling[i])/Cl_heating[i]:0.0);
+    Cl_meanmol[i] = zt->massden[i]/(CONST_amu*zt->numden[i]);
+    aux_heat = fabs(zt->heating[i] - zt->cooling[i])/MAX(MAX(fabs(zt->heating[i]),fabs(zt->cooling[i])),1.e-30);
+    Cl_radheat[i] = (aux_heat > 0.005 ? zt->heating[i]-zt->cooling[i]:0.0);
+    Cl_heateff[i] = (aux_heat > 0.005 ? (zt->heating[i] - zt->cooling[i])/zt->heating[i]:0.0);
     Cl_radaccel[i] *= -1;
+    Cl_raddhdt[i]  *= -1;      /* d(C-H)/dT from Cloudy */
   }
    
   /* ------------------------------------------
@@ -813,89 +2994,566 @@ void CloudyGetResults( Grid *grid ,int Pl_k, int Pl_j )
         temp. from PLUTO to Cloudy
      ------------------------------------------ */
   
-  MapCloudytoPLUTO( grid, mean_mol, Pl_k, Pl_j,
-                    Cl_depth, Cl_meanmol, Cl_nzone );
-  
-  mean_mol[Pl_k][Pl_j][IBEG-1] = mean_mol[Pl_k][Pl_j][IBEG];
-  
-  MapCloudytoPLUTO( grid, rad_heat, Pl_k, Pl_j,
-                    Cl_depth, Cl_radheat, Cl_nzone );
-  
-  MapCloudytoPLUTO( grid, rad_accel, Pl_k, Pl_j,
-                    Cl_depth, Cl_radaccel, Cl_nzone );
-  
-  MapCloudytoPLUTO( grid, heat_eff, Pl_k, Pl_j,
-                    Cl_depth, Cl_heateff, Cl_nzone );
+  CloudyTimerStart(CL_TM_MAP);
+  MapCloudytoPLUTO( grid, Pl_res, zt->depth, zt->val, Cl_nzone, nal );
+  CloudyTimerStop(CL_TM_MAP);
   
-  MapCloudytoPLUTO( grid, eden, Pl_k, Pl_j,
-                    Cl_depth, Cl_eden, Cl_nzone );
-  
-  FreeArray1D(Cl_depth);
-  FreeArray1D(Cl_numden);
-  FreeArray1D(Cl_massden);
-  FreeArray1D(Cl_meanmol);
-  FreeArray1D(Cl_cooling);
-  FreeArray1D(Cl_heating);
-  FreeArray1D(Cl_radheat);
-  FreeArray1D(Cl_radaccel);
-  FreeArray1D(Cl_heateff);
-  FreeArray1D(Cl_eden);
+  Pl_res[IBEG-1] = Pl_res[IBEG];
 }
 
-void MapCloudytoPLUTO( Grid *grid, double ***Pl_val, int Pl_k, int Pl_j, 
-                       double *Cl_depth, double *Cl_val, int Cl_nzone )
+void MapCloudytoPLUTO( Grid *grid, double *Pl_res, double *Cl_depth,
+                       double *Cl_val, long Cl_nzone, long Cl_nalloc )
 /*!
  * Interpolate Cloudy results onto the PLUTO grid
  *
- * Interpolates one result (eg., radiative heating) onto a
- * userdef variable. The result is then available throughout the
- * code.   
+ * Interpolates all results (eg., radiative heating) onto the
+ * x1 profile of a ray, which is later copied into the userdef
+ * variables (CloudyUnpackRay). The interpolation zones and
+ * weights are computed once and then applied to every result.
  * 
- * \param [in] grid     pointer to grid structure.
- * \param [in] double   pointer userdef variable.
- * \param [in] int      k-indice of current Cloudy run
- * \param [in] int      j-indice of current Cloudy run
- * \param [in] double   pointer Cloudy depth structure.
- * \param [in] double   pointer Cloudy result structure.
- * \param [in] int      number of zone in Cloudy run
+ * \param [in]  grid      pointer to grid structure.
+ * \param [out] Pl_res    x1 profiles of the results (CL_NRAY_VARS*NX1_TOT).
+ * \param [in]  Cl_depth  Cloudy depth structure.
+ * \param [in]  Cl_val    Cloudy result structures (CL_NRAY_VARS*Cl_nalloc).
+ * \param [in]  Cl_nzone  number of zone in Cloudy run
+ * \param [in]  Cl_nalloc distance of the result structures in Cl_val
  *
  *********************************************************************** */
 {
-  int i,ilow, ihigh, imid;
-  double x1, dlt_x;
+  int i, n;
+  long iz;
+  int *ilow, *ihigh;
+  double x1, *wght, *Pl_val, *val;
   
-  IDOM_LOOP(i){
+  if (Cl_zt.wght == NULL){
+    Cl_zt.ilow  = ARRAY_1D(NX1_TOT, int);
+    Cl_zt.ihigh = ARRAY_1D(NX1_TOT, int);
+    Cl_zt.wght  = ARRAY_1D(NX1_TOT, double);
+  }
+  ilow  = Cl_zt.ilow;
+  ihigh = Cl_zt.ihigh;
+  wght  = Cl_zt.wght;
+  
+  /* ------------------------------------------
+      the depth increases with decreasing i, so
+      the zones are found in a single sweep
+     ------------------------------------------ */
+  
+  iz = 0;
+  for (i = IEND; i >= IBEG; i--){
     
     x1 = (grid[IDIR].x[IEND] - grid[IDIR].x[i])*g_unitLength;
     
-    if (x1 > Cl_depth[Cl_nzone-1]){
-      Pl_val[Pl_k][Pl_j][i] = Cl_val[Cl_nzone-1];
+    if (x1 >= Cl_depth[Cl_nzone-1]){
+      ilow[i] = ihigh[i] = Cl_nzone-1;
+      wght[i] = 0.0;
     }
     else if (x1 < Cl_depth[0]){
-      Pl_val[Pl_k][Pl_j][i] = Cl_val[0];
+      ilow[i] = ihigh[i] = 0;
+      wght[i] = 0.0;
     }
     else{
       /* *** TABLE LOOKUP *** */
-      ilow = 0;
-      ihigh = Cl_nzone - 1;
-      while (ilow != (ihigh-1)){
-        imid = (ilow+ihigh)/2;
-        if (x1 <= Cl_depth[imid]){
-          ihigh = imid;
-        }else if (x1 > Cl_depth[imid]){
-          ilow = imid;
+      while (Cl_depth[iz+1] < x1) iz++;
+      ilow[i]  = iz;
+      ihigh[i] = iz+1;
+      wght[i]  = (x1 - Cl_depth[iz])/(Cl_depth[iz+1] - Cl_depth[iz]);
+    }
+  }
+  
+  /* *** INTERPOLATE *** */
+  for (n = 0; n < CL_NRAY_VARS; n++){
+    Pl_val = Pl_res + n*NX1_TOT;
+    val    = Cl_val + n*Cl_nalloc;
+    IDOM_LOOP(i){
+      Pl_val[i] = val[ilow[i]] + wght[i]*(val[ihigh[i]] - val[ilow[i]]);
+    }
+  }
+}
+
+
+
+
+
+
+
+
+void TransitSpectrum(const Data *d, Grid *grid)
+/*!
+ * Compute the transit spectra of the lines in Tr_lines
+ * (called from Analysis)
+ *
+ * The excess absorption is computed from the level populations,
+ * temperature and x1 velocity of every ray (j,k). Each ray is
+ * assumed to be a spherically symmetric atmosphere, i.e. the
+ * chords through all impact parameters see only the profiles of
+ * this ray (TransitLineDepth). The spectrum is the mean of the
+ * rays weighted with their volume factor in x2 and x3 (the solid
+ * angle in spherical geometry), summed over all processors.
+ * This is exact in 1D and an approximation for 2D and 3D
+ * atmospheres, which are not spherically symmetric.
+ * Every spectrum is written by processor 0 to
+ * transit.<name>.NNNN.tab: wavelength (Angstrom, vacuum) and
+ * excess absorption.
+ *
+ * \param [in] d     pointer to PLUTO Data structure
+ * \param [in] grid  pointer to grid structure.
+ *
+ *********************************************************************** */
+{
+  static int Tr_ncalls = 0;
+  static int lg_line[TR_NLINES];
+  static double Tr_rstar = TRANSIT_RSTAR, Tr_rmax = TRANSIT_RMAX;
+  static double Tr_scale = TRANSIT_SCALE;
+  static double *Pl_r, *Pl_dr, *Pl_n, *Pl_T, *Pl_v;
+  int i, j, k, n, m, nl, nr, nwl;
+  double w, wsum;
+  double *Tr_wl, *Tr_depth, *Tr_mean;
+  double ***uvar, ***mean_mol;
+  char chFile[64];
+  FILE *fp;
+  
+  if ( Pl_r == NULL ){
+    Pl_r  = ARRAY_1D(NX1_TOT, double);
+    Pl_dr = ARRAY_1D(NX1_TOT, double);
+    Pl_n  = ARRAY_1D(NX1_TOT, double);
+    Pl_T  = ARRAY_1D(NX1_TOT, double);
+    Pl_v  = ARRAY_1D(NX1_TOT, double);
+    
+    for (nl = 0; nl < TR_NLINES; nl++) lg_line[nl] = YES;
+    if ( ParQuery ("Transit_lines") ){
+      for (nl = 0; nl < TR_NLINES; nl++) lg_line[nl] = NO;
+      n = atoi(ParGet("Transit_lines", 1));
+      for (m = 0; m < n; m++){
+        char *chLine = ParGet("Transit_lines", 2+m);
+        for (nl = 0; nl < TR_NLINES; nl++){
+          if ( strcmp(chLine, Tr_lines[nl].name) == 0 ) break;
+        }
+        if ( nl == TR_NLINES ){
+          print1 ("! TransitSpectrum: unknown line '%s'\n", chLine);
+          QUIT_PLUTO(1);
+        }
+        lg_line[nl] = YES;
+      }
+    }
+    if ( ParQuery ("Transit_rstar") ) Tr_rstar = atof(ParGet("Transit_rstar", 1));
+    if ( ParQuery ("Transit_rmax") )  Tr_rmax  = atof(ParGet("Transit_rmax", 1));
+    if ( ParQuery ("Transit_scale") ) Tr_scale = atof(ParGet("Transit_scale", 1));
+  }
+  Tr_ncalls++;
+  
+  mean_mol = GetUserVar("U_MEAN_MOL");
+  
+  /* -- total weight of the rays -- */
+  
+  wsum = 0.0;
+  KDOM_LOOP(k){
+    JDOM_LOOP(j){
+      w = 1.0;
+      #if ( DIMENSIONS >= 2 )
+       w *= grid[JDIR].dV[j];
+      #endif
+      #if ( DIMENSIONS == 3 )
+       w *= grid[KDIR].dV[k];
+      #endif
+      wsum += w;
+    }
+  }
+  #ifdef PARALLEL
+   MPI_Allreduce (MPI_IN_PLACE, &wsum, 1, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+  #endif
+  
+  for (nl = 0; nl < TR_NLINES; nl++){
+    if ( !lg_line[nl] ) continue;
+    const Tr_Line *line = Tr_lines + nl;
+    
+    uvar = GetUserVar((char *)line->uvar);
+    
+    /* -- logarithmic wavelength grid with resolution res -- */
+    nwl = (int)(log(line->lmax/line->lmin)*line->res) + 1;
+    Tr_wl    = ARRAY_1D(nwl, double);
+    Tr_depth = ARRAY_1D(nwl, double);
+    Tr_mean  = ARRAY_1D(nwl, double);
+    for (n = 0; n < nwl; n++){
+      Tr_wl[n]   = line->lmin*exp(n/line->res);
+      Tr_mean[n] = 0.0;
+    }
+    
+    /* ------------------------------------------
+        spherically symmetric spectrum of every
+        local ray, weighted sum of all rays
+       ------------------------------------------ */
+    
+    KDOM_LOOP(k){
+      JDOM_LOOP(j){
+        nr = 0;
+        IDOM_LOOP(i){
+          Pl_r[nr]  = grid[IDIR].x[i]*g_unitLength;
+          Pl_dr[nr] = grid[IDIR].dx[i]*g_unitLength;
+          Pl_n[nr]  = Tr_scale*uvar[k][j][i];
+          Pl_T[nr]  = KELVIN*mean_mol[k][j][i]*d->Vc[PRS][k][j][i]/d->Vc[RHO][k][j][i];
+          Pl_v[nr]  = Tr_scale*d->Vc[VX1][k][j][i]*g_unitVelocity;
+          nr++;
+        }
+        
+        TransitLineDepth(line, Pl_r, Pl_dr, Pl_n, Pl_T, Pl_v, nr, Tr_rstar*CONST_Rsun,
+                         Tr_rmax*g_unitLength, Tr_wl, Tr_depth, nwl);
+        
+        w = 1.0;
+        #if ( DIMENSIONS >= 2 )
+         w *= grid[JDIR].dV[j];
+        #endif
+        #if ( DIMENSIONS == 3 )
+         w *= grid[KDIR].dV[k];
+        #endif
+        for (n = 0; n < nwl; n++) Tr_mean[n] += w/wsum*Tr_depth[n];
+      }
+    }
+    #ifdef PARALLEL
+     MPI_Allreduce (MPI_IN_PLACE, Tr_mean, nwl, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+    #endif
+    
+    if ( prank == 0 ){
+      sprintf (chFile, "transit.%s.%04d.tab", line->name, Tr_ncalls-1);
+      fp = fopen(chFile, "w");
+      if ( fp == NULL ){
+        print1 ("! TransitSpectrum: cannot open %s\n", chFile);
+      }else{
+        fprintf (fp, "# t = %12.6e, step %ld\n", g_time, g_stepNumber);
+        fprintf (fp, "# lambda (A)       excess absorption\n");
+        for (n = 0; n < nwl; n++) fprintf (fp, "%14.8e  %12.6e\n", Tr_wl[n], Tr_mean[n]);
+        fclose(fp);
+      }
+    }
+    
+    FreeArray1D(Tr_wl);
+    FreeArray1D(Tr_depth);
+    FreeArray1D(Tr_mean);
+  }
+}
+
+void TransitLineDepth(const Tr_Line *line, double *Pl_r, double *Pl_dr, double *Pl_n,
+                      double *Pl_T, double *Pl_v, int nr, double Tr_rstar,
+                      double Tr_rmax, double *Tr_wl, double *Tr_depth, int nwl)
+/*!
+ * Excess absorption of one line for a spherically symmetric profile
+ *
+ * The optical depth is integrated along chords with impact 
+ * parameters b at the cell centers. Every shell is crossed twice
+ * with the line of sight velocity +-v z/r at the middle of the
+ * segment and constant density and temperature. The Voigt
+ * profile is evaluated for all wavelengths at once (VoigtU).
+ * Segments with a line center optical depth scale below
+ * TR_TAU_MIN do not contribute.
+ *
+ *   depth = 2/R_star^2 sum_b b db (1 - exp(-tau(b)))
+ *
+ * The chords are distributed over the OpenMP threads (compile
+ * with -fopenmp, see local_make), every thread has its own buffers.
+ *
+ * \param [in]  line      line data
+ * \param [in]  Pl_r      radii of the cell centers (cm)
+ * \param [in]  Pl_dr     widths of the cells (cm)
+ * \param [in]  Pl_n      population of the lower level (cm-3)
+ * \param [in]  Pl_T      temperature (K)
+ * \param [in]  Pl_v      radial velocity (cm/s)
+ * \param [in]  nr        number of cells
+ * \param [in]  Tr_rstar  stellar radius (cm)
+ * \param [in]  Tr_rmax   outer radius of the chords (cm), 0 = last cell
+ * \param [in]  Tr_wl     wavelengths (Angstrom)
+ * \param [out] Tr_depth  excess absorption
+ * \param [in]  nwl       number of wavelengths
+ *
+ *********************************************************************** */
+{
+  int ib, nt, nthr = 1;
+  double rmax;
+  double *Tr_wn;
+  double **Tr_sum, **Tr_tau;
+  realnum **Tr_x, **Tr_y;
+  
+  rmax = Pl_r[nr-1] + 0.5*Pl_dr[nr-1];
+  if ( Tr_rmax > 0.0 ) rmax = MIN(rmax, Tr_rmax);
+  
+  #ifdef _OPENMP
+   nthr = omp_get_max_threads();
+  #endif
+  
+  Tr_wn  = ARRAY_1D(nwl, double);
+  Tr_sum = ARRAY_2D(nthr, nwl, double);
+  Tr_tau = ARRAY_2D(nthr, nwl, double);
+  Tr_x   = ARRAY_2D(nthr, nwl, realnum);
+  Tr_y   = ARRAY_2D(nthr, nwl, realnum);
+  
+  for (int n = 0; n < nwl; n++) Tr_wn[n] = 1.e8/Tr_wl[n];
+  for (nt = 0; nt < nthr; nt++){
+    for (int n = 0; n < nwl; n++) Tr_sum[nt][n] = 0.0;
+  }
+  
+  #ifdef _OPENMP
+   #pragma omp parallel for schedule(dynamic)
+  #endif
+  for (ib = 0; ib < nr; ib++){
+    int i, n, nc, side, ith = 0;
+    double b, rin, rout, zin, zout, zmid, vlos;
+    double wn0, dwnD, a, coef;
+    double *tau;
+    realnum *x, *y;
+    
+    #ifdef _OPENMP
+     ith = omp_get_thread_num();
+    #endif
+    b = Pl_r[ib];
+    if ( b >= rmax ) continue;
+    
+    x   = Tr_x[ith];
+    y   = Tr_y[ith];
+    tau = Tr_tau[ith];
+    for (n = 0; n < nwl; n++) tau[n] = 0.0;
+    
+    for (i = ib; i < nr; i++){
+      rin  = MAX(b, Pl_r[i] - 0.5*Pl_dr[i]);
+      rout = MIN(rmax, Pl_r[i] + 0.5*Pl_dr[i]);
+      if ( rout <= rin || Pl_n[i] <= 0.0 ) continue;
+      zin  = sqrt(rin*rin - b*b);
+      zout = sqrt(rout*rout - b*b);
+      zmid = 0.5*(zin + zout);
+      
+      for (nc = 0; nc < line->ncomp; nc++){
+        wn0  = 1.e8/line->wl[nc];
+        dwnD = wn0*sqrt(2.0*CONST_kB*Pl_T[i]/(line->mass*CONST_amu))/CONST_c;
+        a    = line->A/(4.0*CONST_PI*CONST_c)/dwnD;
+        coef = Pl_n[i]*(zout - zin)*TR_PI_E2_MEC2*line->f[nc]/dwnD;
+        if ( coef < TR_TAU_MIN ) continue;
+        
+        for (side = -1; side <= 1; side += 2){
+          vlos = side*Pl_v[i]*zmid/Pl_r[i];
+          for (n = 0; n < nwl; n++) x[n] = (realnum)((Tr_wn[n] - wn0*(1.0 + vlos/CONST_c))/dwnD);
+          VoigtU((realnum)a, x, y, nwl);
+          for (n = 0; n < nwl; n++) tau[n] += coef*y[n];
         }
       }
-      /* *** INTERPOLATE *** */
-      dlt_x = (x1 - Cl_depth[ilow])/(Cl_depth[ihigh] - Cl_depth[ilow]);
-      Pl_val[Pl_k][Pl_j][i] = Cl_val[ilow] + dlt_x*(Cl_val[ihigh] - Cl_val[ilow]);
     }
-  } 
+    
+    for (n = 0; n < nwl; n++){
+      Tr_sum[ith][n] += 2.0*b*Pl_dr[ib]*(1.0 - exp(-tau[n]))/(Tr_rstar*Tr_rstar);
+    }
+  }
+  
+  for (int n = 0; n < nwl; n++){
+    Tr_depth[n] = 0.0;
+    for (nt = 0; nt < nthr; nt++) Tr_depth[n] += Tr_sum[nt][n];
+  }
+  
+  FreeArray1D(Tr_wn);
+  FreeArray2D((void **)Tr_sum);
+  FreeArray2D((void **)Tr_tau);
+  FreeArray2D((void **)Tr_x);
+  FreeArray2D((void **)Tr_y);
+}
+
+
+double CloudyClock()
+/*!
+ * Wall clock time (s) since an arbitrary origin
+ *
+ *********************************************************************** */
+{
+  struct timespec ts;
+  
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + 1.e-9*(double)ts.tv_nsec;
+}
+
+void CloudyTimerStart(int n)
+/*!
+ * Start timer n (see cloudy_timer.h)
+ *
+ *********************************************************************** */
+{
+  Cl_tm[n].t0 = CloudyClock();
 }
 
+void CloudyTimerStop(int n)
+/*!
+ * Stop timer n and add the time since CloudyTimerStart
+ *
+ *********************************************************************** */
+{
+  Cl_Timer *tm = Cl_tm + n;
+  double dt = CloudyClock() - tm->t0;
+  
+  tm->tmin   = ( tm->calls > 0.0 ? MIN(tm->tmin, dt):dt );
+  tm->tmax   = MAX(tm->tmax, dt);
+  tm->wall  += dt;
+  tm->calls += 1.0;
+}
 
+void CloudyTimerPause(int n)
+/*!
+ * Stop timer n and add the time since CloudyTimerStart without
+ * counting a call, for a phase which is spread over several
+ * intervals (the rays, see CloudyTimerCount)
+ *
+ *********************************************************************** */
+{
+  Cl_tm[n].wall += CloudyClock() - Cl_tm[n].t0;
+}
 
+void CloudyTimerCount(int n, int ncalls)
+/*!
+ * Count ncalls finished calls of timer n, whose time was added
+ * with CloudyTimerPause. The shortest and longest call are not
+ * known in this case.
+ *
+ *********************************************************************** */
+{
+  Cl_tm[n].calls += ncalls;
+}
 
+void CloudyTimerMerge(Cl_Timer *tm, int nbeg, int nend)
+/*!
+ * Add the timers nbeg...nend of a worker process
+ *
+ * \param [in] tm   timers nbeg...nend of the worker
+ *
+ *********************************************************************** */
+{
+  int n;
+  
+  for (n = nbeg; n <= nend; n++, tm++){
+    if ( tm->calls == 0.0 ) continue;
+    Cl_tm[n].tmin   = ( Cl_tm[n].calls > 0.0 ? MIN(Cl_tm[n].tmin, tm->tmin):tm->tmin );
+    Cl_tm[n].tmax   = MAX(Cl_tm[n].tmax, tm->tmax);
+    Cl_tm[n].wall  += tm->wall;
+    Cl_tm[n].cpu   += tm->cpu;
+    Cl_tm[n].calls += tm->calls;
+  }
+}
 
+void CloudyTimerReport(int lg_final)
+/*!
+ * Write the timers of all processors to CL_TM_FILE (collective)
+ * 
+ * The file is rewritten at the first report of a run, later 
+ * reports are appended. Every line holds one timer of one 
+ * processor (accumulated since the start of the run):
+ * step, time, rank, name, calls, wall, cpu, min, max.
+ * The final report also prints a summary and the peak memory
+ * use (cdMaxRSS): calls and total time are the maximum over the
+ * processors, min/mean/max are the statistics of a single call
+ * over all processors (e.g. of one ray for cloudy/rays/ray).
+ *
+ * \param [in] lg_final  YES at the end of the run
+ *
+ *********************************************************************** */
+{
+  static bool lg_first = true;
+  int n, r, nproc = 1;
+  double *all = (double *)Cl_tm;
+  double rss = cdMaxRSS();
+  Cl_Timer *tm;
+  FILE *fp;
+  
+  #ifdef PARALLEL
+   if ( lg_final ){
+     double rss_max;
+     MPI_Reduce (&rss, &rss_max, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+     rss = rss_max;
+   }
+   MPI_Comm_size (MPI_COMM_WORLD, &nproc);
+   if ( prank == 0 ) all = ARRAY_1D(nproc*CL_NTIMERS*CL_TM_NREC, double);
+   MPI_Gather (Cl_tm, CL_NTIMERS*CL_TM_NREC, MPI_DOUBLE, all, CL_NTIMERS*CL_TM_NREC,
+               MPI_DOUBLE, 0, MPI_COMM_WORLD);
+  #endif
+  
+  if ( prank == 0 ){
+    fp = fopen(CL_TM_FILE, (lg_first ? "w":"a"));
+    if ( fp == NULL ){
+      print1 ("! CloudyTimerReport: cannot open %s\n", CL_TM_FILE);
+    }else{
+      if ( lg_first ){
+        fprintf (fp, "# step  t  rank  timer  calls  wall[s]  cpu[s]  min[s]  max[s]\n");
+      }
+      for (r = 0; r < nproc; r++){
+        tm = (Cl_Timer *)all + r*CL_NTIMERS;
+        for (n = 0; n < CL_NTIMERS; n++, tm++){
+          fprintf (fp, "%ld %12.6e %d %s %.0f %12.6e %12.6e %12.6e %12.6e\n",
+                   g_stepNumber, g_time, r, Cl_tm_names[n], tm->calls, tm->wall,
+                   tm->cpu, tm->tmin, tm->tmax);
+        }
+      }
+      fclose (fp);
+    }
+    
+    if ( lg_final ){
+      print1 ("\n> Timers (wall clock [s], %d processor(s)):\n", nproc);
+      print1 ("  %-28s %10s %12s %12s %12s %12s\n", "timer", "calls", "total", 
+              "min", "mean", "max");
+      for (n = 0; n < CL_NTIMERS; n++){
+        double calls = 0.0, wall = 0.0, sum_calls = 0.0, sum_wall = 0.0;
+        double tmin = -1.0, tmax = 0.0;
+        for (r = 0; r < nproc; r++){
+          tm = (Cl_Timer *)all + r*CL_NTIMERS + n;
+          calls = MAX(calls, tm->calls);
+          wall  = MAX(wall, tm->wall);
+          sum_calls += tm->calls;
+          sum_wall  += tm->wall;
+          if ( tm->tmax > 0.0 ){
+            tmin = ( tmin < 0.0 ? tm->tmin:MIN(tmin, tm->tmin) );
+            tmax = MAX(tmax, tm->tmax);
+          }
+        }
+        if ( calls == 0.0 ) continue;
+        if ( tmin < 0.0 ){   /* -- counted with CloudyTimerCount -- */
+          print1 ("  %-28s %10.0f %12.4e %12s %12.4e %12s\n", Cl_tm_names[n], calls, wall,
+                  "-", sum_wall/sum_calls, "-");
+        }else{
+          print1 ("  %-28s %10.0f %12.4e %12.4e %12.4e %12.4e\n", Cl_tm_names[n], calls, wall,
+                  tmin, sum_wall/sum_calls, tmax);
+        }
+      }
+      print1 ("  peak memory %.1f MB (max over processors)\n", rss);
+    }
+    #ifdef PARALLEL
+     FreeArray1D(all);
+    #endif
+  }
+  lg_first = false;
+}
 
+size_t CloudyPipeWrite(int fd, void *vbuf, size_t len)
+/*!
+ * Write len bytes to the pipe of a worker
+ *
+ * \return the number of bytes which could not be written
+ *
+ *********************************************************************** */
+{
+  char *buf = (char *)vbuf;
+  
+  while ( len > 0 ){
+    ssize_t nw = write(fd, buf, len);
+    if ( nw <= 0 ) break;
+    buf += nw; len -= nw;
+  }
+  return len;
+}
 
+size_t CloudyPipeRead(int fd, void *vbuf, size_t len)
+/*!
+ * Read len bytes from the pipe of a worker
+ *
+ * \return the number of bytes which could not be read
+ *
+ *********************************************************************** */
+{
+  char *buf = (char *)vbuf;
+  
+  while ( len > 0 ){
+    ssize_t nr = read(fd, buf, len);
+    if ( nr <= 0 ) break;
+    buf += nr; len -= nr;
+  }
+  return len;
+}
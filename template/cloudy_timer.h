@@ -0,0 +1,43 @@
+/* ///////////////////////////////////////////////////////////////////// */
+/*!
+  \file
+  \brief TPCI phase timers
+
+  Named timers of the phases of a TPCI run (see CloudyTimerStart
+  in call_cloudy.cpp). The names give the hierarchy: a timer is
+  running whenever one of its children runs. The waits in MPI
+  barriers and reductions (mpi_wait) are also counted in the phase
+  which waits.
+  The timers are accumulated per processor. The timers of a ray
+  (cloudy/rays/ray and below) are counted once per ray, also when
+  the ray is solved in a worker process. cloudy/rays counts the
+  rays solved by the processor as calls, its time includes all
+  polls of an asynchronous solution.
+*/
+/* ///////////////////////////////////////////////////////////////////// */
+
+#ifndef CLOUDY_TIMER_H
+#define CLOUDY_TIMER_H
+
+/*! \name Timers */
+/**@{ */
+#define CL_TM_INTEGRATE   0   /**< integrate: hydro step (Integrate) */
+#define CL_TM_CLOUDY      1   /**< cloudy: CloudyRadSolve */
+#define CL_TM_CHECK       2   /**< cloudy/check: selection of the rays */
+#define CL_TM_RAYS        3   /**< cloudy/rays: solution of the selected rays, one call per solved ray */
+#define CL_TM_RAY         4   /**< cloudy/rays/ray: one ray (CallCloudy) */
+#define CL_TM_INIT        5   /**< cloudy/rays/ray/init: cdInit */
+#define CL_TM_SCRIPT      6   /**< cloudy/rays/ray/script: input script */
+#define CL_TM_DRIVE       7   /**< cloudy/rays/ray/drive: cdDrive */
+#define CL_TM_RESULTS     8   /**< cloudy/rays/ray/results: CloudyGetResults */
+#define CL_TM_MAP         9   /**< cloudy/rays/ray/results/map: MapCloudytoPLUTO */
+#define CL_TM_OUTPUT     10   /**< output: CheckForOutput */
+#define CL_TM_MPI        11   /**< mpi_wait: barriers and reductions */
+#define CL_NTIMERS       12
+/**@} */
+
+void CloudyTimerStart(int n);
+void CloudyTimerStop(int n);
+void CloudyTimerReport(int lg_final);
+
+#endif
@@ -14,6 +14,8 @@
 #include "pluto.h"
 #include "params.h"
 
+void TransitSpectrum (const Data *, Grid *);
+
 /* ********************************************************************* */
 void Init (double *vars, double r, double theta, double phi)
 /*! 
@@ -78,12 +80,15 @@ void Analysis (const Data *d, Grid *grid)
 /*! 
  *  Perform runtime data analysis.
  *
+ *  The transit spectra are computed from the last Cloudy
+ *  models (TransitSpectrum in call_cloudy.cpp).
+ *
  * \param [in] d the PLUTO Data structure
  * \param [in] grid   pointer to array of Grid structures  
  *
  *********************************************************************** */
 {
-
+  TransitSpectrum (d, grid);
 }
 #if PHYSICS == MHD
 /* ********************************************************************* */
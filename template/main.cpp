@@ -47,6 +47,12 @@
   
   CHANGES (M. Salz)
    -  call to the Cloudy interface between hydro steps
+   -  phase timers (cloudy_timer.h), written at every log 
+      step and at the end
+   -  the coupling state of the Cloudy interface is written with
+      the restart dumps and restored on restart
+   -  waits for the background write of the hdf5 output
+      (dbl.h5/flt.h5 in mode single_file_async) before exiting
 */
 /* ///////////////////////////////////////////////////////////////////// */
 
@@ -58,6 +64,7 @@ extern "C" {
   #include "pluto.h"
   #include "globals.h"
 }
+#include "cloudy_timer.h"
 
 #define SHOW_TIME_STEPS  NO   /* -- show time steps due to advection,
                                      diffusion and cooling */
@@ -69,6 +76,9 @@ static void CheckForOutput (Data *, Input *, Grid *);
 static void CheckForAnalysis (Data *, Input *, Grid *);
 
 int CloudyRadSolve(Data *, Time_Step *, Grid *, int, int);
+void CloudyCouplingDump(int);
+int CloudyCouplingRestart(Input *, int, int);
+void CloudyFinalize();
 
 /* ********************************************************************* */
 int main (int argc, char *argv[])
@@ -83,7 +93,7 @@ int main (int argc, char *argv[])
  *********************************************************************** */
 {
   int    nv, idim, err;
-  int    Cloudy_called = 0;
+  int    Cloudy_called = 0, Cloudy_coupling = NO;
   char   first_step=1, last_step = 0;
   double scrh;
   Data   data;
@@ -140,10 +150,14 @@ int main (int argc, char *argv[])
    
   if (cmd_line.restart == YES) {
     Restart (&ini, cmd_line.nrestart, DBL_OUTPUT, grd);
+    Cloudy_coupling = CloudyCouplingRestart (&ini, cmd_line.nrestart, DBL_OUTPUT);
   }else if (cmd_line.h5restart == YES){
     Restart (&ini, cmd_line.nrestart, DBL_H5_OUTPUT, grd);
+    Cloudy_coupling = CloudyCouplingRestart (&ini, cmd_line.nrestart, DBL_H5_OUTPUT);
   }else if (cmd_line.write){
+    CloudyTimerStart(CL_TM_OUTPUT);
     CheckForOutput (&data, &ini, grd);
+    CloudyTimerStop(CL_TM_OUTPUT);
     CheckForAnalysis (&data, &ini, grd);
     #ifdef USE_ASYNC_IO
      Async_EndWriteData (&ini);
@@ -189,6 +203,7 @@ int main (int argc, char *argv[])
        print1 (", Nrkc = %d",Dts.Nrkc);
       #endif
       print1 ("]\n");      
+      CloudyTimerReport(NO);
     }
 
   /* ------------------------------------------------------
@@ -196,7 +211,9 @@ int main (int argc, char *argv[])
      ------------------------------------------------------ */
 
     if (!first_step && !last_step && cmd_line.write) {
+      CloudyTimerStart(CL_TM_OUTPUT);
       CheckForOutput  (&data, &ini, grd);
+      CloudyTimerStop(CL_TM_OUTPUT);
       CheckForAnalysis(&data, &ini, grd);
     }
     
@@ -207,11 +224,12 @@ int main (int argc, char *argv[])
      ------------------------------------------------------ */
   
     Cloudy_called = CloudyRadSolve(&data, &Dts, grd, cmd_line.restart, last_step);
-    if ( first_step || last_step ){
+    if ( (first_step && !Cloudy_coupling) || last_step ){
       // first call needs two calls of Cloudy:
       // - first solve mean molecular weight
       //   --> affects the temperature, which is passed to Cloudy
       // - then solve heating cooling
+      // not needed after a restart with the coupling state
       Cloudy_called = CloudyRadSolve(&data, &Dts, grd, cmd_line.restart, last_step);
     }
     
@@ -221,7 +239,9 @@ int main (int argc, char *argv[])
      ------------------------------------------------------ */
 
     if (cmd_line.jet != -1) SetJetDomain (&data, cmd_line.jet, ini.log_freq, grd); 
+    CloudyTimerStart(CL_TM_INTEGRATE);
     err = Integrate (&data, Solver, &Dts, grd);
+    CloudyTimerStop(CL_TM_INTEGRATE);
     if (cmd_line.jet != -1) UnsetJetDomain (&data, cmd_line.jet, grd); 
 
   /* ------------------------------------------------------
@@ -280,12 +300,14 @@ int main (int argc, char *argv[])
      ------------------------------------------------------ */
   
     #ifdef PARALLEL
+     CloudyTimerStart(CL_TM_MPI);
      MPI_Allreduce (&g_maxMach, &scrh, 1, 
                     MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
      g_maxMach = scrh;
 
      MPI_Allreduce (&g_maxRiemannIter, &nv, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
      g_maxRiemannIter = nv;
+     CloudyTimerStop(CL_TM_MPI);
     #endif
 
     g_stepNumber++;
@@ -316,7 +338,9 @@ int main (int argc, char *argv[])
      ------------------------------------------------------ */
 
     if (!first_step && !last_step && cmd_line.write) {
+      CloudyTimerStart(CL_TM_OUTPUT);
       CheckForOutput  (&data, &ini, grd);
+      CloudyTimerStop(CL_TM_OUTPUT);
       CheckForAnalysis(&data, &ini, grd);
     }
 
@@ -351,12 +375,14 @@ int main (int argc, char *argv[])
      ------------------------------------------------------ */
   
     #ifdef PARALLEL
+     CloudyTimerStart(CL_TM_MPI);
      MPI_Allreduce (&g_maxMach, &scrh, 1, 
                     MPI_DOUBLE, MPI_MAX, MPI_COMM_WORLD);
      g_maxMach = scrh;
 
      MPI_Allreduce (&g_maxRiemannIter, &nv, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
      g_maxRiemannIter = nv;
+     CloudyTimerStop(CL_TM_MPI);
     #endif
 
   /* ------------------------------------------------------
@@ -382,6 +408,7 @@ int main (int argc, char *argv[])
        print1 (", Nrkc = %d",Dts.Nrkc);
       #endif
       print1 ("]\n");      
+      CloudyTimerReport(NO);
     }
     
   /* ------------------------------------------------------
@@ -390,7 +417,9 @@ int main (int argc, char *argv[])
      ------------------------------------------------------ */
 
     if (cmd_line.jet != -1) SetJetDomain (&data, cmd_line.jet, grd); 
+    CloudyTimerStart(CL_TM_INTEGRATE);
     err = Integrate (&data, Solver, &Dts, grd);
+    CloudyTimerStop(CL_TM_INTEGRATE);
     if (cmd_line.jet != -1) UnsetJetDomain (&data, cmd_line.jet, grd); 
 
   /* ------------------------------------------------------
@@ -429,13 +458,23 @@ int main (int argc, char *argv[])
    ===================================================================== */
 
   if (cmd_line.write){
+    CloudyTimerStart(CL_TM_OUTPUT);
     CheckForOutput (&data, &ini, grd);
+    CloudyTimerStop(CL_TM_OUTPUT);
     CheckForAnalysis (&data, &ini, grd);
     #ifdef USE_ASYNC_IO
      Async_EndWriteData (&ini);
     #endif
   }
 
+  #ifdef USE_HDF5
+   CloudyTimerStart(CL_TM_OUTPUT);
+   WaitHDF5 ();   /* -- last file of a background hdf5 write -- */
+   CloudyTimerStop(CL_TM_OUTPUT);
+  #endif
+
+  CloudyTimerReport(YES);
+
   #ifdef PARALLEL
    MPI_Barrier (MPI_COMM_WORLD);
    print1  ("\n> Total allocated memory  %6.2f Mb (proc #%d)\n",
@@ -454,6 +493,7 @@ int main (int argc, char *argv[])
   print1("> Done\n");
 
   FreeArray4D ((void ****) data.Vc);
+  CloudyFinalize ();
   #ifdef PARALLEL
    MPI_Barrier (MPI_COMM_WORLD);
    AL_Finalize ();
@@ -666,7 +706,9 @@ double GetNextTimeStep (Time_Step *Dts, struct INPUT *ini, Grid *grid)
    ----------------------------------------------------- */
 
   #ifdef PARALLEL
+   CloudyTimerStart(CL_TM_MPI);
    MPI_Allreduce (&dtnext, &dtnext_glob, 1, MPI_DOUBLE, MPI_MIN, MPI_COMM_WORLD);
+   CloudyTimerStop(CL_TM_MPI);
    dtnext = dtnext_glob;
   #endif
 
@@ -709,7 +751,7 @@ void CheckForOutput (Data *d, Input *ini, Grid *grid)
 {
   static int first_call = 1;
   int  n, check_dt, check_dn, check_dclock;
-  int  restart_update, last_step;
+  int  restart_update, restart_nfile = -1, last_step;
   double t, tnext;
   Output *output;
   static time_t clock_beg[MAX_OUTPUT_TYPES], clock_end;
@@ -795,7 +837,8 @@ void CheckForOutput (Data *d, Input *ini, Grid *grid)
     if (check_dt || check_dn || check_dclock) { 
 
       #ifdef USE_ASYNC_IO
-       if (!strcmp(output->mode,"single_file_async")){
+       if (!strcmp(output->mode,"single_file_async") &&
+           (output->type == DBL_OUTPUT || output->type == FLT_OUTPUT)){
          Async_BegWriteData (d, output, grid);
        }else{
          WriteData(d, output, grid);
@@ -811,6 +854,10 @@ void CheckForOutput (Data *d, Input *ini, Grid *grid)
 
       if ((output->type == DBL_OUTPUT) ||
           (output->type == DBL_H5_OUTPUT)) restart_update = 1;
+      if (output->type == DBL_OUTPUT ||
+         (output->type == DBL_H5_OUTPUT && restart_nfile < 0)) {
+        restart_nfile = output->nfile;
+      }
     }
   }
 
@@ -821,7 +868,10 @@ void CheckForOutput (Data *d, Input *ini, Grid *grid)
     bookkeeping is done using dbl format.
    ------------------------------------------------------- */
 
-  if (restart_update) RestartDump (ini);
+  if (restart_update) {
+    RestartDump (ini);
+    CloudyCouplingDump (restart_nfile);
+  }
 
   first_call = 0;
 }
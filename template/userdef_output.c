@@ -40,15 +40,25 @@ void ComputeUserVar (const Data *d, Grid *grid)
     double ***rad_heat;
     double ***rad_accel;
     double ***heat_eff;
+    double ***n_he23s, ***n_h1s;
+    double ***rad_dhdt, ***rad_temp;
     rad_heat = GetUserVar("U_RAD_HEAT");
     rad_accel = GetUserVar("U_RAD_ACCEL");
     heat_eff = GetUserVar("U_HEAT_EFF");
+    n_he23s = GetUserVar("U_N_HE23S");
+    n_h1s = GetUserVar("U_N_H1S");
+    rad_dhdt = GetUserVar("U_RAD_DHDT");
+    rad_temp = GetUserVar("U_RAD_TEMP");
     DOM_LOOP(k,j,i){
       mean_mol[k][j][i] = mu;
       rad_heat[k][j][i] = 0.0;
       rad_accel[k][j][i] = 0.0;
       heat_eff[k][j][i] = 1.0;
       eden[k][j][i] = 1.0;
+      n_he23s[k][j][i] = 0.0;
+      n_h1s[k][j][i] = 0.0;
+      rad_dhdt[k][j][i] = 0.0;
+      rad_temp[k][j][i] = 0.0;
     }
   }
   